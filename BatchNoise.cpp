@@ -0,0 +1,184 @@
+﻿#include "BatchNoise.h"
+#include "SimdUtil.h"
+#include <cmath>
+
+namespace {
+    // Ken Perlin の置換表（ofNoise と同じもの）を2周分
+    const unsigned char perm[512] = {
+        151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+        190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,88,237,149,56,87,174,20,
+        125,136,171,168,68,175,74,165,71,134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,
+        105,92,41,55,46,245,40,244,102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,200,196,
+        135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,250,124,123,5,202,38,147,118,126,255,
+        82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,223,183,170,213,119,248,152,2,44,154,163,70,221,
+        153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,228,
+        251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,49,192,214,31,181,199,106,
+        157,184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,
+        66,215,61,156,180,
+        151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+        190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,88,237,149,56,87,174,20,
+        125,136,171,168,68,175,74,165,71,134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,
+        105,92,41,55,46,245,40,244,102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,200,196,
+        135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,250,124,123,5,202,38,147,118,126,255,
+        82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,223,183,170,213,119,248,152,2,44,154,163,70,221,
+        153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,228,
+        251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,49,192,214,31,181,199,106,
+        157,184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,
+        66,215,61,156,180
+    };
+
+    const float F3 = 0.333333333f;
+    const float G3 = 0.166666667f;
+
+    inline int fastFloor(float x) { return (x > 0) ? (int)x : (int)x - 1; }
+
+    // 下位4bitから12方向の勾配を選んで内積を取る
+    inline float grad(int hash, float x, float y, float z) {
+        int h = hash & 15;
+        float u = h < 8 ? x : y;
+        float v = h < 4 ? y : (h == 12 || h == 14) ? x : z;
+        return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+    }
+
+    // 勾配の選択を掛け算にした表（SIMD 版で hash から引く）
+    struct GradTable {
+        float x[16], y[16], z[16];
+        GradTable() {
+            for (int h = 0; h < 16; h++) {
+                x[h] = grad(h, 1, 0, 0);
+                y[h] = grad(h, 0, 1, 0);
+                z[h] = grad(h, 0, 0, 1);
+            }
+        }
+    };
+    const GradTable gradTable;
+}
+
+float BatchNoise::signedNoise(float x, float y, float z) {
+    // 入力空間を斜交座標に変換して、どの単体（四面体）に入るかを求める
+    float s = (x + y + z) * F3;
+    int i = fastFloor(x + s);
+    int j = fastFloor(y + s);
+    int k = fastFloor(z + s);
+    float t = (float)(i + j + k) * G3;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+    float z0 = z - (k - t);
+
+    int i1, j1, k1, i2, j2, k2;
+    if (x0 >= y0) {
+        if (y0 >= z0)      { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+        else if (x0 >= z0) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; }
+        else               { i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; }
+    }
+    else {
+        if (y0 < z0)       { i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; }
+        else if (x0 < z0)  { i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; }
+        else               { i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+    }
+
+    float x1 = x0 - i1 + G3, y1 = y0 - j1 + G3, z1 = z0 - k1 + G3;
+    float x2 = x0 - i2 + 2.0f * G3, y2 = y0 - j2 + 2.0f * G3, z2 = z0 - k2 + 2.0f * G3;
+    float x3 = x0 - 1.0f + 3.0f * G3, y3 = y0 - 1.0f + 3.0f * G3, z3 = z0 - 1.0f + 3.0f * G3;
+
+    int ii = i & 0xff, jj = j & 0xff, kk = k & 0xff;
+
+    // 4つの頂点からの寄与
+    float n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+    float t0 = 0.6f - x0 * x0 - y0 * y0 - z0 * z0;
+    if (t0 >= 0.0f) { t0 *= t0; n0 = t0 * t0 * grad(perm[ii + perm[jj + perm[kk]]], x0, y0, z0); }
+    float t1 = 0.6f - x1 * x1 - y1 * y1 - z1 * z1;
+    if (t1 >= 0.0f) { t1 *= t1; n1 = t1 * t1 * grad(perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]], x1, y1, z1); }
+    float t2 = 0.6f - x2 * x2 - y2 * y2 - z2 * z2;
+    if (t2 >= 0.0f) { t2 *= t2; n2 = t2 * t2 * grad(perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]], x2, y2, z2); }
+    float t3 = 0.6f - x3 * x3 - y3 * y3 - z3 * z3;
+    if (t3 >= 0.0f) { t3 *= t3; n3 = t3 * t3 * grad(perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]], x3, y3, z3); }
+
+    // おおよそ [-1, 1] に収まるよう係数を掛ける
+    return 32.0f * (n0 + n1 + n2 + n3);
+}
+
+void BatchNoise::signedNoise(const float* x, const float* y, const float* z, float* out, size_t count) {
+    size_t n = 0;
+#ifdef SIMD_SSE2
+    const __m128 f3 = _mm_set1_ps(F3), g3 = _mm_set1_ps(G3);
+    const __m128 g3x2 = _mm_set1_ps(2.0f * G3), g3x3 = _mm_set1_ps(3.0f * G3);
+    const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), c06 = _mm_set1_ps(0.6f);
+    const __m128i allOnes = _mm_set1_epi32(-1), byteMask = _mm_set1_epi32(0xff);
+
+    for (; n + 4 <= count; n += 4) {
+        __m128 px = _mm_loadu_ps(x + n), py = _mm_loadu_ps(y + n), pz = _mm_loadu_ps(z + n);
+
+        // 斜交座標での格子点（1点版の fastFloor と同じく、0以下は切り捨てから1引く）
+        __m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(px, py), pz), f3);
+        __m128 xs = _mm_add_ps(px, s), ys = _mm_add_ps(py, s), zs = _mm_add_ps(pz, s);
+        __m128i i = _mm_add_epi32(_mm_cvttps_epi32(xs), _mm_andnot_si128(_mm_castps_si128(_mm_cmpgt_ps(xs, zero)), allOnes));
+        __m128i j = _mm_add_epi32(_mm_cvttps_epi32(ys), _mm_andnot_si128(_mm_castps_si128(_mm_cmpgt_ps(ys, zero)), allOnes));
+        __m128i k = _mm_add_epi32(_mm_cvttps_epi32(zs), _mm_andnot_si128(_mm_castps_si128(_mm_cmpgt_ps(zs, zero)), allOnes));
+        __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), g3);
+        __m128 x0 = _mm_sub_ps(px, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+        __m128 y0 = _mm_sub_ps(py, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+        __m128 z0 = _mm_sub_ps(pz, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+        // 単体の2・3番目の頂点の向き（1点版の分岐を比較結果の論理式にしたもの）
+        __m128 xy = _mm_cmpge_ps(x0, y0), yz = _mm_cmpge_ps(y0, z0), xz = _mm_cmpge_ps(x0, z0);
+        __m128 i1 = _mm_and_ps(xy, _mm_or_ps(yz, xz));
+        __m128 j1 = _mm_andnot_ps(xy, yz);
+        __m128 k1 = _mm_andnot_ps(yz, _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(allOnes)), _mm_andnot_ps(xz, _mm_castsi128_ps(allOnes))));
+        __m128 i2 = _mm_or_ps(xy, _mm_and_ps(yz, xz));
+        __m128 j2 = _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(allOnes)), yz);
+        __m128 k2 = _mm_or_ps(_mm_andnot_ps(yz, _mm_castsi128_ps(allOnes)), _mm_andnot_ps(_mm_or_ps(xy, xz), _mm_castsi128_ps(allOnes)));
+
+        __m128 cx[4], cy[4], cz[4];
+        cx[0] = x0; cy[0] = y0; cz[0] = z0;
+        cx[1] = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i1, one)), g3);
+        cy[1] = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j1, one)), g3);
+        cz[1] = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k1, one)), g3);
+        cx[2] = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i2, one)), g3x2);
+        cy[2] = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j2, one)), g3x2);
+        cz[2] = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k2, one)), g3x2);
+        cx[3] = _mm_add_ps(_mm_sub_ps(x0, one), g3x3);
+        cy[3] = _mm_add_ps(_mm_sub_ps(y0, one), g3x3);
+        cz[3] = _mm_add_ps(_mm_sub_ps(z0, one), g3x3);
+
+        // 置換表は4点 x 4頂点ぶんを1点ずつ引き、勾配は表から SoA に並べる
+        alignas(16) int ii[4], jj[4], kk[4], o1[4], o2[4];
+        _mm_store_si128((__m128i*)ii, _mm_and_si128(i, byteMask));
+        _mm_store_si128((__m128i*)jj, _mm_and_si128(j, byteMask));
+        _mm_store_si128((__m128i*)kk, _mm_and_si128(k, byteMask));
+        // 頂点1・2のオフセットを1つの整数に詰める (bit0: i, bit1: j, bit2: k)
+        __m128i b1 = _mm_or_si128(_mm_or_si128(_mm_srli_epi32(_mm_castps_si128(i1), 31), _mm_slli_epi32(_mm_srli_epi32(_mm_castps_si128(j1), 31), 1)), _mm_slli_epi32(_mm_srli_epi32(_mm_castps_si128(k1), 31), 2));
+        __m128i b2 = _mm_or_si128(_mm_or_si128(_mm_srli_epi32(_mm_castps_si128(i2), 31), _mm_slli_epi32(_mm_srli_epi32(_mm_castps_si128(j2), 31), 1)), _mm_slli_epi32(_mm_srli_epi32(_mm_castps_si128(k2), 31), 2));
+        _mm_store_si128((__m128i*)o1, b1);
+        _mm_store_si128((__m128i*)o2, b2);
+
+        alignas(16) float gx[4][4], gy[4][4], gz[4][4];
+        for (int l = 0; l < 4; l++) {
+            int a = ii[l], b = jj[l], c = kk[l];
+            int h[4] = {
+                perm[a + perm[b + perm[c]]],
+                perm[a + (o1[l] & 1) + perm[b + ((o1[l] >> 1) & 1) + perm[c + (o1[l] >> 2)]]],
+                perm[a + (o2[l] & 1) + perm[b + ((o2[l] >> 1) & 1) + perm[c + (o2[l] >> 2)]]],
+                perm[a + 1 + perm[b + 1 + perm[c + 1]]],
+            };
+            for (int corner = 0; corner < 4; corner++) {
+                int g = h[corner] & 15;
+                gx[corner][l] = gradTable.x[g];
+                gy[corner][l] = gradTable.y[g];
+                gz[corner][l] = gradTable.z[g];
+            }
+        }
+
+        __m128 sum = zero;
+        for (int corner = 0; corner < 4; corner++) {
+            __m128 tc = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(c06, _mm_mul_ps(cx[corner], cx[corner])), _mm_mul_ps(cy[corner], cy[corner])), _mm_mul_ps(cz[corner], cz[corner]));
+            __m128 inside = _mm_cmpge_ps(tc, zero);
+            tc = _mm_mul_ps(tc, tc);
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[corner]), cx[corner]), _mm_mul_ps(_mm_load_ps(gy[corner]), cy[corner])), _mm_mul_ps(_mm_load_ps(gz[corner]), cz[corner]));
+            sum = _mm_add_ps(sum, _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(tc, tc), dot)));
+        }
+        _mm_storeu_ps(out + n, _mm_mul_ps(sum, _mm_set1_ps(32.0f)));
+    }
+#endif
+    for (; n < count; n++) out[n] = signedNoise(x[n], y[n], z[n]);
+}
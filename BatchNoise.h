@@ -0,0 +1,9 @@
+﻿#pragma once
+#include <cstddef>
+
+// ofSignedNoise(x, y, z) と同じ 3D シンプレックスノイズ（同じ置換表・勾配・係数）を
+// 多数の点についてまとめて求める。SSE2 では4点ずつ、格子の選択も分岐なしで計算する
+namespace BatchNoise {
+    float signedNoise(float x, float y, float z);  // 1点版（結果は ofSignedNoise と同じ）
+    void signedNoise(const float* x, const float* y, const float* z, float* out, size_t count);
+}
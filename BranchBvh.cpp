@@ -0,0 +1,163 @@
+﻿#include "BranchBvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+    // 光線と箱が交わる最初の距離（始点より手前は 0）
+    bool intersectBox(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& bmin, const glm::vec3& bmax, float& tNear) {
+        glm::vec3 t0 = (bmin - origin) * invDir;
+        glm::vec3 t1 = (bmax - origin) * invDir;
+        glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+        tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+        float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+        return tNear <= tFar;
+    }
+
+    // 正規化した方向 dir の光線とカプセル (a-b, 半径 r) の交点までの距離。交わらなければ -1
+    float intersectCapsule(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& a, const glm::vec3& b, float r) {
+        glm::vec3 ba = b - a, oa = origin - a;
+        float baba = glm::dot(ba, ba), bard = glm::dot(ba, dir), baoa = glm::dot(ba, oa);
+        float rdoa = glm::dot(dir, oa), oaoa = glm::dot(oa, oa);
+
+        // 側面（円柱部分）
+        float qa = baba - bard * bard;
+        if (qa > 1e-8f * baba) {
+            float qb = baba * rdoa - baoa * bard;
+            float qc = baba * oaoa - baoa * baoa - r * r * baba;
+            float h = qb * qb - qa * qc;
+            if (h < 0.0f) return -1.0f;
+            float t = (-qb - sqrt(h)) / qa;
+            float y = baoa + t * bard;
+            if (y > 0.0f && y < baba) return t;
+        }
+
+        // 両端の半球（光線が軸と平行な場合も含む）
+        float best = -1.0f;
+        for (const glm::vec3* center : { &a, &b }) {
+            glm::vec3 oc = origin - *center;
+            float hb = glm::dot(dir, oc);
+            float h = hb * hb - (glm::dot(oc, oc) - r * r);
+            if (h < 0.0f) continue;
+            float t = -hb - sqrt(h);
+            if (t >= 0.0f && (best < 0.0f || t < best)) best = t;
+        }
+        return best;
+    }
+}
+
+void BranchBvh::clear() {
+    branches.clear();
+    order.clear();
+    nodes.clear();
+}
+
+void BranchBvh::build() {
+    order.resize(branches.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    nodes.clear();
+    if (branches.empty()) return;
+    nodes.reserve(branches.size() * 2 / LEAF_SIZE + 1);
+    buildNode(0, (int)branches.size(), 0);
+}
+
+int BranchBvh::buildNode(int first, int count, int depth) {
+    int index = (int)nodes.size();
+    nodes.emplace_back();
+
+    Node node;
+    node.axisMin = node.axisMax = branches[order[first]].base;
+    node.radius = 0;
+    glm::vec3 cMin(FLT_MAX), cMax(-FLT_MAX);
+    for (int i = first; i < first + count; i++) {
+        const Branch& b = branches[order[i]];
+        node.axisMin = glm::min(node.axisMin, glm::min(b.base, b.tip));
+        node.axisMax = glm::max(node.axisMax, glm::max(b.base, b.tip));
+        node.radius = std::max(node.radius, b.radius);
+        glm::vec3 c = (b.base + b.tip) * 0.5f;
+        cMin = glm::min(cMin, c);
+        cMax = glm::max(cMax, c);
+    }
+
+    // 中点の広がりが最も大きい軸で、本数が半分ずつになるように分ける
+    glm::vec3 extent = cMax - cMin;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    if (count <= LEAF_SIZE || extent[axis] <= 0.0f || depth >= MAX_STACK - 2) {
+        node.first = first;
+        node.count = count;
+        nodes[index] = node;
+        return index;
+    }
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](int a, int b) {
+        return branches[a].base[axis] + branches[a].tip[axis] < branches[b].base[axis] + branches[b].tip[axis];
+    });
+    buildNode(first, half, depth + 1);
+    node.first = buildNode(first + half, count - half, depth + 1);
+    node.count = 0;
+    nodes[index] = node;
+    return index;
+}
+
+bool BranchBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float lenK, float thickK, Hit& hit) const {
+    if (nodes.empty()) return false;
+    float dirLen = glm::length(dir);
+    if (dirLen <= 0.0f) return false;
+    glm::vec3 rd = dir / dirLen;
+    glm::vec3 invDir(1.0f / rd.x, 1.0f / rd.y, 1.0f / rd.z);
+
+    auto getBounds = [&](const Node& n, float& tNear) {
+        glm::vec3 pad(n.radius * thickK);
+        return intersectBox(origin, invDir, n.axisMin * lenK - pad, n.axisMax * lenK + pad, tNear);
+    };
+
+    float best = FLT_MAX;
+    int bestIndex = -1;
+    int stack[MAX_STACK];
+    float stackT[MAX_STACK];
+    int sp = 0;
+    float tRoot;
+    if (!getBounds(nodes[0], tRoot)) return false;
+    stack[sp] = 0;
+    stackT[sp++] = tRoot;
+
+    while (sp > 0) {
+        sp--;
+        if (stackT[sp] > best) continue;
+        int ni = stack[sp];
+        const Node& node = nodes[ni];
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                const Branch& b = branches[order[i]];
+                float t = intersectCapsule(origin, rd, b.base * lenK, b.tip * lenK, b.radius * thickK);
+                if (t >= 0.0f && t < best) {
+                    best = t;
+                    bestIndex = order[i];
+                }
+            }
+            continue;
+        }
+
+        // 近い方の子を後に積んで先に調べる
+        int left = ni + 1, right = node.first;
+        float tl, tr;
+        bool hitL = getBounds(nodes[left], tl) && tl <= best;
+        bool hitR = getBounds(nodes[right], tr) && tr <= best;
+        if (hitL && hitR && tl < tr) {
+            std::swap(left, right);
+            std::swap(tl, tr);
+        }
+        if (hitL) { stack[sp] = left; stackT[sp++] = tl; }
+        if (hitR) { stack[sp] = right; stackT[sp++] = tr; }
+    }
+    if (bestIndex < 0) return false;
+
+    hit.index = bestIndex;
+    hit.distance = best;
+    hit.point = origin + rd * best;
+    hit.branch = branches[bestIndex];
+    hit.branch.base *= lenK;
+    hit.branch.tip *= lenK;
+    hit.branch.radius *= thickK;
+    return true;
+}
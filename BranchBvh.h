@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+// 枝の円柱を線分と半径（カプセル）で近似した BVH（マウスで指した枝を調べる）
+// 位置は構築時の形状で持ち、補間中は軸（長さの比率）と半径（太さの比率）に別々に掛ける
+// 枝の付け根・先端はすべて幹の長さに比例するので、節点の箱も同じ2つの比率から直接求まり、
+// 長さ・太さの補間中に作り直しや箱の再計算はいらない
+class BranchBvh {
+public:
+    struct Branch {
+        glm::vec3 base, tip;     // 構築時の付け根・先端
+        float radius = 0;        // 構築時の半径（頂点ノイズの振れ幅を含む）
+        int level = 0;           // 幹からの段数 (0 = 幹)
+        int parent = -1;         // 親の枝の番号 (-1 = 幹)
+        int subtreeSize = 1;     // この枝から先の枝の本数（自身を含む）
+        float hue = 0;           // 枝の色相 (0-255)
+    };
+
+    struct Hit {
+        int index = -1;          // 当たった枝の番号
+        float distance = 0;      // 光線の始点からの距離
+        glm::vec3 point;
+        Branch branch;           // 補間中の比率を掛けた後の位置・半径
+    };
+
+    void clear();
+    std::vector<Branch>& getBranches() { return branches; }  // 追加し終えたら build を呼ぶ
+    const Branch& getBranch(int i) const { return branches[i]; }
+    size_t size() const { return branches.size(); }
+    void build();
+
+    // 光線と最初に交わる枝を探す（lenK / thickK は構築時からの長さ・太さの比率）
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, float lenK, float thickK, Hit& hit) const;
+
+private:
+    struct Node {
+        glm::vec3 axisMin, axisMax;  // 付け根・先端の点だけの箱（長さの比率を掛ける）
+        float radius;                // 中の枝の最大半径（太さの比率を掛けて箱を広げる）
+        int first, count;            // 葉: order の区間、内部: count = 0 で first = 右の子（左の子は直後）
+    };
+    enum { LEAF_SIZE = 4, MAX_STACK = 64 };
+
+    int buildNode(int first, int count, int depth);
+
+    std::vector<Branch> branches;
+    std::vector<int> order;      // 葉の区間が指す枝の番号
+    std::vector<Node> nodes;
+};
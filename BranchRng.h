@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <cstdint>
+
+// 枝の経路（幹からの分岐番号の列）をキーにした状態を持たない乱数
+// 生成順に依存しないので、どの枝もその経路だけから同じ値を再現できる
+namespace BranchRng {
+    // splitmix64 の最終段
+    inline uint64_t mix(uint64_t z) {
+        z += 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t root(int seed) { return mix((uint64_t)(uint32_t)seed); }
+
+    // index 番目の子の枝のキー
+    inline uint64_t child(uint64_t parent, int index) {
+        return mix(parent ^ (0xD1B54A32D192ED03ull * (uint64_t)(index + 1)));
+    }
+
+    // キーと用途 (salt) から [lo, hi) の一様乱数
+    inline float range(uint64_t key, float lo, float hi, uint64_t salt = 0) {
+        float u = (float)(mix(key ^ salt) >> 40) * (1.0f / 16777216.0f);
+        return lo + (hi - lo) * u;
+    }
+}
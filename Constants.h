@@ -1,9 +1,7 @@
 ﻿#pragma once
 #include "ofMain.h"
+#include "GameTypes.h"
 
-enum GrowthType { TYPE_DEFAULT, TYPE_ELEGANT, TYPE_STURDY, TYPE_ELDRITCH };
-enum FlowerType { FLOWER_NONE, FLOWER_CRYSTAL, FLOWER_PETAL, FLOWER_SPIRIT };
-enum CommandType { CMD_WATER, CMD_FERTILIZER, CMD_KOTODAMA };
 enum BarState { BAR_IDLE, BAR_LEVEL_UP_FLASH, BAR_RESET_WAIT };
 enum ParticleType { P_WATER, P_FERTILIZER, P_KOTODAMA, P_RAIN_SPLASH, P_BLOOM };
 enum WeatherState { SUNNY, RAINY, MOONLIGHT };
@@ -31,6 +29,33 @@ struct TreeSettings {
     float noiseStrengthMax;   // 頂点ノイズの最大強度
     float bloomThreshold;     // 開花に必要な変異度の基本しきい値
 
+    // --- 生成モード ---
+    bool rescaleGlide = true; // 補間中は再構築せず、長さ・半径のスケールのみ更新
+    bool incrementalGrowth = true;  // 深さが増えたら新しい段だけを追記する
+    float growthDuration = 0.8f;    // 新しい段のスケールイン時間（秒）
+    float compactRetired = 0.05f;   // 退役した三角形がインデックスのこの割合を超えたらバッファを詰める
+    bool parallelBuild = true;      // 深い木は部分木ごとにワーカースレッドで構築する
+    int parallelMinDepth = 5;       // 並列構築に切り替える深さ
+    // 量子化した頂点形式 (PackedMesh) で描画する。減るのは GPU 側のメモリと転送量だけで、
+    // CPU 側の浮動小数点の頂点・静止姿勢の配列は段の追記やキャッシュが使うので残る
+    bool packedVertices = false;
+    bool instancedStems = false;    // 枝を正準メッシュのインスタンスで描画する (StemInstancer)
+    // 変異度0のときは同じ形の部分木を1つだけ構築して使い回す
+    // （有効な間は段の追記と粗いメッシュを使えず、深さが増えるたびに作り直し、遠景も最も細かいメッシュで描く）
+    bool dedupSubtrees = false;
+    bool chunkedBuild = true;       // 深い木は固定サイズのチャンクに分け、フレームをまたいで生成する
+    int chunkMinDepth = 9;          // 分割構築に切り替える深さ
+    int chunkVertices = 65536;      // 1チャンクの頂点数
+    float chunkBudgetMs = 4.0f;     // 1フレームで生成に使う時間
+    bool lodLevels = true;          // 見かけの大きさに応じて粗いメッシュに切り替える
+    float lodScreenSize[2] = { 450.0f, 180.0f }; // この高さ（ピクセル）を下回るとレベル1, 2
+    float lodHysteresis = 0.15f;    // 切り替えの閾値に持たせる幅（割合）
+    bool foliageCards = true;       // 粗いレベルでは先端の房の葉・花を1組のカードで描く
+    int foliageCardLod = 1;         // カードに置き換え始めるレベル
+    int foliageCardDepth = 2;       // この深さの枝から先の葉・花を1つの房とする
+    int foliageCardSize = 64;       // カード1面のテクスチャの大きさ（ピクセル）
+    bool meshCache = true;          // プリセットの生成結果を bin/data/cache/tree に保存して再利用する (MeshCache)
+
     ofColor leafColor, flowerColor;
 };
 
@@ -93,6 +118,7 @@ struct GameState {
     bool bShowDebug = false;
     bool bTimeFrozen = false;
     bool bInfiniteSkills = false;
+    bool bForestMode = false;   // 周囲に森 (Forest) を植えて描く
     string finalTitle = "";
     int maxDays = 50;
     GrowthType currentType = TYPE_DEFAULT;
@@ -129,6 +155,7 @@ struct GameState {
     float sigilRotationSpeed = 45.0f;
 };
 
+// 2D パーティクル1粒の生成時の値（更新・描画は ParticleSystem2D が種類ごとにまとめて行う）
 struct Particle2D {
     glm::vec2 pos, vel;
     ofColor color;
@@ -136,60 +163,5 @@ struct Particle2D {
     ParticleType type;
     float angle = 0.0f;
     float spiralRadius = 0.0f; // 螺旋の初期半径
-
-    void update(float dt) {
-        if (type == P_KOTODAMA) {
-            // 吸い込まれる螺旋ロジック
-            angle += 8.0f * dt;
-            // 寿命(life)が 1.0 -> 0.0 になるにつれて半径を縮小
-            float currentR = spiralRadius * life;
-            pos.x = ofGetWidth() * 0.5f + cos(angle) * currentR - vel.x;
-            pos.y = ofGetHeight() * 0.5f + sin(angle) * currentR - vel.x;
-            // サイズ：最初は大きく、徐々に小さく (25 -> 2)
-            size = ofMap(life, 1.0f, 0.0f, 25.0f, 2.0f, true);
-        }
-        else if (type == P_RAIN_SPLASH) {
-            // 波紋：位置固定、寿命のみ減衰
-        }
-        else {
-            pos += vel * (dt * 60.0f);
-        }
-        life -= decay * (dt * 60.0f);
-    }
-
-    void draw(bool shadowPass, WeatherState ws) {
-        if (type == P_RAIN_SPLASH) {
-            // 復活：雨の波紋（広がる楕円）
-            ofPushStyle();
-            ofNoFill();
-            ofSetLineWidth(2);
-            ofSetColor(color, life * 150);
-            float rippleW = (1.0f - life) * size * 4.0f;
-            float rippleH = (1.0f - life) * size * 2.0f;
-            ofDrawEllipse(pos, rippleW, rippleH);
-            ofPopStyle();
-        }
-        else {
-            if (shadowPass) {
-                ofColor shadowCol;
-                switch (type) {
-                case P_WATER:     shadowCol = ofColor(15, 40, 85); break;
-                case P_FERTILIZER: shadowCol = ofColor(35, 55, 20); break;
-                case P_KOTODAMA:   shadowCol = ofColor(65, 25, 80); break;
-                case P_BLOOM:      shadowCol = ofColor(85, 30, 45); break;
-                default:           shadowCol = ofColor(30, 30, 40); break;
-                }
-                float targetAlpha = 160.0f;
-                if (ws == SUNNY) targetAlpha = 210.0f;
-                else targetAlpha = 110.0f;
-
-                ofSetColor(shadowCol, life * targetAlpha);
-                ofDrawCircle(pos, size * 1.1f);
-            }
-            else {
-                ofSetColor(color, life * 255);
-                ofDrawCircle(pos, size);
-            }
-        }
-    }
+    float sizeScale = 1.0f;    // 大きさの倍率（予算による縮小。言霊は毎フレーム求める大きさにも掛ける）
 };
\ No newline at end of file
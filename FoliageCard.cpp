@@ -0,0 +1,131 @@
+﻿#include "FoliageCard.h"
+
+void FoliageCard::build(const glm::vec3* verts, const ofFloatColor* colors, const ofIndexType* indices, size_t numIndices, int sz) {
+    size = sz;
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = -boundsMin;
+    for (size_t i = 0; i < numIndices; i++) {
+        boundsMin = glm::min(boundsMin, verts[indices[i]]);
+        boundsMax = glm::max(boundsMax, verts[indices[i]]);
+    }
+    if (numIndices == 0) boundsMin = boundsMax = glm::vec3(0);
+    // 補間で縁が欠けないよう、範囲を少し広げる
+    glm::vec3 pad = glm::max(boundsMax - boundsMin, glm::vec3(1e-4f)) * 0.04f;
+    boundsMin -= pad;
+    boundsMax += pad;
+
+    pixels.allocate(size * 2, size, OF_PIXELS_RGBA);
+    unsigned char* data = pixels.getData();
+    for (size_t i = 0; i < pixels.size(); i++) data[i] = 0;
+    vector<float> zbuf(size * 2 * size, -std::numeric_limits<float>::max());
+
+    // 面ごとに正射影し、手前（+Z / +X 側）の三角形を残す
+    glm::vec3 range = boundsMax - boundsMin;
+    for (size_t t = 0; t + 2 < numIndices; t += 3) {
+        glm::vec2 pa[3], pb[3];
+        float za[3], zb[3];
+        ofFloatColor c[3];
+        for (int k = 0; k < 3; k++) {
+            glm::vec3 q = (verts[indices[t + k]] - boundsMin) / range;
+            pa[k] = glm::vec2(q.x, q.y) * (float)size;
+            pb[k] = glm::vec2(q.z, q.y) * (float)size;
+            za[k] = q.z;
+            zb[k] = q.x;
+            c[k] = colors[indices[t + k]];
+        }
+        rasterize(pa, za, c, 0, zbuf);
+        rasterize(pb, zb, c, size, zbuf);
+    }
+
+    // 透明な画素の色を塗られた画素の平均にして、縁の補間で黒ずまないようにする
+    glm::vec3 sum(0);
+    size_t filled = 0;
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        if (data[i + 3] == 0) continue;
+        sum += glm::vec3(data[i], data[i + 1], data[i + 2]);
+        filled++;
+    }
+    if (filled > 0) sum /= (float)filled;
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        if (data[i + 3] != 0) continue;
+        data[i] = (unsigned char)sum.x;
+        data[i + 1] = (unsigned char)sum.y;
+        data[i + 2] = (unsigned char)sum.z;
+    }
+
+    texture.allocate(pixels);
+    texture.setTextureMinMagFilter(GL_LINEAR, GL_LINEAR);
+}
+
+void FoliageCard::rasterize(const glm::vec2* p, const float* depth, const ofFloatColor* c, int offsetX, vector<float>& zbuf) {
+    unsigned char* data = pixels.getData();
+    auto plot = [&](int x, int y, float z, const ofFloatColor& col) {
+        size_t i = (size_t)y * size * 2 + offsetX + x;
+        if (z <= zbuf[i]) return;
+        zbuf[i] = z;
+        data[i * 4] = (unsigned char)(ofClamp(col.r, 0, 1) * 255);
+        data[i * 4 + 1] = (unsigned char)(ofClamp(col.g, 0, 1) * 255);
+        data[i * 4 + 2] = (unsigned char)(ofClamp(col.b, 0, 1) * 255);
+        data[i * 4 + 3] = 255;
+    };
+
+    float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if (abs(area) < 1e-6f) {
+        // 面に垂直な三角形は線になるので、頂点の画素だけ塗る
+        for (int k = 0; k < 3; k++) {
+            int x = (int)p[k].x, y = (int)p[k].y;
+            if (x >= 0 && x < size && y >= 0 && y < size) plot(x, y, depth[k], c[k]);
+        }
+        return;
+    }
+
+    int x0 = max(0, (int)floor(min({ p[0].x, p[1].x, p[2].x })));
+    int x1 = min(size - 1, (int)ceil(max({ p[0].x, p[1].x, p[2].x })));
+    int y0 = max(0, (int)floor(min({ p[0].y, p[1].y, p[2].y })));
+    int y1 = min(size - 1, (int)ceil(max({ p[0].y, p[1].y, p[2].y })));
+
+    // 画素の中心が三角形の内側なら、重心座標で奥行きと色を補間して塗る
+    bool bCovered = false;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            glm::vec2 q(x + 0.5f, y + 0.5f);
+            float w0 = ((p[1].x - q.x) * (p[2].y - q.y) - (p[2].x - q.x) * (p[1].y - q.y)) / area;
+            float w1 = ((p[2].x - q.x) * (p[0].y - q.y) - (p[0].x - q.x) * (p[2].y - q.y)) / area;
+            float w2 = 1.0f - w0 - w1;
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+            ofFloatColor col = c[0] * w0 + c[1] * w1 + c[2] * w2;
+            plot(x, y, depth[0] * w0 + depth[1] * w1 + depth[2] * w2, col);
+            bCovered = true;
+        }
+    }
+    // 画素より小さい三角形も消えないよう、重心の画素は塗る
+    if (!bCovered) {
+        glm::vec2 q = (p[0] + p[1] + p[2]) / 3.0f;
+        int x = ofClamp((int)q.x, 0, size - 1), y = ofClamp((int)q.y, 0, size - 1);
+        plot(x, y, (depth[0] + depth[1] + depth[2]) / 3.0f, c[0]);
+    }
+}
+
+void FoliageCard::getCardVertices(const glm::mat4& mat, glm::vec3* verts, glm::vec2* texCoords) const {
+    // 1枚目は房の中心を通る XY 面、2枚目は ZY 面
+    const glm::vec3& mn = boundsMin;
+    const glm::vec3& mx = boundsMax;
+    glm::vec3 center = (mn + mx) * 0.5f;
+    glm::vec3 corners[NUM_VERTS] = {
+        { mn.x, mn.y, center.z }, { mx.x, mn.y, center.z }, { mx.x, mx.y, center.z }, { mn.x, mx.y, center.z },
+        { center.x, mn.y, mn.z }, { center.x, mn.y, mx.z }, { center.x, mx.y, mx.z }, { center.x, mx.y, mn.z },
+    };
+    glm::vec2 uvs[NUM_VERTS] = {
+        { 0.0f, 0.0f }, { 0.5f, 0.0f }, { 0.5f, 1.0f }, { 0.0f, 1.0f },
+        { 0.5f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.5f, 1.0f },
+    };
+    for (int i = 0; i < NUM_VERTS; i++) {
+        verts[i] = glm::vec3(mat * glm::vec4(corners[i], 1.0f));
+        texCoords[i] = texture.isAllocated() ? texture.getCoordFromPercent(uvs[i].x, uvs[i].y) : uvs[i];
+    }
+}
+
+void FoliageCard::addCardIndices(ofIndexType base, ofIndexType* indices) {
+    const ofIndexType quad[] = { 0,1,2, 0,2,3, 4,5,6, 4,6,7 };
+    for (int i = 0; i < NUM_INDICES; i++) indices[i] = base + quad[i];
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 先端の葉・花の房を遠景で置き換える交差カード（十字に組んだ2枚の板）
+// テクスチャは実際の三角形を CPU で正射影して塗りつぶして作る（左半分: XY面、右半分: ZY面）
+class FoliageCard {
+public:
+    // 房の三角形（房の付け根を原点とする座標）から、2面分の画像と房の範囲を作る
+    void build(const glm::vec3* verts, const ofFloatColor* colors, const ofIndexType* indices, size_t numIndices, int size);
+
+    // 房の付け根の行列に置く 8頂点 (2枚 x 4隅) の位置・テクスチャ座標（インデックスは addCardIndices）
+    void getCardVertices(const glm::mat4& mat, glm::vec3* verts, glm::vec2* texCoords) const;
+    static void addCardIndices(ofIndexType base, ofIndexType* indices);
+    enum { NUM_VERTS = 8, NUM_INDICES = 12 };
+
+    void bind() const { texture.bind(); }
+    void unbind() const { texture.unbind(); }
+    bool isAllocated() const { return texture.isAllocated(); }
+
+private:
+    void rasterize(const glm::vec2* p, const float* depth, const ofFloatColor* c, int offsetX, vector<float>& zbuf);
+
+    ofPixels pixels;
+    ofTexture texture;
+    int size = 0;
+    glm::vec3 boundsMin, boundsMax;
+};
@@ -0,0 +1,450 @@
+﻿#include "Forest.h"
+#include "BranchRng.h"
+#include "Frustum.h"
+#include "WorkerPool.h"
+
+namespace {
+    int8_t toSnorm8(float v) { return (int8_t)roundf(ofClamp(v, -1.0f, 1.0f) * 127.0f); }
+    uint8_t toUnorm8(float v) { return (uint8_t)roundf(ofClamp(v, 0.0f, 1.0f) * 255.0f); }
+}
+
+void Forest::setup(const ofJson& config) {
+    growthConfig.load(config);
+
+    auto f = config.value("forest", ofJson::object());
+    spacing = f.value("spacing", spacing);
+    clearing = f.value("clearing", clearing);
+    treeScale = f.value("tree_scale", treeScale);
+    auto age = f.value("age", ofJson::array());
+    if (age.size() >= 2) {
+        ageMin = age[0];
+        ageMax = age[1];
+    }
+    farDepthDrop = max(f.value("far_depth_drop", farDepthDrop), 0);
+    auto treeLods = f.value("tree_lod", ofJson::array());
+    for (int l = 0; l < NUM_LEVELS && l < (int)treeLods.size(); l++) treeLod[l] = treeLods[l];
+    auto lodSize = f.value("lod_screen_size", ofJson::array());
+    if (lodSize.size() >= 2) {
+        lodScreenSize[0] = lodSize[0];
+        lodScreenSize[1] = lodSize[1];
+    }
+    lodHysteresis = f.value("lod_hysteresis", lodHysteresis);
+    maxNearTrees = max(f.value("max_near_trees", maxNearTrees), 0);
+    maxMidTrees = max(f.value("max_mid_trees", maxMidTrees), 0);
+    keepFrames = max(f.value("keep_frames", keepFrames), 1);
+    buildBudget = max(f.value("build_budget", buildBudget), 1);
+    pageVertices = max(f.value("page_vertices", (int)pageVertices), 65536);
+    pageIndices = pageVertices * 3;
+
+    // 生成用の木は GL もディスクも使わない設定で、スレッドの数だけ用意する
+    ofJson builderConfig = config;
+    auto& gen = builderConfig["tree"]["generation"];
+    gen["packed_vertices"] = false;
+    gen["instanced_stems"] = false;
+    gen["mesh_cache"] = false;
+    builders.resize(WorkerPool::shared().getNumThreads());
+    for (auto& b : builders) {
+        b.tree = make_unique<Tree>();
+        b.tree->setup(builderConfig);
+    }
+}
+
+void Forest::plant(int count, uint64_t seed) {
+    clear();
+
+    // 中央の空き地を除いた円の中に、揺らぎを加えた格子で並べる（中心に近い順に count 本）
+    vector<glm::vec3> spots;
+    radius = sqrt(count * spacing * spacing / PI + clearing * clearing);
+    while ((int)spots.size() < count) {
+        spots.clear();
+        int half = (int)ceil(radius / spacing);
+        for (int gz = -half; gz <= half; gz++) {
+            for (int gx = -half; gx <= half; gx++) {
+                uint64_t key = BranchRng::mix(seed ^ BranchRng::child((uint64_t)(gx + 0x10000), gz));
+                glm::vec3 p(gx * spacing + BranchRng::range(key, -0.35f, 0.35f, 1) * spacing, 0,
+                            gz * spacing + BranchRng::range(key, -0.35f, 0.35f, 2) * spacing);
+                float d = glm::length(p);
+                if (d > clearing && d <= radius) spots.push_back(p);
+            }
+        }
+        radius += spacing;
+    }
+    sort(spots.begin(), spots.end(), [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a) < glm::length(b); });
+    spots.resize(count);
+    radius = count > 0 ? glm::length(spots.back()) : 0.0f;
+
+    GrowthSim sim(growthConfig);
+    trees.reserve(count);
+    for (int i = 0; i < count; i++) {
+        uint64_t key = BranchRng::child(BranchRng::mix(seed), i);
+        sim.reset(key);
+
+        // 木ごとに水・肥料・言霊の好みと育てる日数を変え、貯まったスキルポイントはその都度使う
+        float w[3];
+        for (int c = 0; c < 3; c++) w[c] = BranchRng::range(key, 0.1f, 1.0f, 10 + c);
+        int days = (int)roundf(growthConfig.maxDays * BranchRng::range(key, ageMin, ageMax, 13));
+        for (int c = 0; !sim.isEnded() && sim.getState().day < days; c++) {
+            uint64_t k = BranchRng::child(key, c);
+            float u = BranchRng::range(k, 0.0f, w[0] + w[1] + w[2]);
+            sim.command(u < w[0] ? CMD_WATER : (u < w[0] + w[1] ? CMD_FERTILIZER : CMD_KOTODAMA));
+            sim.upgrade((SkillType)((k >> 8) % 3));
+        }
+
+        const GrowthState& st = sim.getState();
+        ForestTree t;
+        t.seed = (int)st.treeSeed;
+        t.type = st.type;
+        t.flower = st.flower;
+        t.depth = st.depthLevel;
+        t.len = st.len;
+        t.thick = st.thick;
+        t.mutation = st.mutation;
+        t.maxMutation = st.maxMutationReached;
+        t.chaosResist = st.skillLevels[SKILL_RESIST];
+        t.bloomLevel = st.skillLevels[SKILL_CATALYST];
+        t.position = spots[i];
+        t.rotation = BranchRng::range(key, 0.0f, 360.0f, 14);
+        t.scale = treeScale * BranchRng::range(key, 0.85f, 1.15f, 15);
+        add(t);
+    }
+}
+
+size_t Forest::add(const ForestTree& t) {
+    Entry e;
+    e.desc = t;
+    trees.push_back(e);
+    return trees.size() - 1;
+}
+
+void Forest::set(size_t i, const ForestTree& t) {
+    // 古いメッシュは新しい FAR を転送するまで描き続ける
+    if (trees[i].desc == t) return;
+    trees[i].desc = t;
+    trees[i].bDirty = true;
+}
+
+void Forest::clear() {
+    trees.clear();
+    pages.clear();
+    numVisible = numDrawCalls = 0;
+}
+
+int Forest::getLevelDepth(const ForestTree& t, Level level) const {
+    return (level == LEVEL_FAR) ? max(0, t.depth - farDepthDrop) : t.depth;
+}
+
+int Forest::getJobCost(Level level) const {
+    // 深さ6の木で FAR : MID : NEAR の構築時間はおよそ 1 : 8 : 16
+    switch (level) {
+    case LEVEL_NEAR: return 16;
+    case LEVEL_MID: return 8;
+    default: return 1;
+    }
+}
+
+void Forest::update() {
+    // しばらく描画に使われていない NEAR / MID は捨てる
+    for (auto& e : trees) {
+        for (int l = LEVEL_NEAR; l < LEVEL_FAR; l++) {
+            MeshRange& r = e.levels[l];
+            if (r.isResident() && frame - r.lastUsedFrame > (unsigned int)keepFrames) freeLevel(r);
+        }
+    }
+
+    // 作り直しが必要な木の FAR を先に、次に描画で選ばれた細かいレベルを見かけの大きい順に積む
+    size_t numJobs = 0;
+    int budget = buildBudget;
+    auto push = [&](size_t i, Level level) {
+        if (numJobs == jobs.size()) jobs.emplace_back();
+        jobs[numJobs].tree = i;
+        jobs[numJobs].level = level;
+        numJobs++;
+        budget -= getJobCost(level);
+    };
+    for (size_t i = 0; i < trees.size() && budget > 0; i++) {
+        if (trees[i].bDirty) push(i, LEVEL_FAR);
+    }
+    candidates.clear();
+    for (size_t i = 0; i < trees.size(); i++) {
+        const Entry& e = trees[i];
+        if (!e.bDirty && e.lodTarget < LEVEL_FAR && !e.levels[e.lodTarget].isResident()) candidates.push_back(i);
+    }
+    sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return trees[a].screenSize > trees[b].screenSize; });
+    for (size_t i : candidates) {
+        if (budget <= 0) break;
+        push(i, (Level)trees[i].lodTarget);
+    }
+    if (numJobs == 0) return;
+
+    // 生成用の木1つにつき1スレッドで、空いたスレッドから次の木を取る
+    atomic<size_t> next{ 0 };
+    size_t numWorkers = min(builders.size(), numJobs);
+    WorkerPool::shared().parallelFor(numWorkers, [&](size_t b) {
+        for (size_t j = next++; j < numJobs; j = next++) buildJob(builders[b], jobs[j]);
+    });
+
+    // GL への転送はメインスレッドで行う
+    for (size_t j = 0; j < numJobs; j++) uploadJob(jobs[j]);
+}
+
+void Forest::buildJob(Builder& builder, BuildJob& job) {
+    const ForestTree& t = trees[job.tree].desc;
+    // 色相は構築時刻で回るので、種ごとに決めた時刻で作り、同じ木はいつも同じ色にする
+    float time = BranchRng::range(BranchRng::root(t.seed), 0.0f, 12.75f, 1);
+    builder.tree->buildStaticMesh(builder.scratch, t.seed, time, treeLod[job.level], getLevelDepth(t, job.level),
+        t.len, t.thick, t.mutation, t.maxMutation, t.chaosResist, t.bloomLevel, t.type, t.flower);
+
+    // ワールド座標へ変換して詰める（回転と等倍のスケールだけなので、法線は回転だけ掛ける）
+    glm::mat4 rot = glm::rotate(glm::mat4(1.0f), glm::radians(t.rotation), glm::vec3(0, 1, 0));
+    glm::mat4 mat = glm::translate(glm::mat4(1.0f), t.position) * rot * glm::scale(glm::mat4(1.0f), glm::vec3(t.scale));
+    glm::mat3 normalMat(rot);
+    const auto& verts = builder.scratch.getVertices();
+    const auto& normals = builder.scratch.getNormals();
+    const auto& colors = builder.scratch.getColors();
+    job.verts.resize(verts.size());
+    job.boundsMin = job.boundsMax = t.position;
+    for (size_t i = 0; i < verts.size(); i++) {
+        ForestVertex& v = job.verts[i];
+        glm::vec3 p = glm::vec3(mat * glm::vec4(verts[i], 1.0f));
+        glm::vec3 n = normalMat * normals[i];
+        v.pos[0] = p.x;
+        v.pos[1] = p.y;
+        v.pos[2] = p.z;
+        v.normal[0] = toSnorm8(n.x);
+        v.normal[1] = toSnorm8(n.y);
+        v.normal[2] = toSnorm8(n.z);
+        v.normal[3] = 0;
+        const ofFloatColor& c = colors[i];
+        v.color[0] = toUnorm8(c.r);
+        v.color[1] = toUnorm8(c.g);
+        v.color[2] = toUnorm8(c.b);
+        v.color[3] = toUnorm8(c.a);
+        job.boundsMin = glm::min(job.boundsMin, p);
+        job.boundsMax = glm::max(job.boundsMax, p);
+    }
+    const auto& indices = builder.scratch.getIndices();
+    job.indices.assign(indices.begin(), indices.end());
+}
+
+void Forest::uploadJob(BuildJob& job) {
+    Entry& e = trees[job.tree];
+    if (job.level == LEVEL_FAR) {
+        // 形が変わった木は、細かいレベルも古い形なのですべて捨てる
+        for (auto& r : e.levels) freeLevel(r);
+        e.boundsMin = job.boundsMin;
+        e.boundsMax = job.boundsMax;
+        e.bDirty = false;
+    }
+    else {
+        freeLevel(e.levels[job.level]);
+        e.boundsMin = glm::min(e.boundsMin, job.boundsMin);
+        e.boundsMax = glm::max(e.boundsMax, job.boundsMax);
+    }
+
+    // 空きのあるページを先頭から探し、どこにも収まらなければページを足す
+    size_t numVerts = job.verts.size(), numIndices = job.indices.size();
+    size_t vertexOffset = 0, indexOffset = 0;
+    int pageIndex = -1;
+    for (size_t p = 0; p < pages.size() && pageIndex < 0; p++) {
+        if (!pages[p].vertexSpace.alloc(numVerts, vertexOffset)) continue;
+        if (!pages[p].indexSpace.alloc(numIndices, indexOffset)) {
+            pages[p].vertexSpace.free(vertexOffset, numVerts);
+            continue;
+        }
+        pageIndex = (int)p;
+    }
+    if (pageIndex < 0) {
+        pages.emplace_back();
+        Page& page = pages.back();
+        page.vertexCapacity = max(pageVertices, numVerts);
+        page.indexCapacity = max(pageIndices, numIndices);
+        page.vertexBuffer.allocate(page.vertexCapacity * sizeof(ForestVertex), GL_STATIC_DRAW);
+        page.indexBuffer.allocate(page.indexCapacity * sizeof(uint32_t), GL_STATIC_DRAW);
+        page.vertexSpace.reset(page.vertexCapacity);
+        page.indexSpace.reset(page.indexCapacity);
+        page.vertexSpace.alloc(numVerts, vertexOffset);
+        page.indexSpace.alloc(numIndices, indexOffset);
+        pageIndex = (int)pages.size() - 1;
+    }
+
+    // インデックスはページ全体の頂点位置を指すようにずらす
+    Page& page = pages[pageIndex];
+    for (auto& i : job.indices) i += (uint32_t)vertexOffset;
+    page.vertexBuffer.updateData(vertexOffset * sizeof(ForestVertex), numVerts * sizeof(ForestVertex), job.verts.data());
+    page.indexBuffer.updateData(indexOffset * sizeof(uint32_t), numIndices * sizeof(uint32_t), job.indices.data());
+
+    MeshRange& r = e.levels[job.level];
+    r.page = pageIndex;
+    r.firstVertex = vertexOffset;
+    r.numVerts = numVerts;
+    r.firstIndex = indexOffset;
+    r.numIndices = numIndices;
+    r.lastUsedFrame = frame;
+}
+
+void Forest::freeLevel(MeshRange& r) {
+    if (!r.isResident()) return;
+    pages[r.page].vertexSpace.free(r.firstVertex, r.numVerts);
+    pages[r.page].indexSpace.free(r.firstIndex, r.numIndices);
+    r.page = -1;
+}
+
+void Forest::draw() {
+    frame++;
+    numVisible = 0;
+    numDrawCalls = 0;
+    if (trees.empty()) return;
+
+    glm::mat4 modelView = ofGetCurrentMatrix(OF_MATRIX_MODELVIEW);
+    glm::mat4 projection = ofGetCurrentMatrix(OF_MATRIX_PROJECTION);
+    glm::mat4 mvp = projection * modelView;
+    float viewScale = glm::length(glm::vec3(modelView[1]));
+    float pixelScale = projection[1][1] * ofGetViewportHeight() * 0.5f;
+
+    // --- 木ごとの境界箱で視錐台カリングし、外接球の見かけの高さでレベルを選ぶ ---
+    visible.clear();
+    for (size_t i = 0; i < trees.size(); i++) {
+        Entry& e = trees[i];
+        if (!e.levels[LEVEL_FAR].isResident() && !e.levels[LEVEL_MID].isResident() && !e.levels[LEVEL_NEAR].isResident()) continue;
+        if (!isBoxVisible(mvp, e.boundsMin, e.boundsMax)) continue;
+
+        glm::vec4 center = modelView * glm::vec4((e.boundsMin + e.boundsMax) * 0.5f, 1.0f);
+        float r = glm::length(e.boundsMax - e.boundsMin) * 0.5f * viewScale;
+        float dist = -center.z;
+        e.screenSize = (dist > r) ? r * 2.0f * pixelScale / dist : std::numeric_limits<float>::max();
+
+        // 境界付近で行き来しないよう、切り替えの前後で閾値に幅を持たせる（Tree::selectLodLevel と同じ）
+        int lod = e.lodTarget;
+        while (lod > 0 && e.screenSize > lodScreenSize[lod - 1] * (1.0f + lodHysteresis)) lod--;
+        while (lod < NUM_LEVELS - 1 && e.screenSize < lodScreenSize[lod] * (1.0f - lodHysteresis)) lod++;
+        e.lodTarget = lod;
+        visible.push_back(i);
+    }
+    numVisible = (int)visible.size();
+
+    // 細かいレベルの本数は上限までにし、見かけの小さい木から1段粗いレベルへ戻す
+    auto limit = [&](Level level, int maxTrees) {
+        candidates.clear();
+        for (size_t i : visible) {
+            if (trees[i].lodTarget == level) candidates.push_back(i);
+        }
+        if ((int)candidates.size() <= maxTrees) return;
+        nth_element(candidates.begin(), candidates.begin() + maxTrees, candidates.end(),
+            [&](size_t a, size_t b) { return trees[a].screenSize > trees[b].screenSize; });
+        for (size_t k = maxTrees; k < candidates.size(); k++) trees[candidates[k]].lodTarget = level + 1;
+    };
+    limit(LEVEL_NEAR, maxNearTrees);
+    limit(LEVEL_MID, maxMidTrees);
+
+    // --- 描くレベルのインデックス区間をページごとに集める ---
+    // 選んだレベルが未構築の間は、持っている中で最も近い細かさで代用する
+    for (auto& page : pages) {
+        page.drawCounts.clear();
+        page.drawOffsets.clear();
+    }
+    for (size_t i : visible) {
+        Entry& e = trees[i];
+        MeshRange* r = nullptr;
+        for (int l = e.lodTarget; l < NUM_LEVELS && !r; l++) {
+            if (e.levels[l].isResident()) r = &e.levels[l];
+        }
+        for (int l = e.lodTarget - 1; l >= 0 && !r; l--) {
+            if (e.levels[l].isResident()) r = &e.levels[l];
+        }
+        r->lastUsedFrame = frame;
+
+        // 同じページで続いている区間は1つにまとめる
+        Page& page = pages[r->page];
+        const char* offset = (const char*)(r->firstIndex * sizeof(uint32_t));
+        if (!page.drawCounts.empty() && (const char*)page.drawOffsets.back() + page.drawCounts.back() * sizeof(uint32_t) == offset) {
+            page.drawCounts.back() += (GLsizei)r->numIndices;
+        }
+        else {
+            page.drawCounts.push_back((GLsizei)r->numIndices);
+            page.drawOffsets.push_back(offset);
+        }
+    }
+
+    for (auto& page : pages) {
+        if (page.drawCounts.empty()) continue;
+        drawPage(page);
+        numDrawCalls++;
+    }
+}
+
+void Forest::drawPage(Page& page) {
+    // 固定機能の頂点配列で描くので、ライトと頂点色は Tree の ofVboMesh と同じように効く
+    page.vertexBuffer.bind(GL_ARRAY_BUFFER);
+    page.indexBuffer.bind(GL_ELEMENT_ARRAY_BUFFER);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    GLsizei stride = sizeof(ForestVertex);
+    glVertexPointer(3, GL_FLOAT, stride, (const void*)offsetof(ForestVertex, pos));
+    glNormalPointer(GL_BYTE, stride, (const void*)offsetof(ForestVertex, normal));
+    glColorPointer(4, GL_UNSIGNED_BYTE, stride, (const void*)offsetof(ForestVertex, color));
+    glMultiDrawElements(GL_TRIANGLES, page.drawCounts.data(), GL_UNSIGNED_INT, page.drawOffsets.data(), (GLsizei)page.drawCounts.size());
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    page.indexBuffer.unbind(GL_ELEMENT_ARRAY_BUFFER);
+    page.vertexBuffer.unbind(GL_ARRAY_BUFFER);
+}
+
+int Forest::getNumResident(Level level) const {
+    int n = 0;
+    for (auto& e : trees) n += e.levels[level].isResident() ? 1 : 0;
+    return n;
+}
+
+size_t Forest::getMeshBytes() const {
+    size_t bytes = 0;
+    for (auto& page : pages) bytes += page.vertexCapacity * sizeof(ForestVertex) + page.indexCapacity * sizeof(uint32_t);
+    return bytes;
+}
+
+bool Forest::isBuilding() const {
+    for (auto& e : trees) {
+        if (e.bDirty) return true;
+    }
+    return false;
+}
+
+void Forest::RangeAllocator::reset(size_t capacity) {
+    freeRanges.clear();
+    freeRanges[0] = capacity;
+}
+
+bool Forest::RangeAllocator::alloc(size_t count, size_t& offset) {
+    offset = 0;
+    if (count == 0) return true;
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < count) continue;
+        offset = it->first;
+        size_t rest = it->second - count;
+        freeRanges.erase(it);
+        if (rest > 0) freeRanges[offset + count] = rest;
+        return true;
+    }
+    return false;
+}
+
+void Forest::RangeAllocator::free(size_t offset, size_t count) {
+    if (count == 0) return;
+    // 前後の空き区間と隣り合っていれば1つにまとめる
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    freeRanges[offset] = count;
+}
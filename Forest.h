@@ -0,0 +1,147 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "Tree.h"
+#include "GrowthSim.h"
+
+// 森の1本（種・成長タイプ・成長状態と置き場所）
+struct ForestTree {
+    int seed = 0;
+    GrowthType type = TYPE_DEFAULT;
+    FlowerType flower = FLOWER_NONE;
+    int depth = 6;
+    float len = 150.0f, thick = 12.0f;
+    float mutation = 0.0f, maxMutation = 0.0f;
+    int chaosResist = 0, bloomLevel = 0;
+    glm::vec3 position;
+    float rotation = 0.0f;  // Y軸回りの向き（度）
+    float scale = 1.0f;
+
+    bool operator==(const ForestTree& o) const {
+        return seed == o.seed && type == o.type && flower == o.flower && depth == o.depth
+            && len == o.len && thick == o.thick && mutation == o.mutation && maxMutation == o.maxMutation
+            && chaosResist == o.chaosResist && bloomLevel == o.bloomLevel
+            && position == o.position && rotation == o.rotation && scale == o.scale;
+    }
+    bool operator!=(const ForestTree& o) const { return !(*this == o); }
+};
+
+// 多数の木を1つの場面に並べて描く
+// 生成用の Tree はスレッドごとに1つだけ持ち、全ての木の構築で作業領域ごと使い回す
+// 頂点はワールド座標へ変換して大きな共有バッファ（ページ）に詰め、見える木だけをページごとに1回の描画でまとめて描く
+class Forest {
+public:
+    // 木ごとの細かさ。FAR はすべての木が常に持ち、NEAR / MID は画面で大きく見える木にだけ作る
+    enum Level { LEVEL_NEAR, LEVEL_MID, LEVEL_FAR, NUM_LEVELS };
+
+    void setup(const ofJson& config);
+    // GrowthSim で1本ずつ育成を進め、成長状態の異なる木を count 本植える
+    void plant(int count, uint64_t seed);
+    size_t add(const ForestTree& t);
+    void set(size_t i, const ForestTree& t);  // 値が変わった木だけ作り直す
+    const ForestTree& get(size_t i) const { return trees[i].desc; }
+    size_t size() const { return trees.size(); }
+    void clear();
+
+    void update();  // 変わった木・細かさが必要になった木を並列に構築してページへ転送する
+    void draw();    // 見える木の細かさを選び、ページごとにまとめて描く
+
+    float getRadius() const { return radius; }        // 植えた範囲の半径
+    int getNumVisible() const { return numVisible; }  // 直前の描画で見えていた木の数
+    int getNumDrawCalls() const { return numDrawCalls; }
+    int getNumResident(Level level) const;            // そのレベルのメッシュを持っている木の数
+    size_t getMeshBytes() const;                      // ページに確保した頂点・インデックスのバイト数
+    bool isBuilding() const;                          // 構築待ちの木があるか
+
+private:
+    // 1頂点20バイト（位置は float、法線は snorm8、色は RGBA8）
+    struct ForestVertex {
+        float pos[3];
+        int8_t normal[4];
+        uint8_t color[4];
+    };
+
+    // ページ内の空き区間（先頭からの最初に収まる区間を使い、解放時に隣と結合する）
+    class RangeAllocator {
+    public:
+        void reset(size_t capacity);
+        bool alloc(size_t count, size_t& offset);
+        void free(size_t offset, size_t count);
+    private:
+        map<size_t, size_t> freeRanges;  // 先頭 -> 長さ
+    };
+
+    struct Page {
+        ofBufferObject vertexBuffer, indexBuffer;
+        RangeAllocator vertexSpace, indexSpace;
+        size_t vertexCapacity = 0, indexCapacity = 0;
+        vector<GLsizei> drawCounts;         // 描画ごとに集める glMultiDrawElements の引数
+        vector<const void*> drawOffsets;
+    };
+
+    // ページ内に置いた1レベル分のメッシュ
+    struct MeshRange {
+        int page = -1;
+        size_t firstVertex = 0, numVerts = 0;
+        size_t firstIndex = 0, numIndices = 0;
+        unsigned int lastUsedFrame = 0;
+        bool isResident() const { return page >= 0; }
+    };
+
+    struct Entry {
+        ForestTree desc;
+        MeshRange levels[NUM_LEVELS];
+        glm::vec3 boundsMin, boundsMax;     // 持っているレベルを合わせたワールド座標の境界箱
+        int lodTarget = LEVEL_FAR;          // 選ばれているレベル（切り替えの履歴を持つ）
+        float screenSize = 0;               // 直前の描画での見かけの高さ（ピクセル）
+        bool bDirty = true;                 // 値が変わり、FAR から作り直しが必要
+    };
+
+    // 構築1回分。出力の配列は次のフレームの構築でも容量ごと使い回す
+    struct BuildJob {
+        size_t tree;
+        Level level;
+        vector<ForestVertex> verts;
+        vector<uint32_t> indices;
+        glm::vec3 boundsMin, boundsMax;
+    };
+
+    struct Builder {
+        unique_ptr<Tree> tree;
+        ofMesh scratch;
+    };
+
+    void buildJob(Builder& builder, BuildJob& job);
+    void uploadJob(BuildJob& job);
+    void freeLevel(MeshRange& r);
+    int getLevelDepth(const ForestTree& t, Level level) const;
+    int getJobCost(Level level) const;
+    void drawPage(Page& page);
+
+    vector<Entry> trees;
+    vector<Builder> builders;
+    vector<Page> pages;
+    vector<BuildJob> jobs;
+    vector<size_t> visible;         // 直前の描画で見えていた木
+    vector<size_t> candidates;      // 細かいレベルを望む木（上限を超えた分を粗いレベルへ戻す）
+    GrowthConfig growthConfig;
+
+    // --- 設定 (settings.json の "forest") ---
+    float spacing = 320.0f;         // 植える間隔
+    float clearing = 900.0f;        // 中央（プレイヤーの木）に空ける半径
+    float treeScale = 0.15f;        // 育ち切った木は大きいので、森では縮めて並べる
+    float ageMin = 0.6f, ageMax = 1.0f; // 育成を進める日数（最大日数に対する割合）
+    int farDepthDrop = 2;           // FAR は深さをこれだけ減らした木で代用する
+    int treeLod[NUM_LEVELS] = { 0, 2, 2 }; // 各レベルで使う Tree の細かさ (Tree::lodLevels)
+    float lodScreenSize[2] = { 320.0f, 110.0f }; // この高さ（ピクセル）を下回ると MID, FAR
+    float lodHysteresis = 0.15f;
+    int maxNearTrees = 24;          // 同時に NEAR で描く木の上限
+    int maxMidTrees = 160;
+    int keepFrames = 120;           // 使われなくなった NEAR / MID をこのフレーム数だけ残す
+    int buildBudget = 128;          // 1フレームで構築する量（FAR 1本 = 1）
+    size_t pageVertices = 1 << 20;  // 1ページの頂点数
+    size_t pageIndices = 3 << 20;
+
+    float radius = 0;
+    unsigned int frame = 0;
+    int numVisible = 0, numDrawCalls = 0;
+};
@@ -0,0 +1,21 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+
+// 視錐台カリング（Tree のチャンク・Forest の木で共通）
+// 8頂点すべてが同じクリップ面の外側にある箱は見えない
+inline bool isBoxVisible(const glm::mat4& mvp, const glm::vec3& bmin, const glm::vec3& bmax) {
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p((i & 1) ? bmax.x : bmin.x, (i & 2) ? bmax.y : bmin.y, (i & 4) ? bmax.z : bmin.z);
+        corners[i] = mvp * glm::vec4(p, 1.0f);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        bool allBelow = true, allAbove = true;
+        for (auto& c : corners) {
+            allBelow = allBelow && c[axis] < -c.w;
+            allAbove = allAbove && c[axis] > c.w;
+        }
+        if (allBelow || allAbove) return false;
+    }
+    return true;
+}
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+// ゲームの状態を表す列挙型（ofMain.h に依存しないので、窓の無いシミュレーションからも使える）
+enum GrowthType { TYPE_DEFAULT, TYPE_ELEGANT, TYPE_STURDY, TYPE_ELDRITCH };
+enum FlowerType { FLOWER_NONE, FLOWER_CRYSTAL, FLOWER_PETAL, FLOWER_SPIRIT };
+enum CommandType { CMD_WATER, CMD_FERTILIZER, CMD_KOTODAMA };
+enum SkillType { SKILL_GROWTH, SKILL_RESIST, SKILL_CATALYST };
+enum GameTitle { TITLE_NONE, TITLE_ELEGANT_GIANT, TITLE_HERALD_OF_CHAOS, TITLE_GREAT_SPIRIT_TREE };
@@ -3,28 +3,32 @@
 
 class Ground {
 public:
-    void setup() {
-        // KvɉăeNX`̓ǂݍ݂Ȃǂōs
+    void setup(float groundSize = 4000) {
+        // 必要に応じてテクスチャの読み込みなどをここで行う
+        size = groundSize;
     }
 
     void draw() {
         ofPushStyle();
 
-        // ̐FiÂ߂̗ΐFj
+        // 平原の色（少し暗めの緑色）
         ofSetColor(40, 70, 40);
 
         ofPushMatrix();
-        // openFrameworks̃ftHgłPlaneXYʂȂ̂ŁAɂ邽߂X90x]
+        // openFrameworksのデフォルトではPlaneはXY平面なので、床にするためにX軸で90度回転
         ofRotateXDeg(90);
 
-        // \ɑ傫ȕʂ`
-        ofDrawPlane(0, 0, 4000, 4000);
+        // 十分に大きな平面を描画
+        ofDrawPlane(0, 0, size, size);
 
-        // o߂̃Obh
+        // 距離感を出すためのグリッド
         //ofSetColor(50, 80, 50);
         //ofDrawGridPlane(200, 25, false);
 
         ofPopMatrix();
         ofPopStyle();
     }
+
+private:
+    float size = 4000; // 一辺の長さ（森モードでは森全体を覆う大きさにする）
 };
\ No newline at end of file
@@ -0,0 +1,173 @@
+﻿#include "GrowthSim.h"
+#include "BranchRng.h"
+#include <algorithm>
+
+// ============================================================
+// ルール（ofApp / Tree と共有）
+// ============================================================
+void GrowthRules::water(GrowthTargets& g, float buff, int resilienceLevel, float increment) {
+    // デメリット軽減係数 (1レベルにつき15%軽減)
+    float penaltyFactor = 1.0f - (resilienceLevel * 0.15f);
+
+    g.depthExp += 5.0f * buff;
+
+    float lenGain = increment * 2.0f * buff;
+    g.len += lenGain;
+    g.totalLen += lenGain; // 累積加算
+
+    // デメリット（太さ減少）に軽減を適用
+    g.thick = std::max(2.0f, g.thick - (3.0f * penaltyFactor));
+    g.mutation = std::max(0.0f, g.mutation - 0.1f);
+}
+
+void GrowthRules::fertilize(GrowthTargets& g, float buff, int resilienceLevel, float increment) {
+    float penaltyFactor = 1.0f - (resilienceLevel * 0.15f);
+
+    g.depthExp += 5.0f * buff;
+
+    // デメリット（長さ減少）に軽減を適用
+    g.len = std::max(10.0f, g.len - (5.0f * penaltyFactor));
+
+    float thickGain = increment * 2.0f * buff;
+    g.thick += thickGain;
+    g.totalThick += thickGain; // 累積加算
+
+    g.mutation = std::max(0.0f, g.mutation - 0.05f);
+}
+
+void GrowthRules::kotodama(GrowthTargets& g, float buff) {
+    g.depthExp += 5.0f * buff;
+    g.len += 10.0f * buff;
+    g.thick = std::max(2.0f, g.thick - 5.0f);
+
+    float mutGain = 0.2f * buff;
+    g.mutation = std::min(std::max(g.mutation + mutGain, 0.0f), 1.0f);
+    g.totalMutation += mutGain; // 累積加算
+}
+
+GrowthType GrowthRules::chooseGrowthType(float totalLen, float totalThick, float totalMutation) {
+    // 一番多く積み上げたものの方向へ進化する
+    if (totalLen >= totalThick && totalLen >= totalMutation) return TYPE_ELEGANT;
+    if (totalThick >= totalLen && totalThick >= totalMutation) return TYPE_STURDY;
+    return TYPE_ELDRITCH;
+}
+
+FlowerType GrowthRules::chooseFlowerType(GrowthType type) {
+    // 現在の成長タイプに応じて花の形を決定
+    if (type == TYPE_ELEGANT) return FLOWER_CRYSTAL;
+    if (type == TYPE_STURDY) return FLOWER_PETAL;
+    return FLOWER_SPIRIT;
+}
+
+GameTitle GrowthRules::chooseTitle(float len, float maxMutation) {
+    if (len > 200 && maxMutation < 0.3) return TITLE_ELEGANT_GIANT;
+    if (maxMutation > 0.8) return TITLE_HERALD_OF_CHAOS;
+    return TITLE_GREAT_SPIRIT_TREE;
+}
+
+const char* GrowthRules::getTitleName(GameTitle title) {
+    switch (title) {
+    case TITLE_ELEGANT_GIANT: return "Elegant Giant";
+    case TITLE_HERALD_OF_CHAOS: return "Herald of Chaos";
+    case TITLE_GREAT_SPIRIT_TREE: return "Great Spirit Tree";
+    default: return "";
+    }
+}
+
+const char* GrowthRules::getGrowthTypeName(GrowthType type) {
+    static const char* names[] = { "DEFAULT", "ELEGANT", "STURDY", "ELDRITCH" };
+    return names[type];
+}
+
+const char* GrowthRules::getFlowerTypeName(FlowerType type) {
+    static const char* names[] = { "NONE", "CRYSTAL", "PETAL", "SPIRIT" };
+    return names[type];
+}
+
+// ============================================================
+// 1ゲーム分のシミュレーション
+// ============================================================
+void GrowthSim::reset(uint64_t seed) {
+    st = GrowthState();
+    // Tree::reset と同じ範囲のシード（ofRandom ではなく seed から決める）
+    st.treeSeed = (uint32_t)(BranchRng::mix(seed) % 99999);
+}
+
+bool GrowthSim::command(CommandType type) {
+    if (st.ended) return false;
+
+    // ofApp::executeCommand と同じ順に処理する
+    switch (type) {
+    case CMD_WATER: GrowthRules::water(st.targets, 1.0f, st.resilienceLevel, cfg.waterIncrement); break;
+    case CMD_FERTILIZER: GrowthRules::fertilize(st.targets, 1.0f, st.resilienceLevel, cfg.fertilizeIncrement); break;
+    case CMD_KOTODAMA: GrowthRules::kotodama(st.targets, 1.0f); break;
+    }
+    st.commandCounts[type]++;
+
+    st.day = GrowthRules::incrementDay(st.day);
+    checkEvolution();
+    if (st.day % cfg.skillInterval == 0) st.skillPoints++;
+
+    // 次のコマンドまで（クールダウンの間）フレームが進む
+    int frames = std::max(1, cfg.framesPerCommand);
+    for (int i = 0; i < frames; i++) stepFrame();
+    checkBloom();
+    return true;
+}
+
+bool GrowthSim::upgrade(SkillType skill) {
+    int cost = cfg.skillCosts[skill];
+    if (st.skillPoints < cost || st.skillLevels[skill] >= cfg.maxSkillLevel) return false;
+    st.skillLevels[skill]++;
+    st.skillPoints -= cost;
+    checkBloom();
+    return true;
+}
+
+void GrowthSim::stepFrame() {
+    // 終了判定（ofApp::update と同じく、このフレームの補間の前の値で決める）
+    if (st.day >= cfg.maxDays && !st.ended) {
+        st.ended = true;
+        st.title = GrowthRules::chooseTitle(st.len, st.maxMutationReached);
+    }
+
+    // Tree::update の補間 (ofLerp(b, t, 0.1)) と深さの成長
+    st.len = st.len + (st.targets.len - st.len) * 0.1f;
+    st.thick = st.thick + (st.targets.thick - st.thick) * 0.1f;
+    st.mutation = st.mutation + (st.targets.mutation - st.mutation) * 0.1f;
+    st.maxMutationReached = std::max(st.maxMutationReached, st.mutation);
+
+    if (st.depthLevel < cfg.maxDepth && st.targets.depthExp >= GrowthRules::getExpForDepth(st.depthLevel + 1, cfg.expBase, cfg.expPower)) {
+        st.depthLevel++;
+        if (st.depthLevel == cfg.maxDepth) st.maxDepthDay = st.day;
+    }
+}
+
+void GrowthSim::play(const CommandType* commands, int count) {
+    if (count <= 0) return;
+    // 日数は DAY_LIMIT で止まるので、max_days がそれより大きいと終了しない
+    for (int i = 0; !st.ended && st.day < GrowthRules::DAY_LIMIT; i++) {
+        command(commands[i % count]);
+    }
+}
+
+void GrowthSim::checkBloom() {
+    // 目標値で構築する (rescale_glide) ので、補間前の目標の変異度も含めて判定する
+    if (st.bloomDay > 0) return;
+    float maxMutation = std::max(st.maxMutationReached, st.targets.mutation);
+    if (st.flower != FLOWER_NONE || GrowthRules::isBloomed(maxMutation, cfg.bloomThreshold, st.skillLevels[SKILL_CATALYST])) {
+        st.bloomDay = st.day;
+    }
+}
+
+void GrowthSim::checkEvolution() {
+    // 分岐の日にまだデフォルト状態なら、累積値で進化先を決める
+    if (st.day == cfg.evoDayBranch && st.type == TYPE_DEFAULT) {
+        st.type = GrowthRules::chooseGrowthType(st.targets.totalLen, st.targets.totalThick, st.targets.totalMutation);
+        st.typeDay = st.day;
+    }
+    if (st.day == cfg.evoDayBloom && st.flower == FLOWER_NONE) {
+        st.flower = GrowthRules::chooseFlowerType(st.type);
+        st.flowerDay = st.day;
+    }
+}
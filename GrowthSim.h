@@ -0,0 +1,123 @@
+﻿#pragma once
+#include "GameTypes.h"
+#include <cmath>
+#include <cstdint>
+
+// 育成ゲームのルール（コマンド・日数・進化・スキル・称号）を、窓も GL も使わずに進める
+// ofApp / Tree も同じ関数 (GrowthRules) を呼ぶので、ゲーム本体とシミュレーションの結果は一致する
+// 時間はコマンドの間に進むフレーム数で数え、経過時間や ofRandom には依存しない
+
+// settings.json から読むルールの定数
+struct GrowthConfig {
+    int maxDepth = 6;
+    float expBase = 30.0f, expPower = 1.6f;
+    int maxDays = 50;
+    int skillInterval = 5;                  // この日数ごとにスキルポイント +1
+    float waterIncrement = 15.0f, fertilizeIncrement = 8.0f;
+    int evoDayBranch = 20, evoDayBloom = 40;
+    float bloomThreshold = 0.6f;            // 開花に必要な変異度（CATALYST 1レベルにつき 0.05 下がる）
+    int skillCosts[3] = { 1, 1, 1 };        // SkillType の順
+    int maxSkillLevel = 5;
+    int framesPerCommand = 60;              // コマンドの間に進むフレーム数（クールダウン x 60fps）
+
+    // Json は ofJson / nlohmann::json のどちらでもよい
+    template<class Json>
+    void load(const Json& config) {
+        Json t = config.value("tree", Json::object());
+        Json g = config.value("game", Json::object());
+        Json ui = config.value("ui", Json::object());
+        maxDepth = t.value("max_depth", maxDepth);
+        expBase = t.value("depth_exp_base", expBase);
+        expPower = t.value("depth_exp_power", expPower);
+        maxDays = g.value("max_days", maxDays);
+        skillInterval = g.value("skill_interval", skillInterval);
+        waterIncrement = g.value("water_increment", waterIncrement);
+        fertilizeIncrement = g.value("fertilize_increment", fertilizeIncrement);
+        evoDayBranch = g.value("evo_day_branch", evoDayBranch);
+        evoDayBloom = g.value("evo_day_bloom", evoDayBloom);
+        bloomThreshold = g.value("bloom_threshold", bloomThreshold);
+        Json costs = g.value("skill_costs", Json::object());
+        skillCosts[SKILL_GROWTH] = costs.value("growth", skillCosts[SKILL_GROWTH]);
+        skillCosts[SKILL_RESIST] = costs.value("resist", skillCosts[SKILL_RESIST]);
+        skillCosts[SKILL_CATALYST] = costs.value("catalyst", skillCosts[SKILL_CATALYST]);
+        framesPerCommand = (int)std::lround(ui.value("cooldown_time", framesPerCommand / 60.0f) * 60.0f);
+    }
+};
+
+// コマンドで動く目標値と累積値（Tree の tLen / tThick / tMutation / depthExp / total*Earned）
+struct GrowthTargets {
+    float depthExp = 0;
+    float len = 10.0f, thick = 2.0f, mutation = 0;
+    float totalLen = 0, totalThick = 0, totalMutation = 0;
+};
+
+namespace GrowthRules {
+    const int DAY_LIMIT = 50;   // 日数はここで止まる (Tree::incrementDay)
+
+    void water(GrowthTargets& g, float buff, int resilienceLevel, float increment);      // 長さを伸ばし、カオス度を下げる
+    void fertilize(GrowthTargets& g, float buff, int resilienceLevel, float increment);  // 太さを増し、カオス度を下げる
+    void kotodama(GrowthTargets& g, float buff);                                         // カオス度を上げる
+
+    inline float getExpForDepth(int d, float expBase, float expPower) {
+        if (d <= 0) return 0;
+        return expBase * std::pow((float)d, expPower);
+    }
+    inline int incrementDay(int day) { return day < DAY_LIMIT ? day + 1 : day; }
+    // 花の形が決まる前でも、変異度がしきい値を超えれば花が咲く
+    inline bool isBloomed(float maxMutation, float bloomThreshold, int catalystLevel) {
+        return maxMutation > bloomThreshold - (catalystLevel * 0.05f);
+    }
+
+    GrowthType chooseGrowthType(float totalLen, float totalThick, float totalMutation); // 分岐の日の進化先
+    FlowerType chooseFlowerType(GrowthType type);                                      // 開花の日の花の形
+    GameTitle chooseTitle(float len, float maxMutation);                                // 最終日の称号
+    const char* getTitleName(GameTitle title);
+    const char* getGrowthTypeName(GrowthType type);
+    const char* getFlowerTypeName(FlowerType type);
+}
+
+// 1ゲーム分の状態
+struct GrowthState {
+    GrowthTargets targets;
+    float len = 0, thick = 0, mutation = 0; // 目標値へ補間中の現在値 (Tree の bLen / bThick / bMutation)
+    float maxMutationReached = 0;
+    int day = 1;
+    int depthLevel = 0;
+    int skillPoints = 3;
+    int skillLevels[3] = { 0, 0, 0 };       // SkillType の順
+    int resilienceLevel = 0;                // 長さ・太さの副作用の軽減（1レベルにつき15%）
+    GrowthType type = TYPE_DEFAULT;
+    FlowerType flower = FLOWER_NONE;
+    int typeDay = 0, flowerDay = 0;         // 進化・開花した日 (0 = まだ)
+    int maxDepthDay = 0;                    // 最大深度に達した日 (0 = まだ)
+    int bloomDay = 0;                       // 花が咲いた日 (0 = まだ)
+    int commandCounts[3] = { 0, 0, 0 };     // CommandType の順
+    bool ended = false;
+    GameTitle title = TITLE_NONE;
+    uint32_t treeSeed = 0;                  // 木の形のシード (Tree::loadPresetConfig の "seed")
+};
+
+class GrowthSim {
+public:
+    GrowthSim() {}
+    GrowthSim(const GrowthConfig& config) : cfg(config) {}
+
+    void reset(uint64_t seed);
+    bool command(CommandType type);         // 終了後は何もせず false
+    bool upgrade(SkillType skill);          // ポイント不足・上限なら false
+    void stepFrame();                       // ofApp::update 1回分（終了判定と補間・深さの成長）
+    // コマンド列を最後まで（足りなければ先頭から繰り返して）進める
+    void play(const CommandType* commands, int count);
+
+    bool isEnded() const { return st.ended; }
+    const GrowthState& getState() const { return st; }
+    GrowthState& getState() { return st; }
+    const GrowthConfig& getConfig() const { return cfg; }
+
+private:
+    void checkEvolution();
+    void checkBloom();
+
+    GrowthConfig cfg;
+    GrowthState st;
+};
@@ -0,0 +1,161 @@
+﻿#include "MeshCache.h"
+#include <fstream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static size_t alignBlob(size_t offset) { return (offset + 15) & ~(size_t)15; }
+
+bool MeshCache::setup(const string& cacheDir, uint64_t settingsHash) {
+    close();
+    dir = cacheDir;
+
+    // 設定が変わると同じキーでも形が変わりうるので、前回の設定のハッシュと比べる
+    string hashPath = ofFilePath::join(dir, "settings.hash");
+    string stored, current = ofToHex(settingsHash);
+    std::ifstream in(hashPath);
+    if (in) in >> stored;
+    in.close();
+    if (stored != current) {
+        if (ofDirectory::doesDirectoryExist(dir, false)) ofDirectory::removeDirectory(dir, true, false);
+        if (!ofDirectory::createDirectory(dir, false, true)) {
+            ofLogWarning("MeshCache") << "cannot create " << dir;
+            bReady = false;
+            return false;
+        }
+        std::ofstream out(hashPath);
+        out << current;
+    }
+    bReady = true;
+    return true;
+}
+
+string MeshCache::getPath(uint64_t key) const {
+    return ofFilePath::join(dir, ofToHex(key) + ".mesh");
+}
+
+bool MeshCache::open(uint64_t key) {
+    close();
+    if (!bReady || !map(getPath(key))) return false;
+
+    // 途中で切れたファイルや別のキー・版のファイルは使わない
+    Header header;
+    if (mappedSize < sizeof(Header)) { close(); return false; }
+    memcpy(&header, mapped, sizeof(Header));
+    // 区間の数は壊れていると掛け算が桁あふれするので、先にファイルに収まる数かを確かめる
+    if (header.magic != MAGIC || header.version != VERSION || header.key != key
+        || header.numBlobs > (mappedSize - sizeof(Header)) / sizeof(uint64_t)) {
+        close();
+        return false;
+    }
+    size_t offset = sizeof(Header) + header.numBlobs * sizeof(uint64_t);
+    const uint64_t* sizes = (const uint64_t*)(mapped + sizeof(Header));
+    blobs.resize(header.numBlobs);
+    for (size_t i = 0; i < blobs.size(); i++) {
+        offset = alignBlob(offset);
+        if (sizes[i] > mappedSize || offset + sizes[i] > mappedSize) { close(); return false; }
+        blobs[i] = { mapped + offset, (size_t)sizes[i] };
+        offset += sizes[i];
+    }
+    return true;
+}
+
+bool MeshCache::save(uint64_t key, const vector<Blob>& data) {
+    if (!bReady) return false;
+
+    // 書きかけのファイルを読まないよう、一時ファイルに書いてから置き換える
+    string path = getPath(key);
+    string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    Header header = { MAGIC, VERSION, key, data.size() };
+    out.write((const char*)&header, sizeof(Header));
+    for (auto& b : data) {
+        uint64_t bytes = b.bytes;
+        out.write((const char*)&bytes, sizeof(bytes));
+    }
+    size_t offset = sizeof(Header) + data.size() * sizeof(uint64_t);
+    const char zeros[16] = {};
+    for (auto& b : data) {
+        size_t aligned = alignBlob(offset);
+        out.write(zeros, aligned - offset);
+        if (b.bytes > 0) out.write((const char*)b.data, b.bytes);
+        offset = aligned + b.bytes;
+    }
+    out.close();
+    if (!out) {
+        ofFile::removeFile(tmpPath, false);
+        return false;
+    }
+    ofFile::removeFile(path, false);
+    return ofFile::moveFromTo(tmpPath, path, false, true);
+}
+
+#ifdef _WIN32
+bool MeshCache::map(const string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    hFile = file;
+    hMapping = mapping;
+    mapped = (const uint8_t*)view;
+    mappedSize = (size_t)size.QuadPart;
+    return true;
+}
+
+void MeshCache::close() {
+    blobs.clear();
+    if (mapped) UnmapViewOfFile(mapped);
+    if (hMapping) CloseHandle((HANDLE)hMapping);
+    if (hFile) CloseHandle((HANDLE)hFile);
+    mapped = nullptr;
+    mappedSize = 0;
+    hMapping = nullptr;
+    hFile = nullptr;
+}
+#else
+bool MeshCache::map(const string& path) {
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    struct stat st;
+    if (fstat(file, &st) != 0 || st.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED) {
+        ::close(file);
+        return false;
+    }
+    fd = file;
+    mapped = (const uint8_t*)view;
+    mappedSize = (size_t)st.st_size;
+    return true;
+}
+
+void MeshCache::close() {
+    blobs.clear();
+    if (mapped) munmap((void*)mapped, mappedSize);
+    if (fd >= 0) ::close(fd);
+    mapped = nullptr;
+    mappedSize = 0;
+    fd = -1;
+}
+#endif
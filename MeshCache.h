@@ -0,0 +1,61 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 生成済みのメッシュをディスクに保存し、次回はメモリマップして読み込む
+// ファイルは生成条件のハッシュをキーに持ち、settings.json が変わったらキャッシュ全体を捨てる
+class MeshCache {
+public:
+    // 連続したバイト列（配列1つ分）
+    struct Blob {
+        const void* data;
+        size_t bytes;
+    };
+
+    MeshCache() {}
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+    ~MeshCache() { close(); }
+
+    bool setup(const string& dir, uint64_t settingsHash); // 設定のハッシュが前回と違えば中身を消す
+    bool isReady() const { return bReady; }
+
+    bool open(uint64_t key);           // 見つかればメモリマップし、close() まで getBlob で参照できる
+    size_t getNumBlobs() const { return blobs.size(); }
+    Blob getBlob(size_t i) const { return blobs[i]; }
+    void close();
+    bool save(uint64_t key, const vector<Blob>& data);
+
+    // FNV-1a (64bit)
+    static uint64_t hash(const void* data, size_t bytes, uint64_t h = 14695981039346656037ull) {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t i = 0; i < bytes; i++) h = (h ^ p[i]) * 1099511628211ull;
+        return h;
+    }
+    template<class T>
+    static uint64_t hashValue(const T& v, uint64_t h) { return hash(&v, sizeof(T), h); }
+
+private:
+    // ファイル先頭：識別子・形式の版・キー・配列の数。続けて各配列のバイト数、16バイト境界ごとに本体
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t numBlobs;
+    };
+    enum : uint32_t { MAGIC = 0x434d5254, VERSION = 1 }; // "TRMC"
+
+    string getPath(uint64_t key) const;
+    bool map(const string& path);
+
+    string dir;
+    bool bReady = false;
+    vector<Blob> blobs;
+    const uint8_t* mapped = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void* hFile = nullptr;
+    void* hMapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,168 @@
+﻿#include "MeshExporter.h"
+
+static const size_t EXPORT_BUFFER_SIZE = 1 << 16;
+static const size_t GLB_VERTEX_STRIDE = 28;   // 位置 (float x3) + 法線 (float x3) + 色 (RGBA8)
+static const size_t PLY_FACE_SIZE = 13;       // 頂点数 (uchar) + インデックス (uint x3)
+
+bool MeshExporter::getFormatFromPath(const string& path, Format& format) {
+    string ext = ofToLower(ofFilePath::getFileExt(path));
+    if (ext == "glb") format = FORMAT_GLB;
+    else if (ext == "ply") format = FORMAT_PLY;
+    else return false;
+    return true;
+}
+
+bool MeshExporter::begin(const string& path, Format fmt, size_t verts, size_t indices) {
+    format = fmt;
+    numVerts = verts;
+    numIndices = indices;
+    writtenVerts = writtenIndices = 0;
+    float inf = numVerts > 0 ? std::numeric_limits<float>::max() : 0.0f;
+    boundsMin = glm::vec3(inf);
+    boundsMax = glm::vec3(-inf);
+    bFailed = false;
+    vertexRegion.buffer.clear();
+    indexRegion.buffer.clear();
+    vertexRegion.buffer.reserve(EXPORT_BUFFER_SIZE);
+    indexRegion.buffer.reserve(EXPORT_BUFFER_SIZE);
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        ofLogError("MeshExporter") << "cannot open " << path;
+        return false;
+    }
+
+    if (format == FORMAT_PLY) {
+        string header =
+            "ply\n"
+            "format binary_little_endian 1.0\n"
+            "comment 3DFractalTree\n"
+            "element vertex " + ofToString(numVerts) + "\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "property float nx\nproperty float ny\nproperty float nz\n"
+            "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n"
+            "element face " + ofToString(numIndices / 3) + "\n"
+            "property list uchar uint vertex_indices\n"
+            "end_header\n";
+        out.write(header.data(), header.size());
+        vertexRegion.offset = header.size();
+        indexRegion.offset = vertexRegion.offset + (uint64_t)numVerts * GLB_VERTEX_STRIDE;
+    }
+    else {
+        // glTF のバイナリ形式: ヘッダ / JSON チャンク / BIN チャンク（頂点を交互配置 + インデックス）
+        string json = getGltfJson();
+        uint64_t binLength = (uint64_t)numVerts * GLB_VERTEX_STRIDE + (uint64_t)numIndices * 4;
+        uint64_t totalLength = 12 + 8 + json.size() + 8 + binLength;
+        if (totalLength > UINT32_MAX) {
+            ofLogError("MeshExporter") << "mesh is too large for .glb (" << totalLength << " bytes), use .ply";
+            out.close();
+            return false;
+        }
+        uint32_t header[3] = { 0x46546c67, 2, (uint32_t)totalLength }; // "glTF"
+        uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4e4f534a };  // "JSON"
+        uint32_t binChunk[2] = { (uint32_t)binLength, 0x004e4942 };     // "BIN\0"
+        out.write((const char*)header, sizeof(header));
+        out.write((const char*)jsonChunk, sizeof(jsonChunk));
+        jsonOffset = (uint64_t)out.tellp();
+        out.write(json.data(), json.size());
+        out.write((const char*)binChunk, sizeof(binChunk));
+        vertexRegion.offset = (uint64_t)out.tellp();
+        indexRegion.offset = vertexRegion.offset + (uint64_t)numVerts * GLB_VERTEX_STRIDE;
+    }
+    return (bool)out;
+}
+
+void MeshExporter::addVertices(const glm::vec3* verts, const glm::vec3* normals, const ofFloatColor* colors, size_t count) {
+    // どちらの形式も 位置・法線・RGBA8 の順の28バイト
+    for (size_t i = 0; i < count; i++) {
+        uint8_t rgba[4] = {
+            (uint8_t)ofClamp(colors[i].r * 255.0f + 0.5f, 0, 255),
+            (uint8_t)ofClamp(colors[i].g * 255.0f + 0.5f, 0, 255),
+            (uint8_t)ofClamp(colors[i].b * 255.0f + 0.5f, 0, 255),
+            (uint8_t)ofClamp(colors[i].a * 255.0f + 0.5f, 0, 255)
+        };
+        write(vertexRegion, &verts[i], sizeof(glm::vec3));
+        write(vertexRegion, &normals[i], sizeof(glm::vec3));
+        write(vertexRegion, rgba, sizeof(rgba));
+        boundsMin = glm::min(boundsMin, verts[i]);
+        boundsMax = glm::max(boundsMax, verts[i]);
+    }
+    writtenVerts += count;
+}
+
+void MeshExporter::addIndices(const ofIndexType* indices, size_t count, size_t baseVertex) {
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        uint32_t tri[3] = {
+            (uint32_t)(indices[i] + baseVertex),
+            (uint32_t)(indices[i + 1] + baseVertex),
+            (uint32_t)(indices[i + 2] + baseVertex)
+        };
+        if (format == FORMAT_PLY) {
+            uint8_t n = 3;
+            write(indexRegion, &n, 1);
+        }
+        write(indexRegion, tri, sizeof(tri));
+    }
+    writtenIndices += count;
+}
+
+bool MeshExporter::end() {
+    flush(vertexRegion);
+    flush(indexRegion);
+    if (writtenVerts != numVerts || writtenIndices != numIndices) {
+        ofLogError("MeshExporter") << "expected " << numVerts << " vertices / " << numIndices << " indices, got "
+            << writtenVerts << " / " << writtenIndices;
+        bFailed = true;
+    }
+    if (format == FORMAT_GLB && !bFailed) {
+        // POSITION の min/max は必須なので、書き終えてから確定値で上書きする
+        string json = getGltfJson();
+        out.seekp(jsonOffset);
+        out.write(json.data(), json.size());
+    }
+    out.close();
+    return !bFailed && !out.fail();
+}
+
+void MeshExporter::write(Region& r, const void* data, size_t bytes) {
+    const char* p = (const char*)data;
+    r.buffer.insert(r.buffer.end(), p, p + bytes);
+    if (r.buffer.size() >= EXPORT_BUFFER_SIZE) flush(r);
+}
+
+void MeshExporter::flush(Region& r) {
+    if (r.buffer.empty()) return;
+    out.seekp(r.offset);
+    out.write(r.buffer.data(), r.buffer.size());
+    if (!out) bFailed = true;
+    r.offset += r.buffer.size();
+    r.buffer.clear();
+}
+
+string MeshExporter::getGltfJson() const {
+    // JSON は先頭の + を許さないので、正の数は空白で桁を揃える
+    auto vec3 = [](const glm::vec3& v) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "% .7e,% .7e,% .7e", v.x, v.y, v.z);
+        return string(buf);
+    };
+    string n = ofToString(numVerts);
+    string vertexBytes = ofToString((uint64_t)numVerts * GLB_VERTEX_STRIDE);
+    string json =
+        "{\"asset\":{\"version\":\"2.0\",\"generator\":\"3DFractalTree\"},"
+        "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"COLOR_0\":2},\"indices\":3,\"mode\":4}]}],"
+        "\"buffers\":[{\"byteLength\":" + ofToString((uint64_t)numVerts * GLB_VERTEX_STRIDE + (uint64_t)numIndices * 4) + "}],"
+        "\"bufferViews\":["
+        "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + vertexBytes + ",\"byteStride\":" + ofToString(GLB_VERTEX_STRIDE) + ",\"target\":34962},"
+        "{\"buffer\":0,\"byteOffset\":" + vertexBytes + ",\"byteLength\":" + ofToString((uint64_t)numIndices * 4) + ",\"target\":34963}],"
+        "\"accessors\":["
+        "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" + n + ",\"type\":\"VEC3\","
+        "\"min\":[" + vec3(boundsMin) + "],\"max\":[" + vec3(boundsMax) + "]},"
+        "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" + n + ",\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5121,\"normalized\":true,\"count\":" + n + ",\"type\":\"VEC4\"},"
+        "{\"bufferView\":1,\"byteOffset\":0,\"componentType\":5125,\"count\":" + ofToString(numIndices) + ",\"type\":\"SCALAR\"}]}";
+    // チャンクは4バイト境界（JSON は空白で埋める）
+    while (json.size() % 4 != 0) json += ' ';
+    return json;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "ofMain.h"
+#include <fstream>
+
+// メッシュを生成しながら少しずつファイルへ書き出す（全体をメモリに持たない）
+// 頂点数・インデックス数を先に与え、頂点とインデックスはファイル内の別々の区間へ追記する
+class MeshExporter {
+public:
+    enum Format { FORMAT_GLB, FORMAT_PLY };
+
+    static bool getFormatFromPath(const string& path, Format& format); // 拡張子 (.glb / .ply) から判定
+
+    bool begin(const string& path, Format format, size_t numVerts, size_t numIndices);
+    void addVertices(const glm::vec3* verts, const glm::vec3* normals, const ofFloatColor* colors, size_t count);
+    void addIndices(const ofIndexType* indices, size_t count, size_t baseVertex); // 三角形単位で渡す
+    bool end();  // 書き込み失敗や個数の不一致があれば false
+
+private:
+    // ファイル内の書き込み先と、そこへまとめて書くための小さなバッファ
+    struct Region {
+        uint64_t offset = 0;
+        vector<char> buffer;
+    };
+
+    void write(Region& r, const void* data, size_t bytes);
+    void flush(Region& r);
+    string getGltfJson() const;  // 境界の数値は固定幅なので、書き終えてから同じ長さで上書きできる
+
+    std::ofstream out;
+    Format format = FORMAT_GLB;
+    size_t numVerts = 0, numIndices = 0;
+    size_t writtenVerts = 0, writtenIndices = 0;
+    Region vertexRegion, indexRegion;
+    uint64_t jsonOffset = 0;
+    glm::vec3 boundsMin, boundsMax;
+    bool bFailed = false;
+};
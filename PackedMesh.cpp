@@ -0,0 +1,215 @@
+﻿#include "PackedMesh.h"
+
+namespace {
+    // 単位ベクトルを八面体に投影して [-1,1]^2 へ写す
+    glm::vec2 octEncode(glm::vec3 n) {
+        float l1 = abs(n.x) + abs(n.y) + abs(n.z);
+        if (l1 <= 0.0f) return glm::vec2(0, 0);
+        n /= l1;
+        glm::vec2 e(n.x, n.y);
+        if (n.z < 0.0f) {
+            e = glm::vec2((1.0f - abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return e;
+    }
+
+    int16_t toSnorm16(float v) { return (int16_t)roundf(ofClamp(v, -1.0f, 1.0f) * 32767.0f); }
+    uint16_t toUnorm16(float v) { return (uint16_t)roundf(ofClamp(v, 0.0f, 1.0f) * 65535.0f); }
+    uint8_t toUnorm8(float v) { return (uint8_t)roundf(ofClamp(v, 0.0f, 1.0f) * 255.0f); }
+}
+
+bool PackedMesh::setup() {
+    // 固定機能のライト (gl_LightSource) をそのまま使うため GLSL 1.20 で書く
+    bReady = shader.setupShaderFromFile(GL_VERTEX_SHADER, "shaders/packedTree.vert")
+        && shader.setupShaderFromFile(GL_FRAGMENT_SHADER, "shaders/packedTree.frag");
+    if (bReady) {
+        shader.bindAttribute(ATTR_POSITION, "packedPosition");
+        shader.bindAttribute(ATTR_NORMAL, "packedNormal");
+        shader.bindAttribute(ATTR_COLOR, "packedColor");
+        shader.bindAttribute(ATTR_RADIAL, "packedRadial");
+        shader.bindAttribute(ATTR_GROWTH, "packedGrowth");
+        bReady = shader.linkProgram();
+    }
+    if (!bReady) ofLogWarning("PackedMesh") << "shader load failed, falling back to float vertices";
+    return bReady;
+}
+
+void PackedMesh::pack(const ofMesh& mesh, const vector<glm::vec3>& radial, const vector<float>& birth, const vector<glm::vec3>& anchor) {
+    const auto& srcVerts = mesh.getVertices();
+    const auto& srcNormals = mesh.getNormals();
+    const auto& srcColors = mesh.getColors();
+    const auto& srcIndices = mesh.getIndices();
+    numVerts = srcVerts.size();
+    bRadial = radial.size() == numVerts;
+    bGrowth = bRadial && birth.size() == numVerts && anchor.size() == numVerts;
+
+    // --- 位置の量子化範囲 ---
+    glm::vec3 lo(0), hi(0);
+    if (numVerts > 0) lo = hi = srcVerts[0];
+    for (auto& p : srcVerts) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    boundsMin = lo;
+    boundsSize = glm::max(hi - lo, glm::vec3(1e-4f));
+    glm::vec3 invSize = 1.0f / boundsSize;
+
+    // 作業領域は転送の後に手放す（詰め直すのは形が変わったときだけなので、容量を持ち続けない）
+    vector<PackedVertex> verts(numVerts);
+    for (size_t i = 0; i < numVerts; i++) {
+        PackedVertex& v = verts[i];
+        glm::vec3 q = (srcVerts[i] - boundsMin) * invSize;
+        v.pos[0] = toUnorm16(q.x);
+        v.pos[1] = toUnorm16(q.y);
+        v.pos[2] = toUnorm16(q.z);
+        v.pos[3] = 0;
+        glm::vec2 n = octEncode(srcNormals[i]);
+        v.normal[0] = toSnorm16(n.x);
+        v.normal[1] = toSnorm16(n.y);
+        const ofFloatColor& c = srcColors[i];
+        v.color[0] = toUnorm8(c.r);
+        v.color[1] = toUnorm8(c.g);
+        v.color[2] = toUnorm8(c.b);
+        v.color[3] = toUnorm8(c.a);
+    }
+
+    // --- 16bitインデックスへの分割 ---
+    // 枝・葉・花はそれぞれ連続した頂点だけを参照するので、範囲を超えた三角形から新しい単位にする
+    vector<uint16_t> indices(srcIndices.size());
+    chunks.clear();
+    numIndices = 0;
+    Chunk cur = { 0, 0, 0 };
+    bool bOpen = false;
+    for (size_t t = 0; t + 2 < srcIndices.size(); t += 3) {
+        ofIndexType a = srcIndices[t], b = srcIndices[t + 1], c = srcIndices[t + 2];
+        if (a == b && b == c) continue; // 退役して潰された三角形は詰めない
+
+        size_t tLo = min(a, min(b, c));
+        size_t tHi = max(a, max(b, c));
+        if (!bOpen || tLo < cur.baseVertex || tHi - cur.baseVertex > 0xFFFF) {
+            if (bOpen) chunks.push_back(cur);
+            cur = { tLo, numIndices, 0 };
+            bOpen = true;
+        }
+        indices[numIndices++] = (uint16_t)(a - cur.baseVertex);
+        indices[numIndices++] = (uint16_t)(b - cur.baseVertex);
+        indices[numIndices++] = (uint16_t)(c - cur.baseVertex);
+        cur.numIndices += 3;
+    }
+    if (bOpen) chunks.push_back(cur);
+
+    // --- 静止姿勢（軸からのオフセット、スケールインの基点と時刻） ---
+    vector<PackedPose> poses(bRadial ? numVerts : 0);
+    if (bRadial) {
+        radialMax = 1e-4f;
+        for (auto& r : radial) radialMax = max(radialMax, max(abs(r.x), max(abs(r.y), abs(r.z))));
+        // 時刻は最も新しい段を基準に、256秒前までを1/256秒単位で持つ（それより古い段は生え終わっている）
+        birthBase = 0.0f;
+        if (bGrowth) {
+            birthBase = birth.empty() ? 0.0f : *max_element(birth.begin(), birth.end()) - 255.0f;
+        }
+        for (size_t i = 0; i < numVerts; i++) {
+            PackedPose& v = poses[i];
+            glm::vec3 r = radial[i] / radialMax;
+            v.radial[0] = toSnorm16(r.x);
+            v.radial[1] = toSnorm16(r.y);
+            v.radial[2] = toSnorm16(r.z);
+            v.radial[3] = 0;
+            glm::vec3 a = bGrowth ? (anchor[i] - boundsMin) * invSize : glm::vec3(0);
+            v.anchor[0] = toUnorm16(a.x);
+            v.anchor[1] = toUnorm16(a.y);
+            v.anchor[2] = toUnorm16(a.z);
+            v.birth = bGrowth ? (uint16_t)ofClamp(roundf((birth[i] - birthBase) * 256.0f), 0.0f, 65535.0f) : 0;
+        }
+    }
+
+    // --- GPU へ転送（足りないときだけ確保し直す） ---
+    size_t vBytes = numVerts * sizeof(PackedVertex);
+    size_t iBytes = numIndices * sizeof(uint16_t);
+    if (vBytes > vertexCapacity) {
+        vertexBuffer.allocate(vBytes, verts.data(), GL_DYNAMIC_DRAW);
+        vertexCapacity = vBytes;
+    }
+    else if (vBytes > 0) {
+        vertexBuffer.updateData(0, vBytes, verts.data());
+    }
+    if (iBytes > indexCapacity) {
+        indexBuffer.allocate(iBytes, indices.data(), GL_DYNAMIC_DRAW);
+        indexCapacity = iBytes;
+    }
+    else if (iBytes > 0) {
+        indexBuffer.updateData(0, iBytes, indices.data());
+    }
+    size_t pBytes = poses.size() * sizeof(PackedPose);
+    if (pBytes > poseCapacity) {
+        poseBuffer.allocate(pBytes, poses.data(), GL_DYNAMIC_DRAW);
+        poseCapacity = pBytes;
+    }
+    else if (pBytes > 0) {
+        poseBuffer.updateData(0, pBytes, poses.data());
+    }
+}
+
+void PackedMesh::draw(const RestPoseMesh::Pose& pose) const {
+    if (!bReady || chunks.empty()) return;
+
+    shader.begin();
+    shader.setUniform3f("boundsMin", boundsMin);
+    shader.setUniform3f("boundsSize", boundsSize);
+    // 姿勢の属性が無いときは比率・スケールインを掛けない（属性は既定値の0になる）
+    shader.setUniform1f("radialMax", radialMax);
+    shader.setUniform1f("lenScale", bRadial ? pose.lenK : 1.0f);
+    shader.setUniform1f("thickScale", bRadial ? pose.thickK : 1.0f);
+    shader.setUniform1f("time", pose.time - birthBase);
+    shader.setUniform1f("growthDuration", bGrowth ? pose.growthDuration : 0.0f);
+
+    vertexBuffer.bind(GL_ARRAY_BUFFER);
+    indexBuffer.bind(GL_ELEMENT_ARRAY_BUFFER);
+    glEnableVertexAttribArray(ATTR_POSITION);
+    glEnableVertexAttribArray(ATTR_NORMAL);
+    glEnableVertexAttribArray(ATTR_COLOR);
+    if (bRadial) {
+        glEnableVertexAttribArray(ATTR_RADIAL);
+        glEnableVertexAttribArray(ATTR_GROWTH);
+    }
+    else {
+        glVertexAttrib4f(ATTR_RADIAL, 0, 0, 0, 0);
+        glVertexAttrib4f(ATTR_GROWTH, 0, 0, 0, 0);
+    }
+
+    GLsizei stride = sizeof(PackedVertex);
+    for (auto& chunk : chunks) {
+        // 単位ごとに頂点属性の先頭をずらし、インデックスは単位内の相対値で引く
+        size_t base = chunk.baseVertex * sizeof(PackedVertex);
+        glVertexAttribPointer(ATTR_POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void*)(base + offsetof(PackedVertex, pos)));
+        glVertexAttribPointer(ATTR_NORMAL, 2, GL_SHORT, GL_TRUE, stride, (const void*)(base + offsetof(PackedVertex, normal)));
+        glVertexAttribPointer(ATTR_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*)(base + offsetof(PackedVertex, color)));
+        if (bRadial) {
+            // 姿勢は別のバッファなので、同じ頂点の先頭を指すように切り替える
+            size_t poseBase = chunk.baseVertex * sizeof(PackedPose);
+            poseBuffer.bind(GL_ARRAY_BUFFER);
+            glVertexAttribPointer(ATTR_RADIAL, 4, GL_SHORT, GL_TRUE, sizeof(PackedPose), (const void*)(poseBase + offsetof(PackedPose, radial)));
+            glVertexAttribPointer(ATTR_GROWTH, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedPose), (const void*)(poseBase + offsetof(PackedPose, anchor)));
+            vertexBuffer.bind(GL_ARRAY_BUFFER);
+        }
+        glDrawElements(GL_TRIANGLES, (GLsizei)chunk.numIndices, GL_UNSIGNED_SHORT, (const void*)(chunk.firstIndex * sizeof(uint16_t)));
+    }
+
+    glDisableVertexAttribArray(ATTR_POSITION);
+    glDisableVertexAttribArray(ATTR_NORMAL);
+    glDisableVertexAttribArray(ATTR_COLOR);
+    if (bRadial) {
+        glDisableVertexAttribArray(ATTR_RADIAL);
+        glDisableVertexAttribArray(ATTR_GROWTH);
+    }
+    indexBuffer.unbind(GL_ELEMENT_ARRAY_BUFFER);
+    vertexBuffer.unbind(GL_ARRAY_BUFFER);
+    shader.end();
+}
+
+size_t PackedMesh::getNumBytes() const {
+    size_t bytes = numVerts * sizeof(PackedVertex) + numIndices * sizeof(uint16_t);
+    if (bRadial) bytes += numVerts * sizeof(PackedPose);
+    return bytes;
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "RestPoseMesh.h"
+
+// 木のメッシュを GPU 向けに詰めた形式（1頂点16バイト・16bitインデックス）
+// 位置はバウンディングボックス内で16bit量子化、法線は八面体エンコード、色は RGBA8
+// 補間中の長さ・太さの比率と新しい段のスケールインは、RestPoseMesh と同じく頂点シェーダで掛ける
+// （静止姿勢の属性を渡したときだけ、1頂点16バイトの姿勢ストリームを足す）
+class PackedMesh {
+public:
+    bool setup();                    // シェーダの読み込み（失敗時は通常の描画へ戻す）
+    // 量子化して GPU へ転送する（形が変わったときだけ）。radial, birth, anchor は空でもよい
+    void pack(const ofMesh& mesh, const vector<glm::vec3>& radial, const vector<float>& birth, const vector<glm::vec3>& anchor);
+    void draw(const RestPoseMesh::Pose& pose) const;
+    bool isReady() const { return bReady; }
+    size_t getNumBytes() const;
+
+private:
+    struct PackedVertex {
+        uint16_t pos[4];     // バウンディングボックス内の位置 (unorm16, w は未使用)
+        int16_t normal[2];   // 八面体エンコードした法線 (snorm16)
+        uint8_t color[4];    // RGBA8
+    };
+    struct PackedPose {
+        int16_t radial[4];   // 軸からのオフセット / radialMax (snorm16, w は未使用)
+        uint16_t anchor[3];  // スケールインの基点（位置と同じ量子化）
+        uint16_t birth;      // 生えた時刻 - birthBase (1/256秒単位)
+    };
+
+    // 16bitインデックスで参照できる範囲ごとの描画単位
+    struct Chunk {
+        size_t baseVertex;
+        size_t firstIndex, numIndices;
+    };
+
+    enum { ATTR_POSITION = 0, ATTR_NORMAL = 1, ATTR_COLOR = 2, ATTR_RADIAL = 3, ATTR_GROWTH = 4 };
+
+    vector<Chunk> chunks;
+    size_t numVerts = 0, numIndices = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0, poseCapacity = 0; // GPU バッファの確保済みバイト数
+    bool bRadial = false, bGrowth = false;
+
+    glm::vec3 boundsMin, boundsSize;
+    float radialMax = 1.0f, birthBase = 0.0f;
+    ofBufferObject vertexBuffer, indexBuffer, poseBuffer;
+    ofShader shader;
+    bool bReady = false;
+};
@@ -1,29 +0,0 @@
-﻿#pragma once
-#include "ofMain.h"
-
-class Particle {
-public:
-    glm::vec3 pos, vel;
-    ofColor color;
-    float life = 1.0f;
-    float decay;
-
-    void setup(glm::vec3 p, glm::vec3 v, ofColor c) {
-        pos = p;
-        vel = v;
-        color = c;
-        life = 1.0f;
-        decay = ofRandom(0.01f, 0.03f); // 約1〜3秒で消滅
-    }
-
-    void update(float dt) {
-        pos += vel * (dt * 60.0f);
-        life -= decay * (dt * 60.0f);
-    }
-
-    void draw() {
-        // 寿命に応じて透明度とサイズを下げる
-        ofSetColor(color, life * 255);
-        ofDrawSphere(pos, 2.0f * life);
-    }
-};
\ No newline at end of file
@@ -0,0 +1,104 @@
+﻿#include "ParticleBatch2D.h"
+#include "WorkerPool.h"
+
+bool ParticleBatch2D::setup() {
+    bReady = shader.setupShaderFromFile(GL_VERTEX_SHADER, "shaders/particle2D.vert")
+        && shader.setupShaderFromFile(GL_FRAGMENT_SHADER, "shaders/particle2D.frag");
+    if (bReady) {
+        shader.bindAttribute(ATTR_SHAPE, "shape");
+        shader.bindAttribute(ATTR_STROKE, "stroke");
+        bReady = shader.linkProgram();
+    }
+    if (!bReady) ofLogWarning("ParticleBatch2D") << "shader load failed, falling back to immediate-mode shapes";
+    return bReady;
+}
+
+void ParticleBatch2D::addCircle(const glm::vec2& center, float radius, const ofFloatColor& color) {
+    shapes.push_back({ center, glm::vec2(radius), 0.0f, color });
+}
+
+void ParticleBatch2D::addRing(const glm::vec2& center, const glm::vec2& radius, float stroke, const ofFloatColor& color) {
+    shapes.push_back({ center, radius, stroke, color });
+}
+
+void ParticleBatch2D::draw() {
+    if (shapes.empty()) return;
+
+    if (!bReady) {
+        ofPushStyle();
+        for (auto& s : shapes) {
+            ofSetColor(s.color);
+            if (s.stroke > 0) {
+                ofNoFill();
+                ofSetLineWidth(s.stroke);
+                ofDrawEllipse(s.center, s.radius.x * 2, s.radius.y * 2);
+            }
+            else {
+                ofFill();
+                ofDrawCircle(s.center, s.radius.x);
+            }
+        }
+        ofPopStyle();
+        return;
+    }
+
+    // 1つの形 = 輪の線幅とアンチエイリアスの1ピクセル分だけ広げた四角形
+    // 頂点の書き出しは形の数に比例して重くなるので、区間ごとにワーカースレッドへ配る
+    // GPU バッファは形の数を2のべき乗に切り上げて確保し、数が少しずつ増えるたびに確保し直さない
+    size_t numVerts = shapes.size() * 4;
+    bool bGrow = numVerts > vboVerts;
+    if (bGrow) {
+        size_t capShapes = MIN_SHAPES;
+        while (capShapes < shapes.size()) capShapes *= 2;
+        vboVerts = capShapes * 4;
+    }
+    verts.resize(vboVerts);
+    colors.resize(vboVerts);
+    shapeAttr.resize(vboVerts);
+    strokeAttr.resize(vboVerts);
+    size_t numChunks = (shapes.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    WorkerPool::shared().parallelFor(numChunks, [&](size_t chunk) {
+        const glm::vec2 corners[4] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        size_t last = std::min(shapes.size(), (chunk + 1) * CHUNK_SIZE);
+        for (size_t i = chunk * CHUNK_SIZE; i < last; i++) {
+            const Shape& s = shapes[i];
+            glm::vec2 half = s.radius + glm::vec2(s.stroke * 0.5f + 1.0f);
+            for (int c = 0; c < 4; c++) {
+                size_t v = i * 4 + c;
+                glm::vec2 offset = corners[c] * half;
+                verts[v] = glm::vec3(s.center + offset, 0.0f);
+                colors[v] = s.color;
+                shapeAttr[v] = glm::vec4(offset.x, offset.y, s.radius.x, s.radius.y);
+                strokeAttr[v] = s.stroke;
+            }
+        }
+    });
+
+    // インデックスは並びが固定なので、確保し直すときに容量分まとめて作り足す
+    size_t numIndices = shapes.size() * 6;
+    if (bGrow) {
+        size_t capShapes = vboVerts / 4;
+        size_t first = indices.size() / 6;
+        indices.resize(capShapes * 6);
+        for (size_t i = first; i < capShapes; i++) {
+            ofIndexType b = (ofIndexType)(i * 4);
+            ofIndexType quad[6] = { b, (ofIndexType)(b + 1), (ofIndexType)(b + 2), b, (ofIndexType)(b + 2), (ofIndexType)(b + 3) };
+            std::copy(quad, quad + 6, indices.begin() + i * 6);
+        }
+        vbo.setVertexData(verts.data(), (int)vboVerts, GL_STREAM_DRAW);
+        vbo.setColorData(colors.data(), (int)vboVerts, GL_STREAM_DRAW);
+        vbo.setAttributeData(ATTR_SHAPE, &shapeAttr[0].x, 4, (int)vboVerts, GL_STREAM_DRAW);
+        vbo.setAttributeData(ATTR_STROKE, strokeAttr.data(), 1, (int)vboVerts, GL_STREAM_DRAW);
+        vbo.setIndexData(indices.data(), (int)indices.size(), GL_STATIC_DRAW);
+    }
+    else {
+        vbo.updateVertexData(verts.data(), (int)numVerts);
+        vbo.updateColorData(colors.data(), (int)numVerts);
+        vbo.updateAttributeData(ATTR_SHAPE, &shapeAttr[0].x, (int)numVerts);
+        vbo.updateAttributeData(ATTR_STROKE, strokeAttr.data(), (int)numVerts);
+    }
+
+    shader.begin();
+    vbo.drawElements(GL_TRIANGLES, (int)numIndices);
+    shader.end();
+}
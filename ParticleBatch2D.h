@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 2D パーティクルの円・楕円の輪を1パス分ためて、四角形のメッシュ1つを1回の描画で描く
+// 形は四角形ごとの中心からのオフセットと半径をフラグメントシェーダへ渡し、円（輪）の内側かを解析的に求める
+class ParticleBatch2D {
+public:
+    bool setup();                   // シェーダの読み込み（失敗時は1つずつ描く）
+    void clear() { shapes.clear(); }
+    void addCircle(const glm::vec2& center, float radius, const ofFloatColor& color);
+    // 楕円の輪（radius は x, y 方向の半径、stroke は線幅のピクセル数）
+    void addRing(const glm::vec2& center, const glm::vec2& radius, float stroke, const ofFloatColor& color);
+    void draw();
+    size_t size() const { return shapes.size(); }
+
+private:
+    enum { ATTR_SHAPE = 4, ATTR_STROKE = 5 };  // 0〜3 は ofVbo の既定属性が使う
+    enum { CHUNK_SIZE = 4096 };                // 頂点の書き出しで1スレッドが受け持つ形の数
+    enum { MIN_SHAPES = 256 };                 // GPU バッファに最初に確保する形の数
+
+    struct Shape {
+        glm::vec2 center, radius;
+        float stroke;               // 0 なら塗りつぶし
+        ofFloatColor color;
+    };
+
+    vector<Shape> shapes;
+    vector<glm::vec3> verts;        // 転送用の作業領域（GPU バッファと同じ数だけ持ち、使い回す）
+    vector<ofFloatColor> colors;
+    vector<glm::vec4> shapeAttr;    // 中心からのオフセット, 半径
+    vector<float> strokeAttr;
+    vector<ofIndexType> indices;
+    size_t vboVerts = 0;            // GPU バッファに確保済みの頂点数（形の数の2のべき乗 x 4）
+    ofVbo vbo;
+    ofShader shader;
+    bool bReady = false;
+};
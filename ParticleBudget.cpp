@@ -0,0 +1,86 @@
+﻿#include "ParticleBudget.h"
+
+namespace {
+    const char* TYPE_KEYS[] = { "water", "fertilizer", "kotodama", "rain_splash", "bloom" };
+    const char* TYPE_LABELS[] = { "W", "F", "K", "R", "B" };
+    const int MIN_SAMPLE = 32;      // これより少ない粒数の計測は誤差が大きいので平均に入れない
+}
+
+void ParticleBudget::setup(const ofJson& config) {
+    auto b = config["effects"]["particles"].value("budget", ofJson::object());
+    frameMs = b.value("frame_ms", frameMs);
+    targetFrameMs = b.value("target_frame_ms", targetFrameMs);
+    maxTotal = b.value("max_total", maxTotal);
+    minScale = b.value("min_scale", minScale);
+    minLife = b.value("min_life", minLife);
+    minSize = b.value("min_size", minSize);
+    adaptSpeed = b.value("adapt_speed", adaptSpeed);
+    auto caps = b.value("max_per_type", ofJson::object());
+    for (int t = 0; t < NUM_TYPES; t++) stats[t].maxCount = caps.value(TYPE_KEYS[t], stats[t].maxCount);
+}
+
+void ParticleBudget::update(float frameTime, const ParticleSystem2D& particles, uint64_t batchMicros) {
+    // 1粒あたりの時間：種類ごとの更新と batch へためる時間に、GPU へ送る時間を粒数で按分して足す
+    size_t total = particles.size();
+    particleMs = 0;
+    for (int t = 0; t < NUM_TYPES; t++) {
+        TypeStat& s = stats[t];
+        size_t count = particles.size((ParticleType)t);
+        if (count >= MIN_SAMPLE) {
+            float micros = particles.getUpdateMicros((ParticleType)t) + particles.getDrawMicros((ParticleType)t)
+                + (float)batchMicros * count / total;
+            float sample = micros / count;
+            s.costMicros = (s.costMicros == 0) ? sample : ofLerp(s.costMicros, sample, 0.1f);
+        }
+        particleMs += s.costMicros * count * 0.001f;
+    }
+
+    // 予算に対する超過：パーティクル自身の時間と、パーティクルが効いているときのフレーム時間の遅れの大きい方
+    // （CPU の計測では GPU の塗りの重さが見えないので、フレーム時間で補う）
+    lastFrameMs = frameTime * 1000.0f;
+    pressure = particleMs / frameMs;
+    if (particleMs > frameMs * 0.25f) pressure = std::max(pressure, lastFrameMs / targetFrameMs);
+
+    float target = scale;
+    if (pressure > 1.0f) target = std::max(minScale, scale / pressure);
+    else if (pressure < 0.8f) target = 1.0f;
+    scale = ofLerp(scale, target, 1.0f - expf(-adaptSpeed * frameTime));
+
+    windowTime += frameTime;
+    if (windowTime >= 1.0f) {
+        for (auto& s : stats) {
+            s.lastRequested = s.requested;
+            s.lastSpawned = s.spawned;
+            s.requested = s.spawned = 0;
+        }
+        windowTime = 0;
+    }
+}
+
+int ParticleBudget::getSpawnCount(ParticleType type, int requested, const ParticleSystem2D& particles) {
+    // 端数は確率で切り上げる（1つずつ出る雨の波紋も縮小率の割合で間引かれる）
+    float scaled = requested * scale;
+    int count = (int)scaled;
+    if (ofRandom(1.0f) < scaled - count) count++;
+
+    TypeStat& s = stats[type];
+    int typeRoom = s.maxCount - (int)particles.size(type);
+    int totalRoom = maxTotal - (int)particles.size();
+    count = std::max(0, std::min(count, std::min(typeRoom, totalRoom)));
+    s.requested += requested;
+    s.spawned += count;
+    return count;
+}
+
+string ParticleBudget::getReport(const ParticleSystem2D& particles) const {
+    string r = "Particle Budget: x" + ofToString(scale, 2) + " (" + ofToString(particleMs, 2) + " / " + ofToString(frameMs, 1)
+        + " ms, frame " + ofToString(lastFrameMs, 1) + " ms)\n";
+    string live = "Live: ", cost = "Cost ns/p:", dropped = "Dropped/s:";
+    for (int t = 0; t < NUM_TYPES; t++) {
+        const TypeStat& s = stats[t];
+        live += string(TYPE_LABELS[t]) + " " + ofToString(particles.size((ParticleType)t)) + "/" + ofToString(s.maxCount) + " ";
+        cost += string(" ") + TYPE_LABELS[t] + " " + ofToString((int)(s.costMicros * 1000.0f));
+        dropped += string(" ") + TYPE_LABELS[t] + " " + ofToString(s.lastRequested - s.lastSpawned);
+    }
+    return r + live + "\n" + cost + "\n" + dropped + "\n";
+}
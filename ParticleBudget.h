@@ -0,0 +1,45 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "Constants.h"
+#include "ParticleSystem2D.h"
+
+// 2D パーティクルの数と処理時間の上限
+// 種類ごとに1粒あたりの更新・描画時間を実測し、全体と種類ごとの上限を守りながら、
+// 時間が予算を超えているときは縮小率を下げて、生成数・寿命・大きさをなめらかに減らす
+class ParticleBudget {
+public:
+    void setup(const ofJson& config);
+    // 1フレーム分の計測値（batchMicros は ParticleBatch2D の描画時間）を反映して縮小率を更新する
+    void update(float frameTime, const ParticleSystem2D& particles, uint64_t batchMicros);
+    // 生成を要求された数のうち、実際に出してよい数
+    int getSpawnCount(ParticleType type, int requested, const ParticleSystem2D& particles);
+    float getDecayScale() const { return 1.0f / ofLerp(minLife, 1.0f, scale); } // 寿命を縮める（減り方を速める）
+    float getSizeScale() const { return ofLerp(minSize, 1.0f, scale); }
+    float getScale() const { return scale; }
+    string getReport(const ParticleSystem2D& particles) const; // デバッグ表示用の判断の内訳
+
+private:
+    enum { NUM_TYPES = P_BLOOM + 1 };
+
+    struct TypeStat {
+        int maxCount = 4000;          // 同時に存在できる数
+        float costMicros = 0;         // 1粒あたりの更新＋描画時間（指数移動平均）
+        int requested = 0, spawned = 0; // 直近1秒の生成要求数と実際の生成数
+        int lastRequested = 0, lastSpawned = 0;
+    };
+
+    TypeStat stats[NUM_TYPES];
+    float scale = 1.0f;               // 生成数・寿命・大きさの縮小率 (minScale〜1)
+    float particleMs = 0;             // 見積もった現在の処理時間
+    float pressure = 0;               // 予算に対する超過の割合（1 を超えると縮小する）
+    float lastFrameMs = 0;
+    float windowTime = 0;
+
+    // --- 設定 (settings.json の "effects.particles.budget") ---
+    float frameMs = 2.0f;             // 2D パーティクルに使ってよい1フレームの時間
+    float targetFrameMs = 20.0f;      // これより遅いフレームが続くときも縮小する
+    int maxTotal = 20000;
+    float minScale = 0.1f;
+    float minLife = 0.5f, minSize = 0.7f; // 縮小率が最小のときの寿命・大きさの倍率
+    float adaptSpeed = 2.0f;          // 縮小率が目標に近づく速さ (1/s)
+};
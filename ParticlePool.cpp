@@ -0,0 +1,88 @@
+﻿#include "ParticlePool.h"
+
+#include "SimdUtil.h"
+
+using SimdUtil::addScaled;
+
+void ParticlePool::setup(size_t capacity) {
+    pos.assign(capacity * 3, 0.0f);
+    vel.assign(capacity * 3, 0.0f);
+    life.assign(capacity, 0.0f);
+    decay.assign(capacity, 0.0f);
+    colors.assign(capacity, ofFloatColor());
+    count = 0;
+
+    int n = (int)capacity;
+    vbo.setVertexData(reinterpret_cast<const glm::vec3*>(pos.data()), n, GL_STREAM_DRAW);
+    vbo.setColorData(colors.data(), n, GL_STREAM_DRAW);
+    vbo.setAttributeData(ATTR_LIFE, life.data(), 1, n, GL_STREAM_DRAW);
+
+    bReady = shader.setupShaderFromFile(GL_VERTEX_SHADER, "shaders/particleSprite.vert")
+        && shader.setupShaderFromFile(GL_FRAGMENT_SHADER, "shaders/particleSprite.frag");
+    if (bReady) {
+        shader.bindAttribute(ATTR_LIFE, "particleLife");
+        bReady = shader.linkProgram();
+    }
+    if (!bReady) ofLogWarning("ParticlePool") << "shader load failed, falling back to fixed-size points";
+}
+
+bool ParticlePool::spawn(const glm::vec3& p, const glm::vec3& v, const ofFloatColor& color, float d) {
+    if (count >= life.size()) return false;
+    size_t i = count++;
+    pos[i * 3] = p.x; pos[i * 3 + 1] = p.y; pos[i * 3 + 2] = p.z;
+    vel[i * 3] = v.x; vel[i * 3 + 1] = v.y; vel[i * 3 + 2] = v.z;
+    life[i] = 1.0f;
+    decay[i] = d;
+    colors[i] = color;
+    return true;
+}
+
+void ParticlePool::update(float dt) {
+    float k = dt * 60.0f;
+    addScaled(pos.data(), vel.data(), k, count * 3);
+    addScaled(life.data(), decay.data(), -k, count);
+
+    // 寿命が尽きた粒子は末尾の粒子で埋める（順番は保たない）
+    count = SimdUtil::removeDead(life.data(), count, [this](size_t i, size_t last) {
+        for (int c = 0; c < 3; c++) {
+            pos[i * 3 + c] = pos[last * 3 + c];
+            vel[i * 3 + c] = vel[last * 3 + c];
+        }
+        life[i] = life[last];
+        decay[i] = decay[last];
+        colors[i] = colors[last];
+    });
+}
+
+void ParticlePool::draw(float radius) {
+    if (count == 0) return;
+    int n = (int)count;
+    vbo.updateVertexData(reinterpret_cast<const glm::vec3*>(pos.data()), n);
+    if (bReady) {
+        vbo.updateColorData(colors.data(), n);
+    }
+    else {
+        // シェーダが無いときは寿命による透明度をここで掛ける
+        fadedColors.resize(count);
+        for (size_t i = 0; i < count; i++) fadedColors[i] = ofFloatColor(colors[i], colors[i].a * life[i]);
+        vbo.updateColorData(fadedColors.data(), n);
+    }
+    vbo.updateAttributeData(ATTR_LIFE, life.data(), n);
+
+    if (bReady) {
+        // 点の大きさは頂点シェーダで距離から求め、円の内側を球として陰影付けする
+        glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        ofEnablePointSprites();
+        shader.begin();
+        shader.setUniform1f("radius", radius);
+        shader.setUniform1f("viewportHeight", ofGetCurrentViewport().height);
+        vbo.draw(GL_POINTS, 0, n);
+        shader.end();
+        ofDisablePointSprites();
+        glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    }
+    else {
+        glPointSize(radius * 2.0f);
+        vbo.draw(GL_POINTS, 0, n);
+    }
+}
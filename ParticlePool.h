@@ -0,0 +1,30 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 3D パーティクルを固定容量の配列（SoA）で持ち、1回の描画（ポイントスプライト）で描く
+// 位置・速度は xyz を並べた float 配列なので、更新は要素の区別なく4つずつ SSE で進められ、そのまま VBO へ転送できる
+// 消えた粒子は末尾の粒子で埋めるため、配列をずらすことも確保し直すこともない
+class ParticlePool {
+public:
+    void setup(size_t capacity);
+    // 満杯なら追加せず false を返す
+    bool spawn(const glm::vec3& pos, const glm::vec3& vel, const ofFloatColor& color, float decay);
+    void update(float dt);
+    void draw(float radius);  // radius は寿命1のときの球の半径（寿命に比例して小さくなる）
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    size_t getCapacity() const { return life.size(); }
+
+private:
+    enum { ATTR_LIFE = 4 };  // 0〜3 は ofVbo の既定属性が使う
+
+    vector<float> pos, vel;         // x, y, z の順に3つずつ
+    vector<float> life, decay;
+    vector<ofFloatColor> colors;
+    vector<ofFloatColor> fadedColors; // シェーダが無いときの寿命を掛けた色
+    size_t count = 0;
+
+    ofVbo vbo;                      // 容量分を setup で確保し、描画ごとに生きている区間だけ書き換える
+    ofShader shader;
+    bool bReady = false;
+};
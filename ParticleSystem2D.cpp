@@ -0,0 +1,196 @@
+﻿#include "ParticleSystem2D.h"
+#include "WorkerPool.h"
+#include "SimdUtil.h"
+
+using SimdUtil::addScaled;
+
+namespace {
+    // sin, cos を象限で折り返し、±π/4 の多項式で求める（SSE 版と同じ式）
+    inline void sinCos(float x, float& s, float& c) {
+        int q = (int)lrintf(x * 0.63661977f);
+        float r = x - q * 1.5707963705062866f - q * -4.371139e-8f;
+        float r2 = r * r;
+        float ps = r + r * r2 * (-1.0f / 6 + r2 * (1.0f / 120 + r2 * (-1.0f / 5040)));
+        float pc = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24 + r2 * (-1.0f / 720 + r2 * (1.0f / 40320))));
+        s = (q & 1) ? pc : ps;
+        c = (q & 1) ? ps : pc;
+        if (q & 2) s = -s;
+        if ((q + 1) & 2) c = -c;
+    }
+
+#ifdef SIMD_SSE2
+    inline __m128 poly(__m128 x, float c0, float c1) { return _mm_add_ps(_mm_set1_ps(c0), _mm_mul_ps(x, _mm_set1_ps(c1))); }
+    inline __m128 poly(__m128 x, float c0, __m128 rest) { return _mm_add_ps(_mm_set1_ps(c0), _mm_mul_ps(x, rest)); }
+
+    void sinCos4(__m128 x, __m128& s, __m128& c) {
+        __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977f)));
+        __m128 qf = _mm_cvtepi32_ps(q);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5707963705062866f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(-4.371139e-8f)));
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), poly(r2, -1.0f / 6, poly(r2, 1.0f / 120, -1.0f / 5040))));
+        __m128 pc = poly(r2, 1.0f, poly(r2, -0.5f, poly(r2, 1.0f / 24, poly(r2, -1.0f / 720, 1.0f / 40320))));
+
+        // 奇数象限は sin と cos を入れ替え、符号ビットを直接反転する
+        __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+        __m128 sv = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+        __m128 cv = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+        s = _mm_xor_ps(sv, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30)));
+        c = _mm_xor_ps(cv, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30)));
+    }
+#endif
+
+    // 吸い込まれる螺旋：寿命 (1 -> 0) に比例して半径を縮め、大きさは 25 -> 2 に粒ごとの倍率を掛ける
+    void updateSpiral(float* px, float* py, float* angle, float* size, const float* sizeScale, const float* spiral, const float* life, const float* vx,
+                      size_t n, float dAngle, glm::vec2 center) {
+        size_t i = 0;
+#ifdef SIMD_SSE2
+        __m128 vdA = _mm_set1_ps(dAngle), cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y);
+        __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= n; i += 4) {
+            __m128 a = _mm_add_ps(_mm_loadu_ps(angle + i), vdA);
+            _mm_storeu_ps(angle + i, a);
+            __m128 l = _mm_loadu_ps(life + i);
+            __m128 r = _mm_mul_ps(_mm_loadu_ps(spiral + i), l);
+            __m128 s, c;
+            sinCos4(a, s, c);
+            __m128 v = _mm_loadu_ps(vx + i);
+            _mm_storeu_ps(px + i, _mm_sub_ps(_mm_add_ps(cx, _mm_mul_ps(c, r)), v));
+            _mm_storeu_ps(py + i, _mm_sub_ps(_mm_add_ps(cy, _mm_mul_ps(s, r)), v));
+            __m128 lc = _mm_min_ps(_mm_max_ps(l, zero), one);
+            _mm_storeu_ps(size + i, _mm_mul_ps(poly(lc, 2.0f, 23.0f), _mm_loadu_ps(sizeScale + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            angle[i] += dAngle;
+            float r = spiral[i] * life[i];
+            float s, c;
+            sinCos(angle[i], s, c);
+            px[i] = center.x + c * r - vx[i];
+            py[i] = center.y + s * r - vx[i];
+            size[i] = (2.0f + 23.0f * ofClamp(life[i], 0.0f, 1.0f)) * sizeScale[i];
+        }
+    }
+
+    // 影の色（種類ごとに固定）
+    ofColor getShadowColor(ParticleType type) {
+        switch (type) {
+        case P_WATER:      return ofColor(15, 40, 85);
+        case P_FERTILIZER: return ofColor(35, 55, 20);
+        case P_KOTODAMA:   return ofColor(65, 25, 80);
+        case P_BLOOM:      return ofColor(85, 30, 45);
+        default:           return ofColor(30, 30, 40);
+        }
+    }
+}
+
+void ParticleSystem2D::setup(const ofJson& config) {
+    spiralSpeed = config["effects"]["kotodama"].value("spiral_speed", 8.0f);
+}
+
+void ParticleSystem2D::add(const Particle2D& p) {
+    Batch& b = batches[p.type];
+    b.px.push_back(p.pos.x);
+    b.py.push_back(p.pos.y);
+    b.vx.push_back(p.vel.x);
+    b.vy.push_back(p.vel.y);
+    b.size.push_back(p.size * p.sizeScale);
+    b.sizeScale.push_back(p.sizeScale);
+    b.life.push_back(p.life);
+    b.decay.push_back(p.decay);
+    b.angle.push_back(p.angle);
+    b.spiral.push_back(p.spiralRadius);
+    b.color.push_back(p.color);
+}
+
+void ParticleSystem2D::update(float dt, const glm::vec2& screenCenter) {
+    for (int t = 0; t < NUM_TYPES; t++) {
+        Batch& b = batches[t];
+        b.updateMicros = b.drawMicros = 0;
+        size_t count = b.life.size();
+        if (count == 0) continue;
+        uint64_t start = ofGetElapsedTimeMicros();
+        size_t numChunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        WorkerPool::shared().parallelFor(numChunks, [&](size_t c) {
+            size_t first = c * CHUNK_SIZE;
+            updateRange((ParticleType)t, b, first, std::min(first + CHUNK_SIZE, count), dt, screenCenter);
+        });
+        removeDead(b);
+        b.updateMicros = ofGetElapsedTimeMicros() - start;
+    }
+}
+
+void ParticleSystem2D::updateRange(ParticleType type, Batch& b, size_t first, size_t last, float dt, const glm::vec2& center) {
+    float k = dt * 60.0f;
+    size_t n = last - first;
+    if (type == P_KOTODAMA) {
+        updateSpiral(&b.px[first], &b.py[first], &b.angle[first], &b.size[first], &b.sizeScale[first], &b.spiral[first], &b.life[first], &b.vx[first],
+                     n, spiralSpeed * dt, center);
+    }
+    else if (type != P_RAIN_SPLASH) { // 波紋は位置固定で、寿命だけ減らす
+        addScaled(&b.px[first], &b.vx[first], k, n);
+        addScaled(&b.py[first], &b.vy[first], k, n);
+    }
+    addScaled(&b.life[first], &b.decay[first], -k, n);
+}
+
+void ParticleSystem2D::removeDead(Batch& b) {
+    size_t count = SimdUtil::removeDead(b.life.data(), b.life.size(), [&b](size_t i, size_t last) {
+        b.px[i] = b.px[last];
+        b.py[i] = b.py[last];
+        b.vx[i] = b.vx[last];
+        b.vy[i] = b.vy[last];
+        b.size[i] = b.size[last];
+        b.sizeScale[i] = b.sizeScale[last];
+        b.life[i] = b.life[last];
+        b.decay[i] = b.decay[last];
+        b.angle[i] = b.angle[last];
+        b.spiral[i] = b.spiral[last];
+        b.color[i] = b.color[last];
+    });
+    for (auto* v : { &b.px, &b.py, &b.vx, &b.vy, &b.size, &b.sizeScale, &b.life, &b.decay, &b.angle, &b.spiral }) v->resize(count);
+    b.color.resize(count);
+}
+
+void ParticleSystem2D::draw(ParticleBatch2D& batch, bool shadowPass, WeatherState ws) const {
+    for (int t = 0; t < NUM_TYPES; t++) {
+        const Batch& b = batches[t];
+        size_t count = b.life.size();
+        if (count == 0) continue;
+        uint64_t start = ofGetElapsedTimeMicros();
+        if (t == P_RAIN_SPLASH) {
+            // 雨の波紋（広がる楕円の輪）は両方のパスで描く
+            for (size_t i = 0; i < count; i++) {
+                float spread = (1.0f - b.life[i]) * b.size[i];
+                batch.addRing(glm::vec2(b.px[i], b.py[i]), glm::vec2(spread * 2.0f, spread), 2.0f, ofColor(b.color[i], b.life[i] * 150));
+            }
+        }
+        else if (shadowPass) {
+            ofColor shadowCol = getShadowColor((ParticleType)t);
+            float targetAlpha = (ws == SUNNY) ? 210.0f : 110.0f;
+            for (size_t i = 0; i < count; i++) {
+                batch.addCircle(glm::vec2(b.px[i], b.py[i]), b.size[i] * 1.1f, ofColor(shadowCol, b.life[i] * targetAlpha));
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                batch.addCircle(glm::vec2(b.px[i], b.py[i]), b.size[i], ofColor(b.color[i], b.life[i] * 255));
+            }
+        }
+        b.drawMicros += ofGetElapsedTimeMicros() - start;
+    }
+}
+
+void ParticleSystem2D::clear() {
+    for (auto& b : batches) {
+        for (auto* v : { &b.px, &b.py, &b.vx, &b.vy, &b.size, &b.sizeScale, &b.life, &b.decay, &b.angle, &b.spiral }) v->clear();
+        b.color.clear();
+    }
+}
+
+size_t ParticleSystem2D::size() const {
+    size_t n = 0;
+    for (auto& b : batches) n += b.life.size();
+    return n;
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "Constants.h"
+#include "ParticleBatch2D.h"
+
+// 2D パーティクルを種類ごとの配列（SoA）に分けて持ち、種類ごとに分岐のない更新処理でまとめて進める
+// 更新は4粒ずつ SSE で行い、大きな配列は区間に分けてワーカースレッドへ配る
+// 消えた粒子は末尾の粒子で埋めるので、種類内の並びは保たない
+class ParticleSystem2D {
+public:
+    void setup(const ofJson& config);
+    void add(const Particle2D& p);  // p は生成時の値（位置・速度・色・大きさ・寿命の減り方・螺旋の初期値）
+    void update(float dt, const glm::vec2& screenCenter);
+    // 影のパス（shadowPass）と発光のパスで、それぞれの形を batch へためる
+    void draw(ParticleBatch2D& batch, bool shadowPass, WeatherState ws) const;
+    void clear();
+    size_t size() const;
+    size_t size(ParticleType type) const { return batches[type].life.size(); }
+    // 直近のフレームで種類ごとに更新・描画（batch へためる分）にかかった時間
+    uint64_t getUpdateMicros(ParticleType type) const { return batches[type].updateMicros; }
+    uint64_t getDrawMicros(ParticleType type) const { return batches[type].drawMicros; }
+
+private:
+    // CHUNK_SIZE: 1スレッドが受け持つ粒の数
+    // 種類ごとの同時数の上限 (effects.particles.budget.max_per_type) より小さくしないと、上限まで出ても1スレッドで進むことになる
+    enum { NUM_TYPES = P_BLOOM + 1, CHUNK_SIZE = 2048 };
+
+    struct Batch {
+        vector<float> px, py, vx, vy;
+        vector<float> size, sizeScale, life, decay; // sizeScale は生成時の大きさの倍率
+        vector<float> angle, spiral;    // P_KOTODAMA の螺旋の角度・初期半径
+        vector<ofColor> color;
+        uint64_t updateMicros = 0;
+        mutable uint64_t drawMicros = 0; // 2つのパスの合計（update で 0 に戻す）
+    };
+
+    void updateRange(ParticleType type, Batch& b, size_t first, size_t last, float dt, const glm::vec2& center);
+    void removeDead(Batch& b);
+
+    Batch batches[NUM_TYPES];
+    float spiralSpeed = 8.0f;           // 螺旋の角速度 (rad/s)
+};
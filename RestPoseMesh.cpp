@@ -0,0 +1,74 @@
+﻿#include "RestPoseMesh.h"
+
+bool RestPoseMesh::setup() {
+    // 陰影は詰めた頂点形式と同じ固定機能ライト相当のフラグメントシェーダを使う
+    bReady = shader.setupShaderFromFile(GL_VERTEX_SHADER, "shaders/restPose.vert")
+        && shader.setupShaderFromFile(GL_FRAGMENT_SHADER, "shaders/packedTree.frag");
+    if (bReady) {
+        shader.bindAttribute(ATTR_RADIAL, "restRadial");
+        shader.bindAttribute(ATTR_GROWTH, "growth");
+        bReady = shader.linkProgram();
+    }
+    if (!bReady) ofLogWarning("RestPoseMesh") << "shader load failed, falling back to CPU rescaling";
+    return bReady;
+}
+
+void RestPoseMesh::upload(const ofMesh& mesh, const vector<glm::vec3>& radial, const vector<float>& birth, const vector<glm::vec3>& anchor) {
+    numVerts = mesh.getNumVertices();
+    numIndices = mesh.getNumIndices();
+    bRadial = bReady && radial.size() == numVerts;
+    bGrowth = bReady && birth.size() == numVerts && anchor.size() == numVerts;
+    if (bGrowth) {
+        growth.resize(numVerts);
+        for (size_t i = 0; i < numVerts; i++) growth[i] = glm::vec4(anchor[i], birth[i]);
+    }
+    if (numVerts == 0) return;
+
+    // 大きさが同じなら確保済みのバッファへ書き換える
+    if (numVerts != vboVerts || numIndices != vboIndices) {
+        vbo.setVertexData(mesh.getVerticesPointer(), (int)numVerts, GL_DYNAMIC_DRAW);
+        vbo.setNormalData(mesh.getNormalsPointer(), (int)numVerts, GL_DYNAMIC_DRAW);
+        vbo.setColorData(mesh.getColorsPointer(), (int)numVerts, GL_DYNAMIC_DRAW);
+        vbo.setIndexData(mesh.getIndexPointer(), (int)numIndices, GL_DYNAMIC_DRAW);
+        if (bRadial) vbo.setAttributeData(ATTR_RADIAL, &radial[0].x, 3, (int)numVerts, GL_DYNAMIC_DRAW);
+        if (bGrowth) vbo.setAttributeData(ATTR_GROWTH, &growth[0].x, 4, (int)numVerts, GL_DYNAMIC_DRAW);
+        vboVerts = numVerts;
+        vboIndices = numIndices;
+    }
+    else {
+        vbo.updateVertexData(mesh.getVerticesPointer(), (int)numVerts);
+        vbo.updateNormalData(mesh.getNormalsPointer(), (int)numVerts);
+        vbo.updateColorData(mesh.getColorsPointer(), (int)numVerts);
+        vbo.updateIndexData(mesh.getIndexPointer(), (int)numIndices);
+        if (bRadial) vbo.updateAttributeData(ATTR_RADIAL, &radial[0].x, (int)numVerts);
+        if (bGrowth) vbo.updateAttributeData(ATTR_GROWTH, &growth[0].x, (int)numVerts);
+    }
+}
+
+void RestPoseMesh::begin(const Pose& pose) const {
+    if (!bReady) return;
+    shader.begin();
+    // 属性が無いときは比率・スケールインを掛けない
+    shader.setUniform1f("lenScale", bRadial ? pose.lenK : 1.0f);
+    shader.setUniform1f("thickScale", bRadial ? pose.thickK : 1.0f);
+    shader.setUniform1f("time", pose.time);
+    shader.setUniform1f("growthDuration", bGrowth ? pose.growthDuration : 0.0f);
+}
+
+void RestPoseMesh::end() const {
+    if (bReady) shader.end();
+}
+
+void RestPoseMesh::draw(const Pose& pose) const {
+    if (numIndices == 0) return;
+    begin(pose);
+    drawElements(numIndices, 0);
+    end();
+}
+
+size_t RestPoseMesh::getNumBytes() const {
+    size_t bytes = numVerts * (sizeof(glm::vec3) * 2 + sizeof(ofFloatColor)) + numIndices * sizeof(ofIndexType);
+    if (bRadial) bytes += numVerts * sizeof(glm::vec3);
+    if (bGrowth) bytes += numVerts * sizeof(glm::vec4);
+    return bytes;
+}
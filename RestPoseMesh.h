@@ -0,0 +1,36 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 木のメッシュを構築時の形のまま GPU に置き、補間中の長さ・太さの比率と新しい段のスケールインを頂点シェーダで掛ける
+// 頂点ごとに太さ成分（軸からのオフセット）と、スケールインの基点・生えた時刻を属性で持つ
+// シェーダが使えない環境では、CPU で姿勢を掛けた頂点をそのまま描く
+class RestPoseMesh {
+public:
+    struct Pose {
+        float lenK = 1.0f, thickK = 1.0f;  // 構築時からの長さ・太さの比率
+        float time = 0.0f;                 // 現在の時刻（秒）
+        float growthDuration = 0.0f;       // 新しい段のスケールイン時間（0 ならしない）
+    };
+
+    bool setup();                    // シェーダの読み込み（失敗時は CPU で姿勢を掛ける）
+    bool isReady() const { return bReady; }
+    // 頂点・インデックスと静止姿勢を転送する（形が変わったときだけ）。radial, birth, anchor は空でもよい
+    void upload(const ofMesh& mesh, const vector<glm::vec3>& radial, const vector<float>& birth, const vector<glm::vec3>& anchor);
+    void begin(const Pose& pose) const;
+    void drawElements(size_t count, size_t first) const { vbo.drawElements(GL_TRIANGLES, (int)count, (int)first); }
+    void end() const;
+    void draw(const Pose& pose) const;
+    size_t getNumVertices() const { return numVerts; }
+    size_t getNumBytes() const;
+
+private:
+    enum { ATTR_RADIAL = 4, ATTR_GROWTH = 5 };  // 0〜3 は ofVbo の既定属性が使う
+
+    vector<glm::vec4> growth;        // スケールインの基点, 生えた時刻（転送用の作業領域）
+    size_t numVerts = 0, numIndices = 0;
+    size_t vboVerts = 0, vboIndices = 0; // GPU バッファに確保済みの数
+    bool bRadial = false, bGrowth = false;
+    ofVbo vbo;
+    ofShader shader;
+    bool bReady = false;
+};
@@ -0,0 +1,207 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+#include <array>
+#include <cstring>
+#include <cmath>
+#include "SimdUtil.h"
+
+// 枝の円柱（断面の輪を縦に積んだもの）の頂点をまとめて計算する
+// 単位円は角数ごとにコンパイル時の表にし、ねじれは輪ごとの回転1回で与える
+// 行列は輪の頂点すべてへ4頂点ずつ (SSE) 掛ける
+namespace RingKernel {
+    enum { MAX_VERTS = 64 };      // 1本の枝の頂点数の上限（角数 x 輪の数）
+
+    // 枝1本分のローカル形状 (SoA)。法線の y 成分は常に0
+    struct StemRings {
+        alignas(16) float x[MAX_VERTS];
+        alignas(16) float y[MAX_VERTS];
+        alignas(16) float z[MAX_VERTS];
+        alignas(16) float nx[MAX_VERTS];
+        alignas(16) float nz[MAX_VERTS];
+        int count = 0;
+    };
+
+    // constexpr の sin（テイラー展開、[-π, π] に畳んでから 20 項）
+    constexpr double constSin(double x) {
+        const double pi = 3.14159265358979323846;
+        while (x > pi) x -= 2.0 * pi;
+        while (x < -pi) x += 2.0 * pi;
+        double term = x, sum = x;
+        for (int k = 1; k < 20; k++) {
+            term *= -x * x / ((2.0 * k) * (2.0 * k + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+    constexpr double constCos(double x) { return constSin(x + 1.57079632679489661923); }
+
+    template<int N>
+    struct UnitCircle {
+        static constexpr std::array<float, N> makeCos() {
+            std::array<float, N> t{};
+            for (int i = 0; i < N; i++) t[i] = (float)constCos(i * 6.28318530717958647693 / N);
+            return t;
+        }
+        static constexpr std::array<float, N> makeSin() {
+            std::array<float, N> t{};
+            for (int i = 0; i < N; i++) t[i] = (float)constSin(i * 6.28318530717958647693 / N);
+            return t;
+        }
+        static constexpr std::array<float, N> cosTable = makeCos();
+        static constexpr std::array<float, N> sinTable = makeSin();
+    };
+
+    // 輪 r (0..numRings-1) の頂点 i: 角度 2πi/N + twist * r/(numRings-1)、半径は r1 から r2 へ線形
+    template<int N>
+    inline void buildRingsN(int numRings, float r1, float r2, float h, float twist, StemRings& out) {
+        int subdivisions = numRings - 1;
+        int v = 0;
+        for (int ring = 0; ring < numRings; ring++) {
+            float ratio = (float)ring / subdivisions;
+            float radius = r1 + (r2 - r1) * ratio;
+            float y = h * ratio;
+            float tc = cos(twist * ratio), ts = sin(twist * ratio);
+            for (int i = 0; i < N; i++, v++) {
+                // 加法定理で表の角度をねじれの分だけ回す
+                float c = UnitCircle<N>::cosTable[i] * tc - UnitCircle<N>::sinTable[i] * ts;
+                float s = UnitCircle<N>::sinTable[i] * tc + UnitCircle<N>::cosTable[i] * ts;
+                out.x[v] = c * radius;
+                out.y[v] = y;
+                out.z[v] = s * radius;
+                out.nx[v] = c;
+                out.nz[v] = s;
+            }
+        }
+        out.count = v;
+    }
+
+    // 表の無い角数（設定で増やした場合）は実行時に求める
+    inline void buildRingsAny(int segments, int numRings, float r1, float r2, float h, float twist, StemRings& out) {
+        int subdivisions = numRings - 1;
+        int v = 0;
+        for (int ring = 0; ring < numRings; ring++) {
+            float ratio = (float)ring / subdivisions;
+            float radius = r1 + (r2 - r1) * ratio;
+            float y = h * ratio;
+            for (int i = 0; i < segments; i++, v++) {
+                float angle = i * 6.28318530717958647693f / segments + twist * ratio;
+                out.x[v] = cos(angle) * radius;
+                out.y[v] = y;
+                out.z[v] = sin(angle) * radius;
+                out.nx[v] = cos(angle);
+                out.nz[v] = sin(angle);
+            }
+        }
+        out.count = v;
+    }
+
+    inline void buildRings(int segments, int numRings, float r1, float r2, float h, float twist, StemRings& out) {
+        switch (segments) {
+        case 3: buildRingsN<3>(numRings, r1, r2, h, twist, out); break;
+        case 4: buildRingsN<4>(numRings, r1, r2, h, twist, out); break;
+        case 5: buildRingsN<5>(numRings, r1, r2, h, twist, out); break;
+        default: buildRingsAny(segments, numRings, r1, r2, h, twist, out); break;
+        }
+    }
+
+#ifdef SIMD_SSE2
+    // SoA の4頂点を vec3 x4 として書き出す（最後の1つ以外は16バイト書いて次の頂点で上書きする）
+    inline void storeVec3x4(glm::vec3* out, __m128 x, __m128 y, __m128 z, int n) {
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        __m128 v[4] = { x, y, z, w };
+        if (n == 4) {
+            _mm_storeu_ps(&out[0].x, v[0]);
+            _mm_storeu_ps(&out[1].x, v[1]);
+            _mm_storeu_ps(&out[2].x, v[2]);
+            alignas(16) float last[4];
+            _mm_store_ps(last, v[3]);
+            memcpy(&out[3], last, sizeof(glm::vec3));
+            return;
+        }
+        alignas(16) float tmp[4];
+        for (int i = 0; i < n; i++) {
+            _mm_store_ps(tmp, v[i]);
+            memcpy(&out[i], tmp, sizeof(glm::vec3));
+        }
+    }
+#endif
+
+    // ローカル形状を枝の行列で変換する
+    // axis = 行列 * (0, y, 0, 1)、radial = 行列の3x3 * (x, 0, z)、pos = axis + radial
+    // 枝の行列は回転と平行移動だけなので、法線も同じ3x3で回す（逆転置は不要）
+    // axis / radial は nullptr なら書かない
+    inline void transformRings(const glm::mat4& mat, const StemRings& r, glm::vec3* pos, glm::vec3* axis, glm::vec3* radial, glm::vec3* normals) {
+#ifdef SIMD_SSE2
+        __m128 m0[3], m1[3], m2[3], m3[3];
+        for (int k = 0; k < 3; k++) {
+            m0[k] = _mm_set1_ps(mat[0][k]);
+            m1[k] = _mm_set1_ps(mat[1][k]);
+            m2[k] = _mm_set1_ps(mat[2][k]);
+            m3[k] = _mm_set1_ps(mat[3][k]);
+        }
+        for (int v = 0; v < r.count; v += 4) {
+            int n = (r.count - v < 4) ? r.count - v : 4;
+            __m128 x = _mm_load_ps(r.x + v), y = _mm_load_ps(r.y + v), z = _mm_load_ps(r.z + v);
+            __m128 nx = _mm_load_ps(r.nx + v), nz = _mm_load_ps(r.nz + v);
+            __m128 a[3], d[3], p[3], nrm[3];
+            for (int k = 0; k < 3; k++) {
+                a[k] = _mm_add_ps(m3[k], _mm_mul_ps(m1[k], y));
+                d[k] = _mm_add_ps(_mm_mul_ps(m0[k], x), _mm_mul_ps(m2[k], z));
+                p[k] = _mm_add_ps(a[k], d[k]);
+                nrm[k] = _mm_add_ps(_mm_mul_ps(m0[k], nx), _mm_mul_ps(m2[k], nz));
+            }
+            storeVec3x4(pos + v, p[0], p[1], p[2], n);
+            storeVec3x4(normals + v, nrm[0], nrm[1], nrm[2], n);
+            if (axis) {
+                storeVec3x4(axis + v, a[0], a[1], a[2], n);
+                storeVec3x4(radial + v, d[0], d[1], d[2], n);
+            }
+        }
+#else
+        glm::vec3 c0(mat[0]), c1(mat[1]), c2(mat[2]), c3(mat[3]);
+        for (int v = 0; v < r.count; v++) {
+            glm::vec3 a = c3 + c1 * r.y[v];
+            glm::vec3 d = c0 * r.x[v] + c2 * r.z[v];
+            pos[v] = a + d;
+            normals[v] = c0 * r.nx[v] + c2 * r.nz[v];
+            if (axis) {
+                axis[v] = a;
+                radial[v] = d;
+            }
+        }
+#endif
+    }
+
+    // 隣り合う輪の間に四角形 (三角形2枚) を貼る。base は最初の頂点の番号
+    template<int N, class Index>
+    inline Index* addRingIndicesN(Index* out, size_t base, int subdivisions) {
+        for (int ring = 0; ring < subdivisions; ring++) {
+            size_t lo = base + ring * N, hi = lo + N;
+            for (int i = 0; i < N; i++) {
+                int nextI = (i + 1 == N) ? 0 : i + 1;
+                *out++ = (Index)(lo + i); *out++ = (Index)(lo + nextI); *out++ = (Index)(hi + i);
+                *out++ = (Index)(lo + nextI); *out++ = (Index)(hi + nextI); *out++ = (Index)(hi + i);
+            }
+        }
+        return out;
+    }
+
+    template<class Index>
+    inline Index* addRingIndices(Index* out, size_t base, int segments, int subdivisions) {
+        switch (segments) {
+        case 3: return addRingIndicesN<3>(out, base, subdivisions);
+        case 4: return addRingIndicesN<4>(out, base, subdivisions);
+        case 5: return addRingIndicesN<5>(out, base, subdivisions);
+        }
+        for (int ring = 0; ring < subdivisions; ring++) {
+            size_t lo = base + ring * segments, hi = lo + segments;
+            for (int i = 0; i < segments; i++) {
+                int nextI = (i + 1) % segments;
+                *out++ = (Index)(lo + i); *out++ = (Index)(lo + nextI); *out++ = (Index)(hi + i);
+                *out++ = (Index)(lo + nextI); *out++ = (Index)(hi + nextI); *out++ = (Index)(hi + i);
+            }
+        }
+        return out;
+    }
+}
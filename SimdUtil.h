@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <cstddef>
+
+// SSE2 が使えるときだけ SIMD_SSE2 を定義する（x64 の MSVC は常に使える）
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+// SoA のパーティクル配列で共通に使う小さな処理
+namespace SimdUtil {
+    // a[i] += b[i] * k（4要素ずつ SSE で進め、端数は1つずつ）
+    inline void addScaled(float* a, const float* b, float k, size_t n) {
+        size_t i = 0;
+#ifdef SIMD_SSE2
+        __m128 vk = _mm_set1_ps(k);
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), vk)));
+        }
+#endif
+        for (; i < n; i++) a[i] += b[i] * k;
+    }
+
+    // 寿命 (life) が尽きた要素を末尾の要素で埋め、残った数を返す（順番は保たない）
+    // move(dst, src) は life を含むすべての配列の src 番目を dst 番目へ写す
+    template<class MoveFn>
+    size_t removeDead(const float* life, size_t count, MoveFn move) {
+        for (size_t i = 0; i < count;) {
+            if (life[i] > 0) {
+                i++;
+                continue;
+            }
+            size_t last = --count;
+            if (i != last) move(i, last);
+        }
+        return count;
+    }
+}
@@ -0,0 +1,107 @@
+﻿#include "StemInstancer.h"
+
+bool StemInstancer::setup() {
+    setupLod(lods[0], 3);
+    setupLod(lods[1], 5);
+
+    // 陰影は詰めた頂点形式と同じ固定機能ライト相当のフラグメントシェーダを使う
+    bReady = shader.setupShaderFromFile(GL_VERTEX_SHADER, "shaders/stemInstanced.vert")
+        && shader.setupShaderFromFile(GL_FRAGMENT_SHADER, "shaders/packedTree.frag");
+    if (bReady) {
+        shader.bindAttribute(ATTR_COL0, "instCol0");
+        shader.bindAttribute(ATTR_COL1, "instCol1");
+        shader.bindAttribute(ATTR_COL2, "instCol2");
+        shader.bindAttribute(ATTR_COL3, "instCol3");
+        shader.bindAttribute(ATTR_SHAPE, "instShape");
+        shader.bindAttribute(ATTR_COLOR, "instColor");
+        bReady = shader.linkProgram();
+    }
+    if (!bReady) ofLogWarning("StemInstancer") << "shader load failed, falling back to mesh stems";
+    return bReady;
+}
+
+void StemInstancer::setupLod(Lod& lod, int segments) {
+    // addStemToMesh と同じ並び：5断面 x 角数。頂点は (断面上の角度, 高さ比) だけを持つ
+    int subdivisions = 4;
+    lod.segments = segments;
+    vector<glm::vec2> verts;
+    vector<ofIndexType> indices;
+    for (int ring = 0; ring <= subdivisions; ring++) {
+        for (int i = 0; i < segments; i++) {
+            verts.push_back(glm::vec2(i * TWO_PI / segments, (float)ring / subdivisions));
+        }
+    }
+    for (int ring = 0; ring < subdivisions; ring++) {
+        for (int i = 0; i < segments; i++) {
+            int nextI = (i + 1) % segments;
+            int v0 = (ring * segments) + i;
+            int v1 = (ring * segments) + nextI;
+            int v2 = ((ring + 1) * segments) + i;
+            int v3 = ((ring + 1) * segments) + nextI;
+            indices.insert(indices.end(), { (ofIndexType)v0, (ofIndexType)v1, (ofIndexType)v2 });
+            indices.insert(indices.end(), { (ofIndexType)v1, (ofIndexType)v3, (ofIndexType)v2 });
+        }
+    }
+    lod.numVerts = verts.size();
+    lod.numIndices = indices.size();
+    lod.vbo.setVertexData(verts.data(), (int)verts.size(), GL_STATIC_DRAW);
+    lod.vbo.setIndexData(indices.data(), (int)indices.size(), GL_STATIC_DRAW);
+}
+
+void StemInstancer::upload(const Instance* instances, size_t count) {
+    for (auto& lod : lods) {
+        lod.count = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (instances[i].segments == lod.segments) lod.count++;
+        }
+        lod.col0.resize(lod.count);
+        lod.col1.resize(lod.count);
+        lod.col2.resize(lod.count);
+        lod.col3.resize(lod.count);
+        lod.shape.resize(lod.count);
+        lod.color.resize(lod.count);
+
+        size_t k = 0;
+        for (size_t i = 0; i < count; i++) {
+            const Instance& inst = instances[i];
+            if (inst.segments != lod.segments) continue;
+            lod.col0[k] = inst.mat[0];
+            lod.col1[k] = inst.mat[1];
+            lod.col2[k] = inst.mat[2];
+            lod.col3[k] = inst.mat[3];
+            lod.shape[k] = inst.shape;
+            lod.color[k] = glm::vec4(inst.color.r, inst.color.g, inst.color.b, inst.color.a);
+            k++;
+        }
+        if (lod.count == 0) continue;
+
+        int n = (int)lod.count;
+        lod.vbo.setAttributeData(ATTR_COL0, &lod.col0[0].x, 4, n, GL_DYNAMIC_DRAW);
+        lod.vbo.setAttributeData(ATTR_COL1, &lod.col1[0].x, 4, n, GL_DYNAMIC_DRAW);
+        lod.vbo.setAttributeData(ATTR_COL2, &lod.col2[0].x, 4, n, GL_DYNAMIC_DRAW);
+        lod.vbo.setAttributeData(ATTR_COL3, &lod.col3[0].x, 4, n, GL_DYNAMIC_DRAW);
+        lod.vbo.setAttributeData(ATTR_SHAPE, &lod.shape[0].x, 4, n, GL_DYNAMIC_DRAW);
+        lod.vbo.setAttributeData(ATTR_COLOR, &lod.color[0].x, 4, n, GL_DYNAMIC_DRAW);
+        for (int loc = ATTR_COL0; loc <= ATTR_COLOR; loc++) lod.vbo.setAttributeDivisor(loc, 1);
+    }
+}
+
+void StemInstancer::draw(float lenK, float thickK) const {
+    if (!bReady) return;
+    shader.begin();
+    shader.setUniform1f("lenScale", lenK);
+    shader.setUniform1f("thickScale", thickK);
+    for (auto& lod : lods) {
+        if (lod.count > 0) lod.vbo.drawElementsInstanced(GL_TRIANGLES, (int)lod.numIndices, (int)lod.count);
+    }
+    shader.end();
+}
+
+size_t StemInstancer::getNumBytes() const {
+    size_t bytes = 0;
+    for (auto& lod : lods) {
+        bytes += lod.numVerts * sizeof(glm::vec2) + lod.numIndices * sizeof(ofIndexType);
+        bytes += lod.count * sizeof(glm::vec4) * 6;
+    }
+    return bytes;
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include "ofMain.h"
+
+// 枝（テーパー付きのねじれた筒）を正準メッシュ＋枝ごとのインスタンスで描く
+// 角数 (LOD) ごとに正準メッシュを1つ持ち、構築時は枝ごとの行列・半径・長さ・色だけを書き出す
+class StemInstancer {
+public:
+    struct Instance {
+        glm::mat4 mat;       // 付け根の行列（回転＋平行移動）
+        glm::vec4 shape;     // x:r1, y:r2, z:長さ, w:ねじれ角 (rad)
+        ofFloatColor color;
+        int segments;        // 断面の角数 (3 or 5)
+    };
+
+    bool setup();                                      // 正準メッシュとシェーダの準備
+    void upload(const Instance* instances, size_t count); // 角数ごとに振り分けて転送
+    void draw(float lenK, float thickK) const;        // 長さ・太さの比率はシェーダで掛ける
+    bool isReady() const { return bReady; }
+    size_t getNumBytes() const;
+
+private:
+    // インスタンス属性の位置（0〜3 は ofVbo の既定属性が使う）
+    enum { ATTR_COL0 = 4, ATTR_COL1, ATTR_COL2, ATTR_COL3, ATTR_SHAPE, ATTR_COLOR };
+
+    struct Lod {
+        int segments;
+        ofVbo vbo;
+        size_t numVerts = 0, numIndices = 0;
+        size_t count = 0;                    // インスタンス数
+        vector<glm::vec4> col0, col1, col2, col3, shape, color; // 転送用の作業領域
+    };
+
+    void setupLod(Lod& lod, int segments);
+
+    Lod lods[2];
+    ofShader shader;
+    bool bReady = false;
+};
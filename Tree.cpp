@@ -1,4 +1,15 @@
 ﻿#include "Tree.h"
+#include "BatchNoise.h"
+#include "Frustum.h"
+
+// 描画レベルごとの細かさ（0 が最も細かく、1・2 は遠景用に必要になったときに作る）
+const Tree::LodLevel Tree::lodLevels[Tree::NUM_LOD_LEVELS] = {
+    // 幹側の角数, 先端側の角数, 縦の分割数, 結晶の頂点数, 花弁の数, 葉の三角形数
+    { 5, 3, 4, 6, 5, 2 },
+    { 4, 3, 2, 4, 3, 2 },
+    { 3, 3, 1, 3, 2, 1 },
+};
+
 void Tree::setup(const ofJson& config) {
     seed = ofRandom(99999);
     auto t = config["tree"];
@@ -23,6 +34,48 @@ void Tree::setup(const ofJson& config) {
     s.trunkHueEnd = c.value("trunk_hue_end", 160.0f);
     s.leafColor = ofColor(c["leaf"][0], c["leaf"][1], c["leaf"][2], c["leaf"][3]);
     s.twistFactor = 0.0f;
+
+    auto gen = t.value("generation", ofJson::object());
+    s.rescaleGlide = gen.value("rescale_glide", true);
+    s.incrementalGrowth = gen.value("incremental_growth", true);
+    s.growthDuration = gen.value("growth_duration", 0.8f);
+    s.compactRetired = gen.value("compact_retired", 0.05f);
+    s.parallelBuild = gen.value("parallel_build", true);
+    s.parallelMinDepth = gen.value("parallel_min_depth", 5);
+    s.packedVertices = gen.value("packed_vertices", false);
+    if (s.packedVertices && !packedMesh.isReady()) s.packedVertices = packedMesh.setup();
+    s.instancedStems = gen.value("instanced_stems", false);
+    if (s.instancedStems && !stemInstancer.isReady()) s.instancedStems = stemInstancer.setup();
+    s.dedupSubtrees = gen.value("dedup_subtrees", false);
+    // 補間中の長さ・太さの比率と新しい段のスケールインは頂点シェーダで掛ける
+    if ((s.rescaleGlide || s.incrementalGrowth) && !poseMesh.isReady()) {
+        poseMesh.setup();
+        for (auto& lm : lodMeshes) lm.pose.setup();
+    }
+
+    s.chunkedBuild = gen.value("chunked_build", true);
+    s.chunkMinDepth = gen.value("chunk_min_depth", 9);
+    s.chunkVertices = max(gen.value("chunk_vertices", 65536), 1024);
+    s.chunkBudgetMs = gen.value("chunk_budget_ms", 4.0f);
+
+    s.lodLevels = gen.value("lod_levels", true);
+    auto lodSize = gen.value("lod_screen_size", ofJson::array());
+    if (lodSize.size() >= 2) {
+        s.lodScreenSize[0] = lodSize[0];
+        s.lodScreenSize[1] = lodSize[1];
+    }
+    s.lodHysteresis = gen.value("lod_hysteresis", 0.15f);
+    s.foliageCards = gen.value("foliage_cards", true);
+    s.foliageCardLod = max(gen.value("foliage_card_lod", 1), 1);
+    s.foliageCardDepth = max(gen.value("foliage_card_depth", 2), 1);
+    s.foliageCardSize = ofClamp(gen.value("foliage_card_size", 64), 8, 512);
+
+    // 設定ファイルの内容が変わったら、保存済みのメッシュはすべて作り直す
+    s.meshCache = gen.value("mesh_cache", true);
+    if (s.meshCache) {
+        string settingsText = config.dump();
+        s.meshCache = meshCache.setup(ofToDataPath("cache/tree", true), MeshCache::hash(settingsText.data(), settingsText.size()));
+    }
 }
 
 void Tree::update(int growthLevel, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
@@ -33,62 +86,916 @@ void Tree::update(int growthLevel, int chaosResist, int bloomLevel, GrowthType g
 
     maxMutationReached = max(maxMutationReached, bMutation);
 
+    bool grew = false;
     if (depthLevel < s.maxDepth && depthExp >= getExpForDepth(depthLevel + 1)) {
         depthLevel++;
-        bNeedsUpdate = true;
+        grew = true;
+        if (s.incrementalGrowth) tierBirthTime = ofGetElapsedTimef();
+        // インスタンス描画・部分木の共有中は枝の段を追記できないので作り直す
+        if (!bAppendable) bNeedsUpdate = true;
+    }
+
+    bool rebuilt = false;
+    if (s.rescaleGlide) {
+        // 目標値で一度だけ構築し、補間中は頂点を長さ・太さの比率でスケールするだけにする
+        float targetMaxMutation = max(maxMutationReached, tMutation);
+        // 変異度は分岐角と色相を変えるので比率では表せず、目標値で作り直した形へ切り替わる
+        // （色相も構築時の値のままで、補間中には動かない）
+        if (bNeedsUpdate || tMutation != builtMutation || targetMaxMutation != builtMaxMutation) {
+            meshMutation = tMutation;
+            meshMaxMutation = targetMaxMutation;
+            rebuildMesh(tLen, tThick, chaosResist, bloomLevel, gType, fType);
+            rebuilt = true;
+        }
+    }
+    else if (bNeedsUpdate || abs(bLen - tLen) > 0.5f || abs(bThick - tThick) > 0.1f) {
+        meshMutation = bMutation;
+        meshMaxMutation = maxMutationReached;
+        rebuildMesh(bLen, bThick, chaosResist, bloomLevel, gType, fType);
+        rebuilt = true;
+    }
+
+    // 段が増えただけなら、新しい先端の段だけを既存のバッファへ追記する
+    if (grew && !rebuilt) {
+        appendGrowthTier(chaosResist, bloomLevel, gType, fType);
+    }
+
+    // 分割構築中は、1フレームの持ち時間だけ続きを生成する
+    if (bChunkPending) continueChunkedBuild(s.chunkBudgetMs);
+
+    // 遠景用の粗いメッシュは、描画で選ばれたときに作る
+    if (bLodBuild && lodTarget > 0 && lodMeshes[lodTarget - 1].bDirty) {
+        buildLodMesh(lodTarget, chaosResist, bloomLevel, gType, fType);
+    }
+
+    if (!s.rescaleGlide && !s.incrementalGrowth) return;
+
+    if (isShaderPose()) {
+        // 頂点は構築時の形のまま持ち、描画時に比率と生えた時刻から形を求める
+        appliedLen = bLen;
+        appliedThick = bThick;
+    }
+    else if (rebuilt || (s.rescaleGlide && (abs(bLen - appliedLen) > 0.01f || abs(bThick - appliedThick) > 0.01f))) {
+        applyRestPose(0);
+    }
+    else if (bGrowthPending) {
+        applyRestPose(growStart);
+    }
+    if (bGrowthPending && ofGetElapsedTimef() >= tierBirthTime + s.growthDuration) {
+        bGrowthPending = false;
+    }
+}
+
+void Tree::rebuildMesh(float len, float thick, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    builtLen = len;
+    builtThick = thick;
+    builtMutation = meshMutation;
+    builtMaxMutation = meshMaxMutation;
+    meshType = gType;
+    bBvhDirty = true;
+    depthOffset = s.incrementalGrowth ? s.maxDepth - depthLevel : 0;
+    buildTime = ofGetElapsedTimef();
+    // 深い木は固定サイズのチャンクに分けて、複数フレームにわたって生成する
+    bChunkedBuild = s.chunkedBuild && depthLevel >= s.chunkMinDepth;
+    if (!bChunkedBuild) {
+        // 分割構築をやめたら、途中の構築と前回のチャンクを手放す
+        bChunkPending = false;
+        meshChunks.clear();
+        buildChunks.clear();
+    }
+    bInstancedBuild = s.instancedStems && !hasStemNoise() && !bChunkedBuild;
+    // 変異度0では揺らぎが消え、同じ深さの部分木は剛体変換を除いて同一になる
+    // （頂点ノイズは枝のローカル座標で引くので、これも部分木ごとに変わらない）
+    bDedupBuild = s.dedupSubtrees && meshMutation == 0.0f && depthLevel >= 2 && !bInstancedBuild && !bChunkedBuild;
+    bAppendable = s.incrementalGrowth && !bInstancedBuild && !bDedupBuild && !bChunkedBuild;
+    bLodBuild = s.lodLevels && !bInstancedBuild && !bDedupBuild && !bChunkedBuild;
+    for (auto& lm : lodMeshes) lm.bDirty = true;
+
+    // 成長アニメーション中の段は頂点の並びが混在するため全頂点を更新対象にする
+    growStart = 0;
+    retiredIndices = 0;
+    bGrowthPending = s.incrementalGrowth && buildTime < tierBirthTime + s.growthDuration;
+
+    // 頂点数・インデックス数は深さだけで決まるので、先に一度だけ確保する
+    // （容量は作り直しをまたいで使い回すため、同じ規模なら確保は発生しない）
+    buildSubtreeTables(depthLevel, bloomLevel, fType);
+
+    if (bChunkedBuild) {
+        beginChunkedBuild(len * s.lenScale, thick * s.thickScale, chaosResist, bloomLevel, gType, fType);
+        bNeedsUpdate = false;
+        bPackDirty = true;
+        bStemsDirty = false;
+        return;
     }
 
-    if (bNeedsUpdate || abs(bLen - tLen) > 0.5f || abs(bThick - tThick) > 0.1f) {
-        vboMesh.clear();
-        ofSetRandomSeed(seed);
-        // 構造体 s を経由して描画パラメータを渡す
-        buildBranchMesh(bLen * s.lenScale, bThick * s.thickScale, depthLevel, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType);
+    // プリセットは生成条件が同じなら前回保存したメッシュを読み込むだけにする
+    bool bCacheable = bCacheBuild && !bGrowthPending;
+    uint64_t cacheKey = bCacheable ? getMeshCacheKey(len, thick, chaosResist, bloomLevel, gType, fType) : 0;
+    if (bCacheable && loadCachedMesh(cacheKey)) {
         bNeedsUpdate = false;
+        bPackDirty = true;
+        bStemsDirty = bInstancedBuild;
+        return;
+    }
+
+    // 構造体 s を経由して描画パラメータを渡す
+    float rootLen = len * s.lenScale;
+    float rootThick = thick * s.thickScale;
+    if (bDedupBuild) {
+        buildDedupMesh(rootLen, rootThick, chaosResist, bloomLevel, gType, fType);
+    }
+    else if (s.parallelBuild && depthLevel >= max(2, s.parallelMinDepth) && WorkerPool::shared().getNumThreads() > 1) {
+        resizeMesh(subtreeCounts[depthLevel]);
+        buildBranchMeshParallel(rootLen, rootThick, chaosResist, bloomLevel, gType, fType);
+    }
+    else {
+        resizeMesh(subtreeCounts[depthLevel]);
+        MeshWriter w = beginMeshWrite(MeshCount());
+        buildBranchMesh(rootLen, rootThick, depthLevel, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), w);
+    }
+    if (bCacheable) saveCachedMesh(cacheKey);
+    bNeedsUpdate = false;
+    bPackDirty = true;
+    bStemsDirty = bInstancedBuild;
+}
+
+uint64_t Tree::getMeshCacheKey(float len, float thick, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) const {
+    // 形・色・バッファの並びに影響する値をすべて含める（構築時刻による色相のずれは除く）
+    uint64_t h = MeshCache::hash(nullptr, 0);
+    auto add = [&](auto v) { h = MeshCache::hashValue(v, h); };
+    add(seed); add(depthLevel); add(depthOffset); add((int)gType); add((int)fType);
+    add(chaosResist); add(bloomLevel); add(len); add(thick); add(meshMutation); add(meshMaxMutation);
+    add(bInstancedBuild); add(bDedupBuild); add(bAppendable); add(s.rescaleGlide); add(s.incrementalGrowth);
+    add(s.maxDepth); add(s.lenScale); add(s.thickScale); add(s.branchLenRatio); add(s.branchThickRatio);
+    add(s.baseAngle); add(s.mutationAngleMax); add(s.trunkHueStart); add(s.trunkHueEnd); add(s.twistFactor);
+    add(s.uneriStrengthMax); add(s.noiseStrengthMax); add(s.bloomThreshold);
+    add(s.leafColor); add(s.flowerColor);
+    return h;
+}
+
+// キャッシュ内の配列をそのまま vector へ写す
+template<class T>
+static bool readCacheBlob(const MeshCache& cache, size_t i, vector<T>& out) {
+    MeshCache::Blob b = cache.getBlob(i);
+    if (b.bytes % sizeof(T) != 0) return false;
+    out.resize(b.bytes / sizeof(T));
+    if (b.bytes > 0) memcpy(out.data(), b.data, b.bytes);
+    return true;
+}
+
+template<class T>
+static MeshCache::Blob toCacheBlob(const vector<T>& v) {
+    return { v.data(), v.size() * sizeof(T) };
+}
+
+bool Tree::loadCachedMesh(uint64_t key) {
+    if (!meshCache.open(key)) return false;
+
+    // 並びは saveCachedMesh と同じ
+    CacheInfo info;
+    bool ok = meshCache.getNumBlobs() == 11 && meshCache.getBlob(0).bytes == sizeof(CacheInfo);
+    if (ok) {
+        memcpy(&info, meshCache.getBlob(0).data, sizeof(CacheInfo));
+        ok = readCacheBlob(meshCache, 1, vboMesh.getVertices())
+            && readCacheBlob(meshCache, 2, vboMesh.getNormals())
+            && readCacheBlob(meshCache, 3, vboMesh.getColors())
+            && readCacheBlob(meshCache, 4, vboMesh.getIndices())
+            && readCacheBlob(meshCache, 5, restAxis)
+            && readCacheBlob(meshCache, 6, restRadial)
+            && readCacheBlob(meshCache, 7, tipTier)
+            && readCacheBlob(meshCache, 8, leafTier)
+            && readCacheBlob(meshCache, 9, stemInstances)
+            && readCacheBlob(meshCache, 10, dedupMats);
+    }
+    meshCache.close();
+
+    size_t numVerts = vboMesh.getNumVertices();
+    bool keepRest = s.rescaleGlide || s.incrementalGrowth;
+    if (!ok || vboMesh.getNumNormals() != numVerts || vboMesh.getNumColors() != numVerts
+        || restAxis.size() != (keepRest ? numVerts : 0) || restRadial.size() != restAxis.size()) {
+        ofLogWarning("Tree") << "mesh cache entry " << ofToHex(key) << " is broken, rebuilding";
+        return false;
+    }
+
+    // 保存時の段はすべて生え終わっている
+    vertexBirth.assign(s.incrementalGrowth ? numVerts : 0, -1e6f);
+    vertexAnchor.assign(s.incrementalGrowth ? numVerts : 0, glm::vec3(0));
+    dedupDepth = info.dedupDepth;
+    dedupSpineIndices = info.dedupSpineIndices;
+    dedupSubtreeIndices = info.dedupSubtreeIndices;
+    return true;
+}
+
+void Tree::saveCachedMesh(uint64_t key) {
+    CacheInfo info = { dedupDepth, dedupSpineIndices, dedupSubtreeIndices };
+    vector<MeshCache::Blob> blobs = {
+        { &info, sizeof(CacheInfo) },
+        toCacheBlob(vboMesh.getVertices()),
+        toCacheBlob(vboMesh.getNormals()),
+        toCacheBlob(vboMesh.getColors()),
+        toCacheBlob(vboMesh.getIndices()),
+        toCacheBlob(restAxis),
+        toCacheBlob(restRadial),
+        toCacheBlob(tipTier),
+        toCacheBlob(leafTier),
+        toCacheBlob(stemInstances),
+        toCacheBlob(dedupMats),
+    };
+    if (!meshCache.save(key, blobs)) ofLogWarning("Tree") << "failed to write mesh cache entry " << ofToHex(key);
+}
+
+void Tree::beginChunkedBuild(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    // 1本のメッシュは持たず、容量ごと手放す（メモリはチャンクの大きさだけで決まる）
+    resizeMesh(MeshCount());
+    vboMesh.getVertices().shrink_to_fit();
+    vboMesh.getNormals().shrink_to_fit();
+    vboMesh.getColors().shrink_to_fit();
+    vboMesh.getIndices().shrink_to_fit();
+    restAxis.shrink_to_fit();
+    restRadial.shrink_to_fit();
+    vertexBirth.shrink_to_fit();
+    vertexAnchor.shrink_to_fit();
+    // 前回のチャンクは新しい木が完成するまで描き続け、途中の構築だけを捨てる
+    buildChunks.clear();
+
+    // 枝1本（＋装飾）の最大の大きさ。これが入らなくなったらチャンクを閉じる
+    chunkNodeMax = MeshCount();
+    for (int d = 0; d <= depthLevel; d++) {
+        MeshCount c = countBranchNode(d, bloomLevel, fType);
+        chunkNodeMax.verts = max(chunkNodeMax.verts, c.verts);
+        chunkNodeMax.indices = max(chunkNodeMax.indices, c.indices);
+    }
+    // インデックスは頂点と同じ割合で埋まるよう、枝1本で最も多い比率に合わせる
+    // （5角・4分割の円柱は25頂点に120インデックスで4.8倍。装飾はこれより少ない）
+    double indexRatio = 0;
+    for (int d = 0; d <= depthLevel; d++) {
+        MeshCount c = countBranchNode(d, bloomLevel, fType);
+        if (c.verts > 0) indexRatio = max(indexRatio, (double)c.indices / c.verts);
+    }
+    size_t numVerts = max((size_t)s.chunkVertices, chunkNodeMax.verts);
+    chunkVerts.resize(numVerts);
+    chunkNormals.resize(numVerts);
+    chunkColors.resize(numVerts);
+    chunkIndices.resize(max((size_t)ceil(numVerts * indexRatio), chunkNodeMax.indices));
+
+    chunkBuild.stack.clear();
+    chunkBuild.stack.push_back({ glm::mat4(1.0), length, thickness, depthLevel, BranchRng::root(seed) });
+    chunkBuild.chaosResist = chaosResist;
+    chunkBuild.bloomLevel = bloomLevel;
+    chunkBuild.gType = gType;
+    chunkBuild.fType = fType;
+    chunkBuild.w = MeshWriter();
+    chunkBuild.w.verts = chunkVerts.data();
+    chunkBuild.w.normals = chunkNormals.data();
+    chunkBuild.w.colors = chunkColors.data();
+    chunkBuild.w.indices = chunkIndices.data();
+    bChunkPending = true;
+}
+
+void Tree::continueChunkedBuild(float budgetMs) {
+    // 再帰の代わりに未処理の枝を積み、buildBranchMesh と同じ順に1本ずつ生成する
+    uint64_t deadline = ofGetElapsedTimeMicros() + (uint64_t)(budgetMs * 1000.0f);
+    MeshWriter& w = chunkBuild.w;
+    vector<PendingBranch>& stack = chunkBuild.stack;
+    int count = 0;
+    while (!stack.empty()) {
+        PendingBranch b = stack.back();
+        stack.pop_back();
+        glm::mat4 tipMat = addBranchNodeToMesh(b.length, b.thickness, b.depth, b.mat, chunkBuild.chaosResist, chunkBuild.bloomLevel, chunkBuild.gType, chunkBuild.fType, b.key, w);
+
+        if (b.depth > 0) {
+            int numBranches = getBranchCount(b.depth);
+            float angleBase = 25.0f + (meshMutation * 45.0f);
+            for (int i = numBranches - 1; i >= 0; i--) {
+                uint64_t childKey = BranchRng::child(b.key, i);
+                glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase, childKey);
+                stack.push_back({ childMat, b.length * s.branchLenRatio, b.thickness * s.branchThickRatio, b.depth - 1, childKey });
+            }
+        }
+
+        if (w.numVerts + chunkNodeMax.verts > chunkVerts.size() || w.numIndices + chunkNodeMax.indices > chunkIndices.size()) {
+            flushMeshChunk();
+        }
+        // 時刻の取得は数十本ごとにまとめる
+        if (++count % 64 == 0 && ofGetElapsedTimeMicros() >= deadline) break;
+    }
+
+    if (stack.empty()) {
+        flushMeshChunk();
+        meshChunks.swap(buildChunks);
+        buildChunks.clear();
+        bChunkPending = false;
+    }
+}
+
+void Tree::flushMeshChunk() {
+    MeshWriter& w = chunkBuild.w;
+    if (w.numVerts == 0) return;
+
+    MeshChunk chunk;
+    chunk.numVerts = w.numVerts;
+    chunk.numIndices = w.numIndices;
+    chunk.boundsMin = chunk.boundsMax = chunkVerts[0];
+    for (size_t i = 1; i < w.numVerts; i++) {
+        chunk.boundsMin = glm::min(chunk.boundsMin, chunkVerts[i]);
+        chunk.boundsMax = glm::max(chunk.boundsMax, chunkVerts[i]);
+    }
+    chunk.vbo.setVertexData(chunkVerts.data(), (int)w.numVerts, GL_STATIC_DRAW);
+    chunk.vbo.setNormalData(chunkNormals.data(), (int)w.numVerts, GL_STATIC_DRAW);
+    chunk.vbo.setColorData(chunkColors.data(), (int)w.numVerts, GL_STATIC_DRAW);
+    chunk.vbo.setIndexData(chunkIndices.data(), (int)w.numIndices, GL_STATIC_DRAW);
+    buildChunks.push_back(chunk);
+
+    w.numVerts = 0;
+    w.numIndices = 0;
+}
+
+void Tree::drawMeshChunks() {
+    // 作り直し中は前回の木を、最初の構築中はできたチャンクから順に描く
+    glm::mat4 mvp = ofGetCurrentMatrix(OF_MATRIX_PROJECTION) * ofGetCurrentMatrix(OF_MATRIX_MODELVIEW);
+    for (auto& chunk : getDrawChunks()) {
+        if (!isBoxVisible(mvp, chunk.boundsMin, chunk.boundsMax)) continue;
+        chunk.vbo.drawElements(GL_TRIANGLES, (int)chunk.numIndices);
     }
 }
 
+void Tree::buildDedupMesh(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    // 深さの半分で切ると、幹側と共有する部分木の大きさが釣り合う
+    dedupDepth = max(1, depthLevel / 2);
+    size_t numSubtrees = 1;
+    float subLen = length, subThick = thickness;
+    for (int d = depthLevel; d > dedupDepth; d--) {
+        numSubtrees *= getBranchCount(d);
+        subLen *= s.branchLenRatio;
+        subThick *= s.branchThickRatio;
+    }
+
+    // バッファは [幹側 | 原点に置いた部分木1つ] の並び
+    const MeshCount& total = subtreeCounts[depthLevel];
+    const MeshCount& sub = subtreeCounts[dedupDepth];
+    MeshCount spine;
+    spine.verts = total.verts - numSubtrees * sub.verts;
+    spine.indices = total.indices - numSubtrees * sub.indices;
+    MeshCount c = spine;
+    c.verts += sub.verts;
+    c.indices += sub.indices;
+    resizeMesh(c);
+
+    dedupMats.clear();
+    MeshWriter w = beginMeshWrite(MeshCount());
+    planBranchMesh(length, thickness, depthLevel, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), dedupDepth, w);
+
+    MeshWriter tw = beginMeshWrite(spine);
+    buildBranchMesh(subLen, subThick, dedupDepth, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, 0, tw);
+    endMeshWrite(tw, spine);
+    dedupSpineIndices = spine.indices;
+    dedupSubtreeIndices = sub.indices;
+}
+
+void Tree::buildBranchMeshParallel(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    // ワーカー数より十分多くの部分木に分かれる深さで切る（先端2段は追記成長で使うので切らない）
+    size_t minTasks = WorkerPool::shared().getNumThreads() * 4;
+    int splitDepth = depthLevel - 1;
+    size_t numTasks = getBranchCount(depthLevel);
+    while (splitDepth > 1 && numTasks < minTasks) {
+        numTasks *= getBranchCount(splitDepth);
+        splitDepth--;
+    }
+
+    // 幹側の枝は直列に書き、部分木ごとに書き込み区間を予約する
+    buildTasks.clear();
+    MeshWriter spine = beginMeshWrite(MeshCount());
+    planBranchMesh(length, thickness, depthLevel, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), splitDepth, spine);
+    for (auto& task : buildTasks) task.writer = beginMeshWrite(task.offset);
+
+    WorkerPool::shared().parallelFor(buildTasks.size(), [&](size_t i) {
+        BuildTask& task = buildTasks[i];
+        buildBranchMesh(task.length, task.thickness, splitDepth, task.mat, chaosResist, bloomLevel, gType, fType, task.key, task.writer);
+        endMeshWrite(task.writer, task.offset);
+    });
+}
+
+void Tree::planBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, int splitDepth, MeshWriter& w) {
+    if (depth == splitDepth && bDedupBuild) {
+        // 同じ形の部分木は付け根の行列だけを記録し、構築は1回にまとめる
+        dedupMats.push_back(mat);
+        return;
+    }
+    if (depth == splitDepth) {
+        // 部分木の大きさは深さだけで決まるので、直列構築と同じ位置に区間を取れる
+        BuildTask task;
+        task.mat = mat;
+        task.length = length;
+        task.thickness = thickness;
+        task.key = key;
+        task.offset = { w.numVerts, w.numIndices, w.numTips, w.numLeaves, w.numStems };
+        buildTasks.push_back(task);
+
+        const MeshCount& c = subtreeCounts[depth];
+        w.numVerts += c.verts;
+        w.numIndices += c.indices;
+        w.numTips += c.tips;
+        w.numLeaves += c.leaves;
+        w.numStems += c.stems;
+        return;
+    }
+
+    glm::mat4 tipMat = addBranchNodeToMesh(length, thickness, depth, mat, chaosResist, bloomLevel, gType, fType, key, w);
+
+    int numBranches = getBranchCount(depth);
+    float angleBase = 25.0f + (meshMutation * 45.0f);
+    for (int i = 0; i < numBranches; i++) {
+        uint64_t childKey = BranchRng::child(key, i);
+        glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase, childKey);
+        planBranchMesh(length * s.branchLenRatio, thickness * s.branchThickRatio, depth - 1, childMat, chaosResist, bloomLevel, gType, fType, childKey, splitDepth, w);
+    }
+}
+
+void Tree::appendGrowthTier(int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    MeshCount first = { vboMesh.getNumVertices(), vboMesh.getNumIndices(), 0, 0 };
+    growStart = bGrowthPending ? min(growStart, first.verts) : first.verts;
+    bGrowthPending = true;
+    depthOffset = s.maxDepth - depthLevel;
+    // 色相・ノイズは既存の段と揃えるため、最後に全体を構築した時刻 (buildTime) のまま使う
+    bBvhDirty = true;
+
+    // 2段内側になった葉は退役させる
+    for (auto& leaf : leafTier) retireIndices(leaf.indexStart, leaf.indexCount);
+
+    // 先端だった枝はそのまま1段内側（葉の段）になる
+    swap(leafTier, tipTier);
+
+    // 追記する分（差し替える葉と新しい先端の枝）だけバッファを広げる
+    int numBranches = getBranchCount(1);
+    MeshCount leaf = countLeaf();
+    MeshCount node = countBranchNode(0, bloomLevel, fType);
+    MeshCount total = first;
+    for (auto& tip : leafTier) {
+        if (tip.decoKind != DECO_LEAF) {
+            total.verts += leaf.verts;
+            total.indices += leaf.indices;
+        }
+        total.verts += numBranches * node.verts;
+        total.indices += numBranches * node.indices;
+    }
+    total.tips = leafTier.size() * numBranches;
+    total.leaves = leafTier.size();
+    resizeMesh(total);
+
+    float angleBase = 25.0f + (meshMutation * 45.0f);
+    MeshWriter w = beginMeshWrite(first);
+
+    for (auto& tip : leafTier) {
+        // 先端だった枝は1段内側になるので、花は葉に差し替える
+        if (tip.decoKind != DECO_LEAF) {
+            retireIndices(tip.indexStart, tip.indexCount);
+            w.currentBirth = tierBirthTime;
+            w.currentAnchor = glm::vec3(tip.tipMat[3]);
+            size_t decoStart = w.numIndices;
+            addLeafToMesh(tip.thickness, tip.tipMat, w);
+            tip.indexStart = first.indices + decoStart;
+            tip.indexCount = w.numIndices - decoStart;
+            tip.decoKind = DECO_LEAF;
+        }
+
+        for (int i = 0; i < numBranches; i++) {
+            // 子のキーは経路だけで決まるので、作り直した場合と同じ枝が生える
+            uint64_t childKey = BranchRng::child(tip.key, i);
+            glm::mat4 childMat = getNextBranchMatrix(tip.tipMat, i, numBranches, angleBase, childKey);
+            buildBranchMesh(tip.length * s.branchLenRatio, tip.thickness * s.branchThickRatio, 0, childMat, chaosResist, bloomLevel, gType, fType, childKey, w);
+        }
+    }
+    endMeshWrite(w, first);
+
+    // 長く遊ぶと潰した三角形と使われない頂点が溜まるので、一定の割合を超えたら詰める
+    if (retiredIndices > vboMesh.getNumIndices() * s.compactRetired) compactRetired();
+    bPackDirty = true;
+    // 粗いメッシュは追記前の深さで作ってあるので、次に選ばれたときに作り直す
+    for (auto& lm : lodMeshes) lm.bDirty = true;
+}
+
+void Tree::retireIndices(size_t start, size_t count) {
+    // 頂点は残したまま、三角形を面積ゼロに潰して描画から外す
+    if (count == 0) return;
+    auto& idx = vboMesh.getIndices();
+    for (size_t i = start; i < start + count; i++) idx[i] = idx[start];
+    retiredIndices += count;
+}
+
+void Tree::compactRetired() {
+    // 潰した三角形を取り除き、どの三角形からも参照されなくなった頂点を元の順のまま詰める
+    auto& idx = vboMesh.getIndices();
+    size_t numTris = idx.size() / 3;
+    const ofIndexType UNUSED = std::numeric_limits<ofIndexType>::max();
+    vector<ofIndexType> remap(vboMesh.getNumVertices(), UNUSED);
+    vector<size_t> keptBefore(numTris + 1); // 三角形ごとの、それより前に残したインデックス数
+    size_t kept = 0;
+    for (size_t t = 0; t < numTris; t++) {
+        keptBefore[t] = kept;
+        ofIndexType a = idx[t * 3], b = idx[t * 3 + 1], c = idx[t * 3 + 2];
+        if (a == b && b == c) continue;
+        remap[a] = remap[b] = remap[c] = 0;
+        idx[kept++] = a;
+        idx[kept++] = b;
+        idx[kept++] = c;
+    }
+    keptBefore[numTris] = kept;
+
+    size_t numVerts = 0;
+    size_t newGrowStart = SIZE_MAX;
+    for (size_t i = 0; i < remap.size(); i++) {
+        if (i == growStart) newGrowStart = numVerts;
+        if (remap[i] != UNUSED) remap[i] = (ofIndexType)numVerts++;
+    }
+    growStart = min(newGrowStart, numVerts);
+
+    auto compact = [&](auto& v) {
+        if (v.size() != remap.size()) return;
+        for (size_t i = 0; i < remap.size(); i++) {
+            if (remap[i] != UNUSED) v[remap[i]] = v[i];
+        }
+        v.resize(numVerts);
+    };
+    compact(vboMesh.getVertices());
+    compact(vboMesh.getNormals());
+    compact(vboMesh.getColors());
+    compact(restAxis);
+    compact(restRadial);
+    compact(vertexBirth);
+    compact(vertexAnchor);
+
+    idx.resize(kept);
+    for (auto& i : idx) i = remap[i];
+    // 先端2段の装飾の範囲は退役していないので、前に残した数だけずらせばよい
+    for (auto& tip : tipTier) tip.indexStart = keptBefore[tip.indexStart / 3];
+    for (auto& leaf : leafTier) leaf.indexStart = keptBefore[leaf.indexStart / 3];
+    retiredIndices = 0;
+}
+
+RestPoseMesh::Pose Tree::getPose() const {
+    RestPoseMesh::Pose pose;
+    if (appliedLen >= 0) {
+        pose.lenK = (builtLen > 0) ? appliedLen / builtLen : 0.0f;
+        pose.thickK = (builtThick > 0) ? appliedThick / builtThick : 0.0f;
+    }
+    pose.time = ofGetElapsedTimef();
+    pose.growthDuration = s.growthDuration;
+    return pose;
+}
+
+void Tree::uploadPoseMesh() {
+    // CPU で姿勢を掛けた頂点は、静止姿勢の属性を付けずにそのまま描く
+    static const vector<glm::vec3> noVec3;
+    static const vector<float> noFloat;
+    bool bShader = isShaderPose();
+    const vector<glm::vec3>& radial = bShader ? restRadial : noVec3;
+    const vector<float>& birth = bShader ? vertexBirth : noFloat;
+    const vector<glm::vec3>& anchor = bShader ? vertexAnchor : noVec3;
+    if (isPackedDraw()) packedMesh.pack(vboMesh, radial, birth, anchor);
+    else poseMesh.upload(vboMesh, radial, birth, anchor);
+    bPackDirty = false;
+}
+
+void Tree::applyRestPose(size_t from) {
+    // 全ての長さは幹の長さに、全ての半径は幹の太さに比例するため、
+    // 構築時との比率を掛けるだけで補間中の形状になる
+    float lenK = (builtLen > 0) ? bLen / builtLen : 0.0f;
+    float thickK = (builtThick > 0) ? bThick / builtThick : 0.0f;
+    float now = ofGetElapsedTimef();
+
+    auto& verts = vboMesh.getVertices();
+    for (size_t i = from; i < verts.size(); i++) {
+        glm::vec3 p = restAxis[i] * lenK + restRadial[i] * thickK;
+        if (!vertexBirth.empty()) {
+            // 生えたばかりの枝は付け根からスケールインさせる (ease-out)
+            float g = ofClamp((now - vertexBirth[i]) / s.growthDuration, 0.0f, 1.0f);
+            if (g < 1.0f) {
+                g = 1.0f - pow(1.0f - g, 3.0f);
+                glm::vec3 anchor = vertexAnchor[i] * lenK;
+                p = anchor + (p - anchor) * g;
+            }
+        }
+        verts[i] = p;
+    }
+    appliedLen = bLen;
+    appliedThick = bThick;
+    bPackDirty = true;
+}
+
 void Tree::draw() {
-    vboMesh.draw();
+    int lod = bLodBuild ? selectLodLevel() : 0;
+    drawLod = (lod > 0 && !lodMeshes[lod - 1].bDirty) ? lod : 0;
+    if (drawLod > 0) {
+        drawLodMesh(lodMeshes[drawLod - 1]);
+    }
+    else if (bChunkedBuild) {
+        drawMeshChunks();
+    }
+    else if (bDedupBuild) {
+        drawDedupMesh();
+    }
+    else if (s.packedVertices) {
+        // 形が変わったフレームだけ詰め直して転送する（補間中の比率はシェーダで掛けるので詰め直さない）
+        if (bPackDirty) uploadPoseMesh();
+        packedMesh.draw(getPose());
+    }
+    else {
+        if (bPackDirty) uploadPoseMesh();
+        poseMesh.draw(getPose());
+    }
+
+    if (bInstancedBuild) {
+        if (bStemsDirty) {
+            stemInstancer.upload(stemInstances.data(), stemInstances.size());
+            bStemsDirty = false;
+        }
+        // 葉・花と同じ比率で長さ・太さを合わせる
+        float lenK = (s.rescaleGlide && builtLen > 0) ? appliedLen / builtLen : 1.0f;
+        float thickK = (s.rescaleGlide && builtThick > 0) ? appliedThick / builtThick : 1.0f;
+        stemInstancer.draw(lenK, thickK);
+    }
 }
 
-void Tree::water(float buff, int resilienceLevel, float increment) {
-    // デメリット軽減係数 (1レベルにつき15%軽減)
-    float penaltyFactor = 1.0f - (resilienceLevel * 0.15f);
+float Tree::getTreeHeight() const {
+    // 幹から先端までの長さの和（等比級数）
+    float len = (s.rescaleGlide ? bLen : builtLen) * s.lenScale;
+    float r = s.branchLenRatio;
+    if (r >= 1.0f) return len * (depthLevel + 1);
+    return len * (1.0f - pow(r, depthLevel + 1)) / (1.0f - r);
+}
+
+int Tree::selectLodLevel() {
+    if (lodOverride >= 0) return lodTarget = lodOverride;
+    // 木の外接球を画面に投影した直径（ピクセル）でレベルを選ぶ
+    glm::mat4 modelView = ofGetCurrentMatrix(OF_MATRIX_MODELVIEW);
+    float height = getTreeHeight();
+    glm::vec4 center = modelView * glm::vec4(0, height * 0.5f, 0, 1);
+    float radius = height * 0.6f * glm::length(glm::vec3(modelView[1]));
+    float dist = -center.z;
+    float size = std::numeric_limits<float>::max();
+    if (dist > radius) {
+        size = radius * 2.0f * ofGetCurrentMatrix(OF_MATRIX_PROJECTION)[1][1] / dist * ofGetViewportHeight() * 0.5f;
+    }
 
-    depthExp += 5.0f * buff;
+    // 境界付近で行き来しないよう、切り替えの前後で閾値に幅を持たせる
+    int lod = lodTarget;
+    while (lod > 0 && size > s.lodScreenSize[lod - 1] * (1.0f + s.lodHysteresis)) lod--;
+    while (lod < NUM_LOD_LEVELS - 1 && size < s.lodScreenSize[lod] * (1.0f - s.lodHysteresis)) lod++;
+    lodTarget = lod;
+    return lod;
+}
+
+void Tree::buildLodMesh(int level, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    // 最も細かいメッシュと同じ構築時の長さ・太さ・乱数で、角数と装飾だけを減らして作る
+    LodMesh& lm = lodMeshes[level - 1];
+    buildLod = level;
+    buildCards = s.foliageCards && level >= s.foliageCardLod && depthLevel > s.foliageCardDepth;
+    buildSubtreeTables(depthLevel, bloomLevel, fType);
+    const MeshCount& c = subtreeCounts[depthLevel];
+    lm.mesh.getVertices().resize(c.verts);
+    lm.mesh.getNormals().resize(c.verts);
+    lm.mesh.getColors().resize(c.verts);
+    lm.mesh.getIndices().resize(c.indices);
+    lm.restAxis.resize(s.rescaleGlide ? c.verts : 0);
+    lm.restRadial.resize(s.rescaleGlide ? c.verts : 0);
+
+    MeshWriter w;
+    w.verts = lm.mesh.getVerticesPointer();
+    w.normals = lm.mesh.getNormalsPointer();
+    w.colors = lm.mesh.getColorsPointer();
+    w.indices = lm.mesh.getIndexPointer();
+    if (s.rescaleGlide) {
+        w.axis = lm.restAxis.data();
+        w.radial = lm.restRadial.data();
+    }
+    size_t numCards = buildCards ? 1 : 0;
+    for (int d = depthLevel; buildCards && d > s.foliageCardDepth; d--) numCards *= getBranchCount(d);
+    vector<glm::mat4> cardMats(numCards);
+    w.cards = cardMats.data();
+    buildBranchMesh(builtLen * s.lenScale, builtThick * s.thickScale, depthLevel, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), w);
+    cardMats.resize(w.numCards);
+    buildLodCards(lm, cardMats, bloomLevel, fType);
+
+    // 段の追記は最も細かいメッシュの表を使う
+    buildLod = 0;
+    buildCards = false;
+    buildSubtreeTables(depthLevel, bloomLevel, fType);
+    lm.appliedLen = lm.appliedThick = -1;
+    lm.bDirty = false;
+    lm.bUploadDirty = true;
+}
 
-    float lenGain = increment * 2.0f * buff;
-    tLen += lenGain;
-    totalLenEarned += lenGain; // 累積加算
+void Tree::drawLodMesh(LodMesh& lm) {
+    // 補間中の長さ・太さはシェーダで掛ける。使えない場合は描画するレベルにだけ CPU で反映する
+    RestPoseMesh::Pose pose = getPose();
+    if (!lm.pose.isReady() && s.rescaleGlide && (lm.appliedLen != appliedLen || lm.appliedThick != appliedThick)) {
+        auto& verts = lm.mesh.getVertices();
+        for (size_t i = 0; i < verts.size(); i++) verts[i] = lm.restAxis[i] * pose.lenK + lm.restRadial[i] * pose.thickK;
+        lm.appliedLen = appliedLen;
+        lm.appliedThick = appliedThick;
+        lm.bUploadDirty = true;
+    }
+    if (lm.bUploadDirty) {
+        static const vector<float> noBirth;
+        static const vector<glm::vec3> noAnchor;
+        lm.pose.upload(lm.mesh, lm.restRadial, noBirth, noAnchor);
+        lm.bUploadDirty = false;
+    }
+    lm.pose.draw(pose);
+
+    if (lm.cardMesh.getNumVertices() == 0) return;
+    // 透明な画素はアルファテストで捨て、並べ替えなしで奥行きを書き込む
+    // カードは房全体の広がりが長さに比例するので、原点を中心に長さの比率だけ拡大する
+    const FoliageCard& card = foliageCards[lm.cardKey];
+    float cardK = s.rescaleGlide ? pose.lenK : 1.0f;
+    ofPushMatrix();
+    ofScale(cardK);
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5f);
+    card.bind();
+    lm.cardMesh.draw();
+    card.unbind();
+    glDisable(GL_ALPHA_TEST);
+    glDisable(GL_NORMALIZE);
+    ofPopMatrix();
+}
 
-    // デメリット（太さ減少）に軽減を適用
-    tThick = max(2.0f, tThick - (3.0f * penaltyFactor));
-    tMutation = max(0.0f, tMutation - 0.1f);
+uint64_t Tree::getFoliageCardKey(float length, float thickness, int bloomLevel, FlowerType fType) const {
+    // 房の見た目は花の種類・色と、房の付け根の枝の長さ・太さ・分岐角・分岐数で決まる
+    uint64_t h = MeshCache::hash(nullptr, 0);
+    auto add = [&](auto v) { h = MeshCache::hashValue(v, h); };
+    add((int)fType); add(isBloomed(bloomLevel)); add(s.leafColor); add(s.flowerColor);
+    add((int)roundf(length * 100.0f)); add((int)roundf(thickness * 100.0f)); add((int)roundf(meshMutation * 100.0f));
+    add(s.foliageCardDepth); add(s.foliageCardSize);
+    for (int d = 1; d <= s.foliageCardDepth; d++) add(getBranchCount(d));
+    return h;
 }
 
-void Tree::fertilize(float buff, int resilienceLevel, float increment) {
-    float penaltyFactor = 1.0f - (resilienceLevel * 0.15f);
+FoliageCard& Tree::getFoliageCard(uint64_t cardKey, float length, float thickness, int bloomLevel, FlowerType fType) {
+    auto it = foliageCards.find(cardKey);
+    if (it != foliageCards.end()) return it->second;
 
-    depthExp += 5.0f * buff;
+    // 溜まりすぎたら、描画中のレベルが使っていないカードを捨てる
+    if (foliageCards.size() >= 32) {
+        for (auto i = foliageCards.begin(); i != foliageCards.end();) {
+            bool bUsed = false;
+            for (auto& lm : lodMeshes) bUsed |= (!lm.bDirty && lm.cardKey == i->first);
+            i = bUsed ? std::next(i) : foliageCards.erase(i);
+        }
+    }
+
+    // 房の付け根を原点として、最も細かいレベルの葉・花を実際に作る
+    int lod = buildLod;
+    buildLod = 0;
+    MeshCount c = countDeco(0, bloomLevel, fType);
+    for (int d = 1; d <= s.foliageCardDepth; d++) {
+        MeshCount deco = countDeco(d, bloomLevel, fType);
+        c.verts = deco.verts + c.verts * getBranchCount(d);
+        c.indices = deco.indices + c.indices * getBranchCount(d);
+    }
+    vector<glm::vec3> verts(c.verts), normals(c.verts);
+    vector<ofFloatColor> colors(c.verts);
+    vector<ofIndexType> indices(c.indices);
+    MeshWriter w;
+    w.verts = verts.data();
+    w.normals = normals.data();
+    w.colors = colors.data();
+    w.indices = indices.data();
+    addClusterDecoToMesh(s.foliageCardDepth, length, thickness, glm::mat4(1.0), bloomLevel, fType, BranchRng::root(seed), w);
+    buildLod = lod;
+
+    FoliageCard& card = foliageCards[cardKey];
+    card.build(verts.data(), colors.data(), indices.data(), w.numIndices, s.foliageCardSize);
+    return card;
+}
+
+void Tree::addClusterDecoToMesh(int depth, float length, float thickness, const glm::mat4& tipMat, int bloomLevel, FlowerType fType, uint64_t key, MeshWriter& w) {
+    // buildBranchMesh と同じ配置で、枝を除いた装飾だけを辿る
+    addDecoToMesh(depth, thickness, tipMat, bloomLevel, fType, w);
+    if (depth == 0) return;
+    int numBranches = getBranchCount(depth);
+    float angleBase = 25.0f + (meshMutation * 45.0f);
+    for (int i = 0; i < numBranches; i++) {
+        uint64_t childKey = BranchRng::child(key, i);
+        float childLen = length * s.branchLenRatio;
+        glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase, childKey);
+        glm::mat4 childTip = glm::translate(childMat, glm::vec3(0, childLen, 0));
+        addClusterDecoToMesh(depth - 1, childLen, thickness * s.branchThickRatio, childTip, bloomLevel, fType, childKey, w);
+    }
+}
+
+void Tree::buildLodCards(LodMesh& lm, const vector<glm::mat4>& cardMats, int bloomLevel, FlowerType fType) {
+    lm.cardMesh.clear();
+    if (cardMats.empty()) return;
+
+    // 房の付け根の枝の長さ・太さは全ての房で共通
+    float len = builtLen * s.lenScale * pow(s.branchLenRatio, depthLevel - s.foliageCardDepth);
+    float thick = builtThick * s.thickScale * pow(s.branchThickRatio, depthLevel - s.foliageCardDepth);
+    lm.cardKey = getFoliageCardKey(len, thick, bloomLevel, fType);
+    const FoliageCard& card = getFoliageCard(lm.cardKey, len, thick, bloomLevel, fType);
+
+    size_t numVerts = cardMats.size() * FoliageCard::NUM_VERTS;
+    auto& verts = lm.cardMesh.getVertices();
+    auto& normals = lm.cardMesh.getNormals();
+    auto& texCoords = lm.cardMesh.getTexCoords();
+    auto& indices = lm.cardMesh.getIndices();
+    verts.resize(numVerts);
+    normals.resize(numVerts);
+    texCoords.resize(numVerts);
+    indices.resize(cardMats.size() * FoliageCard::NUM_INDICES);
+    lm.cardMesh.getColors().assign(numVerts, ofFloatColor(1.0f));
+    for (size_t i = 0; i < cardMats.size(); i++) {
+        size_t v = i * FoliageCard::NUM_VERTS;
+        card.getCardVertices(cardMats[i], &verts[v], &texCoords[v]);
+        FoliageCard::addCardIndices((ofIndexType)v, &indices[i * FoliageCard::NUM_INDICES]);
+        // 花と同じく房の上向きを法線にして、カードの裏表で明るさを揃える
+        glm::vec3 n = glm::normalize(glm::mat3(cardMats[i]) * glm::vec3(0, 1, 0));
+        for (int k = 0; k < FoliageCard::NUM_VERTS; k++) normals[v + k] = n;
+    }
+}
+
+void Tree::drawDedupMesh() {
+    // 頂点は幹側と部分木1つ分だけなので、形が変わったフレームはそのまま転送する
+    if (bPackDirty) uploadPoseMesh();
+
+    // 部分木の付け根は軸上の点なので、補間中は長さの比率だけ動かす（部分木の中はシェーダで掛ける）
+    RestPoseMesh::Pose pose = getPose();
+    float lenK = (s.rescaleGlide && builtLen > 0) ? appliedLen / builtLen : 1.0f;
+    poseMesh.begin(pose);
+    poseMesh.drawElements(dedupSpineIndices, 0);
+    for (auto& m : dedupMats) {
+        glm::mat4 world = m;
+        world[3] = glm::vec4(glm::vec3(m[3]) * lenK, 1.0f);
+        ofPushMatrix();
+        ofMultMatrix(world);
+        poseMesh.drawElements(dedupSubtreeIndices, dedupSpineIndices);
+        ofPopMatrix();
+    }
+    poseMesh.end();
+}
+
+size_t Tree::getNumVertices() {
+    size_t n = vboMesh.getNumVertices();
+    for (auto& chunk : getDrawChunks()) n += chunk.numVerts;
+    return n;
+}
 
-    // デメリット（長さ減少）に軽減を適用
-    tLen = max(10.0f, tLen - (5.0f * penaltyFactor));
+size_t Tree::getMeshBytes() {
+    size_t bytes = bInstancedBuild ? stemInstancer.getNumBytes() : 0;
+    for (auto* chunks : { &meshChunks, &buildChunks }) {
+        for (auto& chunk : *chunks) bytes += chunk.numVerts * (sizeof(glm::vec3) * 2 + sizeof(ofFloatColor)) + chunk.numIndices * sizeof(ofIndexType);
+    }
+    for (auto& lm : lodMeshes) {
+        if (lm.bDirty) continue;
+        bytes += lm.pose.getNumBytes();
+        bytes += lm.cardMesh.getNumVertices() * (sizeof(glm::vec3) * 2 + sizeof(glm::vec2) + sizeof(ofFloatColor)) + lm.cardMesh.getNumIndices() * sizeof(ofIndexType);
+    }
+    if (bDedupBuild) bytes += dedupMats.size() * sizeof(glm::mat4);
+    if (bChunkedBuild) return bytes;
+    if (isPackedDraw()) return bytes + packedMesh.getNumBytes();
+    return bytes + poseMesh.getNumBytes();
+}
 
-    float thickGain = increment * 2.0f * buff;
-    tThick += thickGain;
-    totalThickEarned += thickGain; // 累積加算
+// コマンドの効果は GrowthRules（窓の無いシミュレーションと共通）で計算する
+void Tree::water(float buff, int resilienceLevel, float increment) {
+    GrowthTargets g = getTargets();
+    GrowthRules::water(g, buff, resilienceLevel, increment);
+    setTargets(g);
+}
 
-    tMutation = max(0.0f, tMutation - 0.05f);
+void Tree::fertilize(float buff, int resilienceLevel, float increment) {
+    GrowthTargets g = getTargets();
+    GrowthRules::fertilize(g, buff, resilienceLevel, increment);
+    setTargets(g);
 }
 
 void Tree::kotodama(float buff) {
-    depthExp += 5.0f * buff;
-    tLen += 10.0f * buff;
-    tThick = max(2.0f, tThick - 5.0f);
+    GrowthTargets g = getTargets();
+    GrowthRules::kotodama(g, buff);
+    setTargets(g);
+}
 
-    float mutGain = 0.2f * buff;
-    tMutation = ofClamp(tMutation + mutGain, 0.0f, 1.0f);
-    totalMutationEarned += mutGain; // 累積加算
+GrowthTargets Tree::getTargets() const {
+    GrowthTargets g;
+    g.depthExp = depthExp;
+    g.len = tLen;
+    g.thick = tThick;
+    g.mutation = tMutation;
+    g.totalLen = totalLenEarned;
+    g.totalThick = totalThickEarned;
+    g.totalMutation = totalMutationEarned;
+    return g;
+}
+
+void Tree::setTargets(const GrowthTargets& g) {
+    depthExp = g.depthExp;
+    tLen = g.len;
+    tThick = g.thick;
+    tMutation = g.mutation;
+    totalLenEarned = g.totalLen;
+    totalThickEarned = g.totalThick;
+    totalMutationEarned = g.totalMutation;
 }
 
 void Tree::applyEvolution(GrowthType type) {
@@ -112,134 +1019,402 @@ void Tree::applyEvolution(GrowthType type) {
     bNeedsUpdate = true; // メッシュを再構築
 }
 
-glm::mat4 Tree::getNextBranchMatrix(glm::mat4 tipMat, int index, int total, float angleBase) {
+glm::mat4 Tree::getNextBranchMatrix(glm::mat4 tipMat, int index, int total, float angleBase, uint64_t childKey) {
     glm::mat4 m = tipMat;
     // Y軸回転で円状に配置
     m = glm::rotate(m, glm::radians(index * (360.0f / total)), glm::vec3(0, 1, 0));
     // 外側へ倒す回転（カオス度による揺らぎ）
-    float wobble = ofRandom(-10, 10) * bMutation;
+    float wobble = BranchRng::range(childKey, -10, 10) * meshMutation;
     m = glm::rotate(m, glm::radians(angleBase + wobble), glm::vec3(0, 0, 1));
     return m;
 }
 
-void Tree::buildBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
-    if (depth < 0) return;
+bool Tree::getBranchMatrix(const vector<int>& path, glm::mat4& out) {
+    // 深さより長い経路や範囲外の分岐番号は、存在しない枝なので拒否する（丸めると別の枝を返してしまう）
+    if ((int)path.size() > depthLevel) return false;
+    // 乱数は経路のキーだけで決まるので、他の枝を辿らずに深さ分の計算で求まる
+    glm::mat4 mat(1.0);
+    float length = builtLen * s.lenScale;
+    float angleBase = 25.0f + (meshMutation * 45.0f);
+    uint64_t key = BranchRng::root(seed);
+    int depth = depthLevel;
+    for (int index : path) {
+        int numBranches = getBranchCount(depth);
+        if (index < 0 || index >= numBranches) return false;
+        glm::mat4 tipMat = glm::translate(mat, glm::vec3(0, length, 0));
+        key = BranchRng::child(key, index);
+        mat = getNextBranchMatrix(tipMat, index, numBranches, angleBase, key);
+        length *= s.branchLenRatio;
+        depth--;
+    }
+    out = mat;
+    return true;
+}
 
-    // 現在の枝（幹）をメッシュに追加
-    addStemToMesh(thickness, thickness * s.branchThickRatio, length, mat, chaosResist, depth, gType);
+void Tree::buildBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, MeshWriter& w) {
+    if (depth < 0) return;
 
-    // 枝の先端の行列を計算
-    glm::mat4 tipMat = glm::translate(mat, glm::vec3(0, length, 0));
+    glm::mat4 tipMat = addBranchNodeToMesh(length, thickness, depth, mat, chaosResist, bloomLevel, gType, fType, key, w);
+    if (w.exporter) flushToExporter(w);
+    if (depth == 0) return;
 
-    // --- 装飾（葉・花）のロジック ---
-    float bloomThreshold = s.bloomThreshold - (bloomLevel * 0.05f);
-    bool isBloomed = (maxMutationReached > bloomThreshold);
+    // --- 次の枝への再帰 ---
+    int numBranches = getBranchCount(depth);
+    float angleBase = 25.0f + (meshMutation * 45.0f); // カオス度で分岐角が広がる
 
-    if (depth == 0 && (isBloomed || fType != FLOWER_NONE)) {
-        addFlowerToMesh(thickness, tipMat, fType);
+    for (int i = 0; i < numBranches; i++) {
+        uint64_t childKey = BranchRng::child(key, i);
+        glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase, childKey);
+        buildBranchMesh(length * s.branchLenRatio, thickness * s.branchThickRatio, depth - 1, childMat, chaosResist, bloomLevel, gType, fType, childKey, w);
     }
-    else if (depth <= 1) {
-        addLeafToMesh(thickness, tipMat);
+}
+
+void Tree::buildBranchBvh() {
+    // メッシュと同じ行列を辿り、枝ごとにカプセル（付け根・先端・半径）を1つ集める
+    branchBvh.clear();
+    if (builtLen > 0) {
+        float angleBase = 25.0f + (meshMutation * 45.0f);
+        // 頂点ノイズで輪が膨らむ分だけ半径を広げる
+        float radiusPad = hasStemNoise() ? ofMap(meshMaxMutation, 0.8f, 1.0f, 0.0f, s.noiseStrengthMax, true) : 0.0f;
+        size_t numBranches = 1;
+        for (int d = 1; d <= depthLevel; d++) numBranches = 1 + getBranchCount(d) * numBranches;
+        branchBvh.getBranches().reserve(numBranches);
+        addBranchToBvh(builtLen * s.lenScale, builtThick * s.thickScale, depthLevel, glm::mat4(1.0), -1, angleBase, radiusPad, BranchRng::root(seed));
     }
+    branchBvh.build();
+    bBvhDirty = false;
+}
 
-    // --- 次の枝への再帰 ---
-    float gravityBend = (gType == TYPE_STURDY) ? 15.0f : 0.0f;
-    int numBranches = (depth < 2) ? 2 : 3;
-    float angleBase = 25.0f + (bMutation * 45.0f); // カオス度で分岐角が広がる
+void Tree::addBranchToBvh(float length, float thickness, int depth, glm::mat4 mat, int parent, float angleBase, float radiusPad, uint64_t key) {
+    auto& branches = branchBvh.getBranches();
+    int index = (int)branches.size();
+    glm::mat4 tipMat = glm::translate(mat, glm::vec3(0, length, 0));
 
-    for (int i = 0; i < numBranches; i++) {
-        glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase);
-        buildBranchMesh(length * s.branchLenRatio, thickness * s.branchThickRatio, depth - 1, childMat, chaosResist, bloomLevel, gType, fType);
+    BranchBvh::Branch b;
+    b.base = glm::vec3(mat[3]);
+    b.tip = glm::vec3(tipMat[3]);
+    b.radius = thickness + radiusPad;
+    b.level = depthLevel - depth;
+    b.parent = parent;
+    b.hue = getStemHue(depth + depthOffset, meshType);
+    branches.push_back(b);
+
+    if (depth > 0) {
+        int numBranches = getBranchCount(depth);
+        for (int i = 0; i < numBranches; i++) {
+            uint64_t childKey = BranchRng::child(key, i);
+            glm::mat4 childMat = getNextBranchMatrix(tipMat, i, numBranches, angleBase, childKey);
+            addBranchToBvh(length * s.branchLenRatio, thickness * s.branchThickRatio, depth - 1, childMat, index, angleBase, radiusPad, childKey);
+        }
     }
+    branches[index].subtreeSize = (int)branches.size() - index;
+}
+
+void Tree::getBvhScale(float& lenK, float& thickK) const {
+    // 補間中は描画と同じ比率を掛ける（分割構築のメッシュはスケールしない）
+    bool bScaled = s.rescaleGlide && !bChunkedBuild && appliedLen >= 0;
+    lenK = (bScaled && builtLen > 0) ? appliedLen / builtLen : 1.0f;
+    thickK = (bScaled && builtThick > 0) ? appliedThick / builtThick : 1.0f;
 }
 
-void Tree::addStemToMesh(float r1, float r2, float h, glm::mat4 mat, int chaosResist, int depth, GrowthType gType) {
-    int segments = (depth <= 4) ? 3 : 5; // LOD: 深い枝ほど角数を減らす
-    int subdivisions = 4;                // 縦方向の分割数
-    int numRings = subdivisions + 1;
+bool Tree::pickBranch(const glm::vec3& origin, const glm::vec3& dir, BranchBvh::Hit& hit) {
+    if (bBvhDirty) buildBranchBvh();
+    float lenK, thickK;
+    getBvhScale(lenK, thickK);
+    return branchBvh.raycast(origin, dir, lenK, thickK, hit);
+}
 
-    // --- 色の計算 ---
-    float timeShift = ofGetElapsedTimef() * 20.0f;
-    if (gType == TYPE_ELDRITCH) {
-        timeShift = ofGetElapsedTimef() * 100.0f; // Eldritchは激しく色が動く
+bool Tree::getBranchInfo(int index, BranchBvh::Hit& hit) {
+    if (bBvhDirty) buildBranchBvh();
+    if (index < 0 || index >= (int)branchBvh.size()) return false;
+    float lenK, thickK;
+    getBvhScale(lenK, thickK);
+    hit.index = index;
+    hit.branch = branchBvh.getBranch(index);
+    hit.branch.base *= lenK;
+    hit.branch.tip *= lenK;
+    hit.branch.radius *= thickK;
+    return true;
+}
+
+bool Tree::exportMesh(const string& path, float time, int depth, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    MeshExporter::Format format;
+    if (!MeshExporter::getFormatFromPath(path, format)) {
+        ofLogError("Tree") << "unsupported export format: " << path;
+        return false;
     }
-    float hueBase = ofMap(bMutation, 0, 1, s.trunkHueStart, s.trunkHueEnd);
-    float finalHue = fmod(hueBase + timeShift + (depth * 10), 255.0f);
-    ofColor col = ofColor::fromHsb(finalHue, 160, 180 + (depth * 10));
-    
-    float collapseThreshold = 0.9f + (chaosResist * 0.02f);
 
-    float mutationUneri = 0.0f;
-    if (maxMutationReached > 0.5f) {
-        mutationUneri = ofMap(bMutation, 0.5f, 1.0f, 0.0f, s.uneriStrengthMax, true);
+    // 描画中のメッシュの構築状態を退避し、同じ生成処理を通常のメッシュ形式で走らせる
+    int savedDepthOffset = depthOffset;
+    bool savedInstanced = bInstancedBuild, savedDedup = bDedupBuild, savedAppendable = bAppendable;
+    float savedMutation = meshMutation, savedMaxMutation = meshMaxMutation, savedTime = buildTime;
+    vector<MeshCount> savedCounts;
+    savedCounts.swap(subtreeCounts);
+    // 色相・ノイズは描画中のメッシュを作った時刻ではなく、指定の時刻で決める
+    buildTime = time;
+    depthOffset = 0;
+    bInstancedBuild = bDedupBuild = bAppendable = false;
+    meshMutation = bMutation;
+    meshMaxMutation = maxMutationReached;
+
+    // 作業領域は枝1本（＋装飾）分だけ
+    buildSubtreeTables(depth, bloomLevel, fType);
+    MeshCount node;
+    for (int d = 0; d <= depth; d++) {
+        MeshCount c = countBranchNode(d, bloomLevel, fType);
+        node.verts = max(node.verts, c.verts);
+        node.indices = max(node.indices, c.indices);
+    }
+    vector<glm::vec3> verts(node.verts), normals(node.verts);
+    vector<ofFloatColor> colors(node.verts);
+    vector<ofIndexType> indices(node.indices);
+
+    MeshExporter exporter;
+    const MeshCount& total = subtreeCounts[depth];
+    bool ok = exporter.begin(path, format, total.verts, total.indices);
+    if (ok) {
+        MeshWriter w;
+        w.verts = verts.data();
+        w.normals = normals.data();
+        w.colors = colors.data();
+        w.indices = indices.data();
+        w.exporter = &exporter;
+        buildBranchMesh(bLen * s.lenScale, bThick * s.thickScale, depth, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), w);
+        ok = exporter.end();
     }
+    if (ok) ofLogNotice("Tree") << "exported " << total.verts << " vertices to " << path;
+
+    depthOffset = savedDepthOffset;
+    bInstancedBuild = savedInstanced;
+    bDedupBuild = savedDedup;
+    bAppendable = savedAppendable;
+    meshMutation = savedMutation;
+    meshMaxMutation = savedMaxMutation;
+    buildTime = savedTime;
+    subtreeCounts.swap(savedCounts);
+    return ok;
+}
 
-    float noiseTrigger = 0.8f;
+void Tree::buildStaticMesh(ofMesh& out, int treeSeed, float time, int lod, int depth, float len, float thick, float mutation, float maxMutation, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) {
+    // exportMesh と同じく構築状態を退避し、設定は成長タイプの分だけ一時的に変える
+    TreeSettings savedSettings = s;
+    int savedSeed = seed, savedDepthOffset = depthOffset, savedLod = buildLod;
+    bool savedInstanced = bInstancedBuild, savedDedup = bDedupBuild, savedAppendable = bAppendable;
+    bool savedCards = buildCards, savedNeedsUpdate = bNeedsUpdate;
+    float savedMutation = meshMutation, savedMaxMutation = meshMaxMutation, savedTime = buildTime;
+    vector<MeshCount> savedCounts;
+    savedCounts.swap(subtreeCounts);
+
+    if (gType != TYPE_DEFAULT) applyEvolution(gType);
+    seed = treeSeed;
+    buildTime = time;
+    depthOffset = 0;
+    bInstancedBuild = bDedupBuild = bAppendable = false;
+    buildLod = (int)ofClamp(lod, 0, NUM_LOD_LEVELS - 1);
+    buildCards = false;
+    meshMutation = mutation;
+    meshMaxMutation = max(mutation, maxMutation);
+
+    buildSubtreeTables(depth, bloomLevel, fType);
+    const MeshCount& c = subtreeCounts[depth];
+    out.getVertices().resize(c.verts);
+    out.getNormals().resize(c.verts);
+    out.getColors().resize(c.verts);
+    out.getIndices().resize(c.indices);
+    MeshWriter w;
+    w.verts = out.getVerticesPointer();
+    w.normals = out.getNormalsPointer();
+    w.colors = out.getColorsPointer();
+    w.indices = out.getIndexPointer();
+    buildBranchMesh(len * s.lenScale, thick * s.thickScale, depth, glm::mat4(1.0), chaosResist, bloomLevel, gType, fType, BranchRng::root(seed), w);
+
+    s = savedSettings;
+    seed = savedSeed;
+    depthOffset = savedDepthOffset;
+    buildLod = savedLod;
+    bInstancedBuild = savedInstanced;
+    bDedupBuild = savedDedup;
+    bAppendable = savedAppendable;
+    buildCards = savedCards;
+    bNeedsUpdate = savedNeedsUpdate;
+    meshMutation = savedMutation;
+    meshMaxMutation = savedMaxMutation;
+    buildTime = savedTime;
+    subtreeCounts.swap(savedCounts);
+}
 
-    // 法線変換用の行列
-    glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(mat));
+void Tree::flushToExporter(MeshWriter& w) {
+    w.exporter->addVertices(w.verts, w.normals, w.colors, w.numVerts);
+    w.exporter->addIndices(w.indices, w.numIndices, w.streamBase);
+    w.streamBase += w.numVerts;
+    w.numVerts = 0;
+    w.numIndices = 0;
+}
 
-    // 現在のVBOの頂点開始インデックスを記録
-    int startIndex = vboMesh.getNumVertices();
+glm::mat4 Tree::addBranchNodeToMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, MeshWriter& w) {
+    // 段を追記する成長モードでは、最終的な深さ (maxDepth) を基準に分岐数・LOD・色を決める
+    int structDepth = depth + depthOffset;
+
+    if (s.incrementalGrowth) {
+        // 最新の段は生えた時刻を記録し、付け根からスケールインさせる
+        w.currentBirth = (depth == 0) ? tierBirthTime : -1e6f;
+        w.currentAnchor = glm::vec3(mat[3]);
+    }
+
+    // 現在の枝（幹）をメッシュに追加
+    addStemToMesh(thickness, thickness * s.branchThickRatio, length, mat, chaosResist, structDepth, gType, w);
 
-    // 1. 頂点と法線の生成
-    for (int ring = 0; ring < numRings; ring++) {
-        float ratio = (float)ring / subdivisions;
-        float currentR = ofLerp(r1, r2, ratio); // テーパリング
-        float currentY = h * ratio;
+    // 枝の先端の行列を計算
+    glm::mat4 tipMat = glm::translate(mat, glm::vec3(0, length, 0));
+
+    // --- 装飾（葉・花）のロジック ---
+    size_t decoStart = w.numIndices;
+    DecoKind decoKind = DECO_NONE;
+    if (!buildCards) {
+        decoKind = addDecoToMesh(depth, thickness, tipMat, bloomLevel, fType, w);
+    }
+    else if (depth == s.foliageCardDepth) {
+        // この枝から先の葉・花（先端の房）はまとめて1組のカードにする
+        w.cards[w.numCards++] = tipMat;
+    }
 
-        // 進化タイプや設定に応じた「ねじれ」の適用
-        float twistAngle = glm::radians((s.twistFactor + mutationUneri) * ratio);
+    // 次の段を追記するときのために、先端2段の枝と装飾の位置を覚えておく
+    if (w.tips && depth <= 1) {
+        GrowthTip tip{ tipMat, length, thickness, decoStart, w.numIndices - decoStart, decoKind, key };
+        if (depth == 0) w.tips[w.numTips++] = tip;
+        else w.leaves[w.numLeaves++] = tip;
+    }
+    return tipMat;
+}
 
-        for (int i = 0; i < segments; i++) {
-            float angle = (i * TWO_PI / segments) + twistAngle;
-            glm::vec3 unitPos(cos(angle), 0, sin(angle));
+Tree::DecoKind Tree::addDecoToMesh(int depth, float thickness, const glm::mat4& tipMat, int bloomLevel, FlowerType fType, MeshWriter& w) {
+    if (depth == 0 && (isBloomed(bloomLevel) || fType != FLOWER_NONE)) {
+        addFlowerToMesh(thickness, tipMat, fType, w);
+        return DECO_FLOWER;
+    }
+    if (depth <= 1) {
+        addLeafToMesh(thickness, tipMat, w);
+        return DECO_LEAF;
+    }
+    return DECO_NONE;
+}
 
-            // 頂点座標（ローカル）
-            glm::vec4 p(unitPos.x * currentR, currentY, unitPos.z * currentR, 1);
+void Tree::addStemToMesh(float r1, float r2, float h, glm::mat4 mat, int chaosResist, int depth, GrowthType gType, MeshWriter& w) {
+    int segments = getStemSegments(depth);
+    int subdivisions = lodLevels[buildLod].subdivisions; // 縦方向の分割数
 
-            // カオス度が高い場合の頂点ノイズ（最上段に近いほど強く揺らす）
-            if (maxMutationReached > noiseTrigger && ring > 0) {
-                float nStr = ofMap(maxMutationReached, noiseTrigger, 1.0f, 0.0f, s.noiseStrengthMax, true) * ratio;
-                p.x += ofSignedNoise(p.x * 0.1, p.y * 0.1, ofGetElapsedTimef()) * nStr;
-                p.z += ofSignedNoise(p.z * 0.1, p.y * 0.1, ofGetElapsedTimef() + 10.0f) * nStr;
-            }
+    // --- 色の計算 ---
+    ofColor col = ofColor::fromHsb(getStemHue(depth, gType), 160, 180 + (depth * 10));
+    
+    float collapseThreshold = 0.9f + (chaosResist * 0.02f);
 
-            // VBOへの登録
-            vboMesh.addVertex(glm::vec3(mat * p));
-            vboMesh.addNormal(normalMatrix * unitPos); // 簡易法線
-            vboMesh.addColor(col);
+    float mutationUneri = 0.0f;
+    if (meshMaxMutation > 0.5f) {
+        mutationUneri = ofMap(meshMutation, 0.5f, 1.0f, 0.0f, s.uneriStrengthMax, true);
+    }
+
+    if (w.stems) {
+        // 形は正準メッシュに任せ、行列と寸法・色だけを書き出す
+        StemInstancer::Instance& inst = w.stems[w.numStems++];
+        inst.mat = mat;
+        inst.shape = glm::vec4(r1, r2, h, glm::radians(s.twistFactor + mutationUneri));
+        inst.color = col;
+        inst.segments = segments;
+        return;
+    }
+
+    // 1. 頂点と法線の生成（断面の輪をローカル座標でまとめて作る）
+    const RingKernel::StemRings& rings = getStemRings(segments, subdivisions, r1, r2, h, glm::radians(s.twistFactor + mutationUneri), depth);
+
+    // 枝の行列はまとめて掛け、軸上の点（長さ成分）と断面上のオフセット（太さ成分）も同時に求める
+    size_t startIndex = w.numVerts;
+    bool bRest = w.axis != nullptr;
+    RingKernel::transformRings(mat, rings, w.verts + startIndex, bRest ? w.axis + startIndex : nullptr, bRest ? w.radial + startIndex : nullptr, w.normals + startIndex);
+    for (int v = 0; v < rings.count; v++) w.colors[startIndex + v] = col;
+    if (bRest && w.birth) {
+        for (int v = 0; v < rings.count; v++) {
+            w.birth[startIndex + v] = w.currentBirth;
+            w.anchor[startIndex + v] = w.currentAnchor;
         }
     }
+    w.numVerts += rings.count;
+
+    // 2. インデックスの生成（隣り合う輪の間に面を貼る）
+    ofIndexType* end = RingKernel::addRingIndices(w.indices + w.numIndices, startIndex, segments, subdivisions);
+    w.numIndices = end - w.indices;
+}
 
-    // 2. インデックスの生成（面を貼る）
-    for (int ring = 0; ring < subdivisions; ring++) {
-        for (int i = 0; i < segments; i++) {
-            int nextI = (i + 1) % segments;
+float Tree::getStemHue(int structDepth, GrowthType gType) const {
+    float timeShift = buildTime * 20.0f;
+    if (gType == TYPE_ELDRITCH) {
+        timeShift = buildTime * 100.0f; // Eldritchは激しく色が動く
+    }
+    float hueBase = ofMap(meshMutation, 0, 1, s.trunkHueStart, s.trunkHueEnd);
+    return fmod(hueBase + timeShift + (structDepth * 10), 255.0f);
+}
 
-            // 現在の層の2点
-            int v0 = startIndex + (ring * segments) + i;
-            int v1 = startIndex + (ring * segments) + nextI;
-            // 次の層の2点
-            int v2 = startIndex + ((ring + 1) * segments) + i;
-            int v3 = startIndex + ((ring + 1) * segments) + nextI;
+// 枝のローカル形状（輪の頂点とノイズ）をスレッドごと・深さごとに1つ覚えておく
+namespace {
+    struct StemShape {
+        int segments = 0, subdivisions = 0;
+        float r1 = 0, r2 = 0, h = 0, twist = 0, noise = 0, time = 0;
+        RingKernel::StemRings rings;
+    };
+    thread_local StemShape stemShapes[16];
+}
 
-            // 三角形1
-            vboMesh.addIndex(v0);
-            vboMesh.addIndex(v1);
-            vboMesh.addIndex(v2);
+const RingKernel::StemRings& Tree::getStemRings(int segments, int subdivisions, float r1, float r2, float h, float twist, int depth) {
+    // カオス度が高い場合の頂点ノイズ（最上段に近いほど強く揺らす）
+    float noiseTrigger = 0.8f;
+    float nStrMax = -1.0f;
+    if (meshMaxMutation > noiseTrigger) {
+        nStrMax = ofMap(meshMaxMutation, noiseTrigger, 1.0f, 0.0f, s.noiseStrengthMax, true);
+    }
 
-            // 三角形2
-            vboMesh.addIndex(v1);
-            vboMesh.addIndex(v3);
-            vboMesh.addIndex(v2);
+    // 同じ深さの枝は半径・長さ・ねじれが等しく、ノイズも枝のローカル座標と構築時刻だけで決まる
+    // そのため輪の形は1回の構築で深さごとに1回求めれば、残りの枝は行列を掛けるだけで済む
+    StemShape& c = stemShapes[depth & 15];
+    if (c.segments == segments && c.subdivisions == subdivisions && c.r1 == r1 && c.r2 == r2 && c.h == h &&
+        c.twist == twist && c.noise == nStrMax && c.time == buildTime) {
+        return c.rings;
+    }
+    RingKernel::StemRings& rings = c.rings;
+    RingKernel::buildRings(segments, subdivisions + 1, r1, r2, h, twist, rings);
+
+    // 付け根の輪より上の頂点の x, z 2回分を1回のバッチで求める（値は ofSignedNoise と同じ）
+    if (nStrMax >= 0.0f) {
+        int numNoisy = rings.count - segments;
+        float nx[RingKernel::MAX_VERTS * 2], ny[RingKernel::MAX_VERTS * 2], nz[RingKernel::MAX_VERTS * 2], nOut[RingKernel::MAX_VERTS * 2];
+        for (int k = 0; k < numNoisy; k++) {
+            int v = segments + k;
+            nx[k] = rings.x[v] * 0.1;
+            nx[numNoisy + k] = rings.z[v] * 0.1;
+            ny[k] = ny[numNoisy + k] = rings.y[v] * 0.1;
+            nz[k] = buildTime;
+            nz[numNoisy + k] = buildTime + 10.0f;
+        }
+        BatchNoise::signedNoise(nx, ny, nz, nOut, numNoisy * 2);
+        for (int k = 0; k < numNoisy; k++) {
+            int v = segments + k;
+            float nStr = nStrMax * ((float)(v / segments) / subdivisions);
+            rings.x[v] += nOut[k] * nStr;
+            rings.z[v] += nOut[numNoisy + k] * nStr;
         }
     }
+
+    c.segments = segments;
+    c.subdivisions = subdivisions;
+    c.r1 = r1;
+    c.r2 = r2;
+    c.h = h;
+    c.twist = twist;
+    c.noise = nStrMax;
+    c.time = buildTime;
+    return rings;
 }
 
 float Tree::getExpForDepth(int d) {
-    if (d <= 0) return 0;
-    return s.expBase * pow((float)d, s.expPower);
+    return GrowthRules::getExpForDepth(d, s.expBase, s.expPower);
 }
 
 float Tree::getDepthProgress() {
@@ -254,81 +1429,208 @@ float Tree::getDepthProgress() {
     return ofClamp((depthExp - curThreshold) / (nxtThreshold - curThreshold), 0.0f, 1.0f);
 }
 
-void Tree::addLeafToMesh(float thickness, glm::mat4 mat) {
-    int startIndex = vboMesh.getNumVertices();
+void Tree::addLeafToMesh(float thickness, glm::mat4 mat, MeshWriter& w) {
+    int startIndex = w.numVerts;
     ofColor lCol = s.leafColor;
-    float w = thickness * 3.0f;
+    float lw = thickness * 3.0f;
     float h = thickness * 6.0f;
 
-    // 4頂点 (ひし形)
-    vboMesh.addVertex(glm::vec3(mat * glm::vec4(0, 0, 0, 1)));           // 0: 付け根
-    vboMesh.addVertex(glm::vec3(mat * glm::vec4(-w, h * 0.5f, 0, 1)));   // 1: 左
-    vboMesh.addVertex(glm::vec3(mat * glm::vec4(w, h * 0.5f, 0, 1)));    // 2: 右
-    vboMesh.addVertex(glm::vec3(mat * glm::vec4(0, h, 0, 1)));           // 3: 先端
+    glm::vec3 n = glm::normalize(glm::mat3(mat) * glm::vec3(0, 0, 1));
 
-    for (int i = 0; i < 4; i++) {
-        vboMesh.addNormal(glm::normalize(glm::mat3(mat) * glm::vec3(0, 0, 1)));
-        vboMesh.addColor(lCol);
+    if (lodLevels[buildLod].leafTris == 1) {
+        // 遠景用：ひし形と同じ面積の三角形1枚
+        addVertexToMesh(mat, 0, glm::vec3(0, 0, 0), n, lCol, w);
+        addVertexToMesh(mat, 0, glm::vec3(-lw, h * 0.75f, 0), n, lCol, w);
+        addVertexToMesh(mat, 0, glm::vec3(lw, h * 0.75f, 0), n, lCol, w);
+        w.addIndex(startIndex + 0); w.addIndex(startIndex + 1); w.addIndex(startIndex + 2);
+        return;
     }
 
+    // 4頂点 (ひし形) ※葉の寸法は太さに比例するので全て半径成分として扱う
+    addVertexToMesh(mat, 0, glm::vec3(0, 0, 0), n, lCol, w);           // 0: 付け根
+    addVertexToMesh(mat, 0, glm::vec3(-lw, h * 0.5f, 0), n, lCol, w);  // 1: 左
+    addVertexToMesh(mat, 0, glm::vec3(lw, h * 0.5f, 0), n, lCol, w);   // 2: 右
+    addVertexToMesh(mat, 0, glm::vec3(0, h, 0), n, lCol, w);           // 3: 先端
+
     // インデックスで2つの三角形を形成
-    vboMesh.addIndex(startIndex + 0); vboMesh.addIndex(startIndex + 1); vboMesh.addIndex(startIndex + 3);
-    vboMesh.addIndex(startIndex + 0); vboMesh.addIndex(startIndex + 2); vboMesh.addIndex(startIndex + 3);
+    w.addIndex(startIndex + 0); w.addIndex(startIndex + 1); w.addIndex(startIndex + 3);
+    w.addIndex(startIndex + 0); w.addIndex(startIndex + 2); w.addIndex(startIndex + 3);
 }
 
-void Tree::addFlowerToMesh(float thickness, glm::mat4 mat, FlowerType type) {
+void Tree::addFlowerToMesh(float thickness, glm::mat4 mat, FlowerType type, MeshWriter& w) {
     if (type == FLOWER_NONE) return;
 
-    int startIndex = vboMesh.getNumVertices();
+    int startIndex = w.numVerts;
     ofColor fCol = s.flowerColor;
 
     if (type == FLOWER_CRYSTAL) {
         // 【Type A: 結晶】 放射状に広がる鋭い三角形
         float r = thickness * 4.0f;
-        int numPoints = 6;
-        vboMesh.addVertex(glm::vec3(mat * glm::vec4(0, 0, 0, 1))); // 中心
-        vboMesh.addColor(fCol); vboMesh.addNormal(glm::vec3(0, 1, 0));
+        int numPoints = lodLevels[buildLod].crystalPoints;
+        addVertexToMesh(mat, 0, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0), fCol, w); // 中心
 
         for (int i = 0; i < numPoints; i++) {
             float ang = i * TWO_PI / numPoints;
-            vboMesh.addVertex(glm::vec3(mat * glm::vec4(cos(ang) * r, thickness, sin(ang) * r, 1)));
-            vboMesh.addColor(fCol); vboMesh.addNormal(glm::vec3(0, 1, 0));
+            addVertexToMesh(mat, 0, glm::vec3(cos(ang) * r, thickness, sin(ang) * r), glm::vec3(0, 1, 0), fCol, w);
 
-            vboMesh.addIndex(startIndex);
-            vboMesh.addIndex(startIndex + 1 + i);
-            vboMesh.addIndex(startIndex + 1 + (i + 1) % numPoints);
+            w.addIndex(startIndex);
+            w.addIndex(startIndex + 1 + i);
+            w.addIndex(startIndex + 1 + (i + 1) % numPoints);
         }
     }
     else if (type == FLOWER_PETAL) {
         // 【Type B: 花弁】 5枚の柔らかい面
         float r = thickness * 3.5f;
-        for (int i = 0; i < 5; i++) {
-            int pStart = vboMesh.getNumVertices();
-            float ang = i * TWO_PI / 5;
+        int numPetals = lodLevels[buildLod].petals;
+        for (int i = 0; i < numPetals; i++) {
+            int pStart = w.numVerts;
+            float ang = i * TWO_PI / numPetals;
             // 簡易的な花びら1枚(三角形)
-            vboMesh.addVertex(glm::vec3(mat * glm::vec4(0, 0, 0, 1)));
-            vboMesh.addVertex(glm::vec3(mat * glm::vec4(cos(ang - 0.3) * r, r * 0.5, sin(ang - 0.3) * r, 1)));
-            vboMesh.addVertex(glm::vec3(mat * glm::vec4(cos(ang + 0.3) * r, r * 0.5, sin(ang + 0.3) * r, 1)));
-            for (int k = 0; k < 3; k++) { vboMesh.addColor(fCol); vboMesh.addNormal(glm::vec3(0, 1, 0)); }
-            vboMesh.addIndex(pStart); vboMesh.addIndex(pStart + 1); vboMesh.addIndex(pStart + 2);
+            addVertexToMesh(mat, 0, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0), fCol, w);
+            addVertexToMesh(mat, 0, glm::vec3(cos(ang - 0.3) * r, r * 0.5, sin(ang - 0.3) * r), glm::vec3(0, 1, 0), fCol, w);
+            addVertexToMesh(mat, 0, glm::vec3(cos(ang + 0.3) * r, r * 0.5, sin(ang + 0.3) * r), glm::vec3(0, 1, 0), fCol, w);
+            w.addIndex(pStart); w.addIndex(pStart + 1); w.addIndex(pStart + 2);
         }
     }
     else if (type == FLOWER_SPIRIT) {
         // 【Type C: 霊魂】 ゆらゆら揺れる尖った火の玉
         float r = thickness * 2.5f;
-        float time = ofGetElapsedTimef() * 3.0f;
+        float time = buildTime * 3.0f;
         float offset = ofSignedNoise(time) * 15.0f;
 
-        vboMesh.addVertex(glm::vec3(mat * glm::vec4(offset, r * 5.0f, 0, 1))); // 尖った先端
-        vboMesh.addVertex(glm::vec3(mat * glm::vec4(-r, 0, -r, 1)));
-        vboMesh.addVertex(glm::vec3(mat * glm::vec4(r, 0, -r, 1)));
-        vboMesh.addVertex(glm::vec3(mat * glm::vec4(0, 0, r, 1)));
-
-        for (int k = 0; k < 4; k++) { vboMesh.addColor(ofColor(150, 200, 255, 180)); vboMesh.addNormal(glm::vec3(0, 1, 0)); }
+        ofColor sCol(150, 200, 255, 180);
+        addVertexToMesh(mat, 0, glm::vec3(offset, r * 5.0f, 0), glm::vec3(0, 1, 0), sCol, w); // 尖った先端
+        addVertexToMesh(mat, 0, glm::vec3(-r, 0, -r), glm::vec3(0, 1, 0), sCol, w);
+        addVertexToMesh(mat, 0, glm::vec3(r, 0, -r), glm::vec3(0, 1, 0), sCol, w);
+        addVertexToMesh(mat, 0, glm::vec3(0, 0, r), glm::vec3(0, 1, 0), sCol, w);
         // 四面体のインデックス
         int idxs[] = { 0,1,2, 0,2,3, 0,3,1 };
-        for (int id : idxs) vboMesh.addIndex(startIndex + id);
+        for (int id : idxs) w.addIndex(startIndex + id);
+    }
+}
+
+void Tree::addVertexToMesh(const glm::mat4& mat, float axisY, const glm::vec3& radial, const glm::vec3& normal, const ofColor& col, MeshWriter& w) {
+    size_t i = w.numVerts++;
+    if (w.axis) {
+        // 長さに比例する軸上の点と、太さに比例するオフセットを別々に保持
+        glm::vec3 axis = glm::vec3(mat * glm::vec4(0, axisY, 0, 1));
+        glm::vec3 offset = glm::mat3(mat) * radial;
+        w.axis[i] = axis;
+        w.radial[i] = offset;
+        w.verts[i] = axis + offset;
+        if (w.birth) {
+            w.birth[i] = w.currentBirth;
+            w.anchor[i] = w.currentAnchor;
+        }
+    }
+    else {
+        w.verts[i] = glm::vec3(mat * glm::vec4(radial.x, radial.y + axisY, radial.z, 1));
+    }
+    w.normals[i] = normal;
+    w.colors[i] = col;
+}
+
+Tree::MeshCount Tree::countFlower(FlowerType fType) const {
+    switch (fType) {
+    case FLOWER_CRYSTAL: return { (size_t)lodLevels[buildLod].crystalPoints + 1, (size_t)lodLevels[buildLod].crystalPoints * 3 };
+    case FLOWER_PETAL:   return { (size_t)lodLevels[buildLod].petals * 3, (size_t)lodLevels[buildLod].petals * 3 };
+    case FLOWER_SPIRIT:  return { 4, 9 };
+    default:             return { 0, 0 };
+    }
+}
+
+Tree::MeshCount Tree::countBranchNode(int depth, int bloomLevel, FlowerType fType) const {
+    // 枝1本 = 幹の円柱 (角数 x (分割数+1)段、インスタンス描画ならインスタンス1つ) + 先端の装飾
+    int segments = getStemSegments(depth + depthOffset);
+    int subdivisions = lodLevels[buildLod].subdivisions;
+    MeshCount c;
+    if (bInstancedBuild) {
+        c.stems = 1;
+    }
+    else {
+        c.verts = segments * (subdivisions + 1);
+        c.indices = segments * subdivisions * 6;
+    }
+    c.tips = (depth == 0) ? 1 : 0;
+    c.leaves = (depth == 1) ? 1 : 0;
+
+    if (buildCards) return c;
+    MeshCount deco = countDeco(depth, bloomLevel, fType);
+    c.verts += deco.verts;
+    c.indices += deco.indices;
+    return c;
+}
+
+Tree::MeshCount Tree::countDeco(int depth, int bloomLevel, FlowerType fType) const {
+    if (depth == 0 && (isBloomed(bloomLevel) || fType != FLOWER_NONE)) return countFlower(fType);
+    if (depth <= 1) return countLeaf();
+    return {};
+}
+
+void Tree::buildSubtreeTables(int depth, int bloomLevel, FlowerType fType) {
+    // 深さ d の部分木 = 枝1本 + 子の部分木 x 分岐数
+    subtreeCounts.resize(depth + 1);
+    for (int d = 0; d <= depth; d++) {
+        MeshCount c = countBranchNode(d, bloomLevel, fType);
+        if (d > 0) {
+            const MeshCount& child = subtreeCounts[d - 1];
+            int numBranches = getBranchCount(d);
+            c.verts += numBranches * child.verts;
+            c.indices += numBranches * child.indices;
+            c.tips += numBranches * child.tips;
+            c.leaves += numBranches * child.leaves;
+            c.stems += numBranches * child.stems;
+        }
+        subtreeCounts[d] = c;
+    }
+}
+
+void Tree::resizeMesh(const MeshCount& c) {
+    vboMesh.getVertices().resize(c.verts);
+    vboMesh.getNormals().resize(c.verts);
+    vboMesh.getColors().resize(c.verts);
+    vboMesh.getIndices().resize(c.indices);
+
+    bool keepRest = s.rescaleGlide || s.incrementalGrowth;
+    restAxis.resize(keepRest ? c.verts : 0);
+    restRadial.resize(keepRest ? c.verts : 0);
+    vertexBirth.resize(s.incrementalGrowth ? c.verts : 0);
+    vertexAnchor.resize(s.incrementalGrowth ? c.verts : 0);
+    tipTier.resize(bAppendable ? c.tips : 0);
+    leafTier.resize(bAppendable ? c.leaves : 0);
+    stemInstances.resize(c.stems);
+}
+
+Tree::MeshWriter Tree::beginMeshWrite(const MeshCount& offset) {
+    // ofMesh のポインタ取得は変更フラグを立てるので、メインスレッドでまとめて行う
+    MeshWriter w;
+    w.verts = vboMesh.getVerticesPointer() + offset.verts;
+    w.normals = vboMesh.getNormalsPointer() + offset.verts;
+    w.colors = vboMesh.getColorsPointer() + offset.verts;
+    w.indices = vboMesh.getIndexPointer() + offset.indices;
+    if (!restAxis.empty()) {
+        w.axis = restAxis.data() + offset.verts;
+        w.radial = restRadial.data() + offset.verts;
+    }
+    if (s.incrementalGrowth) {
+        w.birth = vertexBirth.data() + offset.verts;
+        w.anchor = vertexAnchor.data() + offset.verts;
+    }
+    if (bAppendable) {
+        w.tips = tipTier.data() + offset.tips;
+        w.leaves = leafTier.data() + offset.leaves;
+    }
+    if (bInstancedBuild) w.stems = stemInstances.data() + offset.stems;
+    return w;
+}
+
+void Tree::endMeshWrite(MeshWriter& w, const MeshCount& offset) {
+    // 区間内の相対インデックスをバッファ全体の位置へずらす
+    if (offset.verts > 0) {
+        for (size_t i = 0; i < w.numIndices; i++) w.indices[i] += (ofIndexType)offset.verts;
     }
+    for (size_t i = 0; i < w.numTips; i++) w.tips[i].indexStart += offset.indices;
+    for (size_t i = 0; i < w.numLeaves; i++) w.leaves[i].indexStart += offset.indices;
 }
 
 void Tree::addJointToMesh(float radius, glm::mat4 mat, ofColor col, int depth) {
@@ -365,6 +1667,9 @@ void Tree::addJointToMesh(float radius, glm::mat4 mat, ofColor col, int depth) {
 void Tree::loadPresetConfig(const ofJson& pt) {
     // ショーケース用の深度設定
     s.maxDepth = pt.value("max_depth", 6);
+    // 同じプリセットは毎回同じ形にし、生成済みのメッシュを使い回す
+    seed = pt.value("seed", seed);
+    bCacheBuild = s.meshCache;
     depthLevel = s.maxDepth;
     depthExp = getExpForDepth(depthLevel);
 
@@ -410,8 +1715,27 @@ void Tree::reset() {
     totalMutationEarned = 0;
 
     seed = ofRandom(99999);
+    bCacheBuild = false;
+    bChunkPending = false;
+    meshChunks.clear();
+    buildChunks.clear();
+    for (auto& lm : lodMeshes) lm.bDirty = true;
+    lodTarget = drawLod = 0;
+    chunkBuild.stack.clear();
     vboMesh.clear();
+    restAxis.clear();
+    restRadial.clear();
+    vertexBirth.clear();
+    vertexAnchor.clear();
+    tipTier.clear();
+    leafTier.clear();
+    tierBirthTime = -1e6f;
+    bGrowthPending = false;
+    retiredIndices = 0;
+    branchBvh.clear();
+    bBvhDirty = true;
     bNeedsUpdate = true;
+    bPackDirty = true;
 }
 
 int Tree::getCurrentDepth() {
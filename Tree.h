@@ -1,6 +1,17 @@
 #pragma once
 #include "ofMain.h"
 #include "Constants.h"
+#include "WorkerPool.h"
+#include "BranchRng.h"
+#include "PackedMesh.h"
+#include "RestPoseMesh.h"
+#include "StemInstancer.h"
+#include "MeshCache.h"
+#include "MeshExporter.h"
+#include "FoliageCard.h"
+#include "RingKernel.h"
+#include "GrowthSim.h"
+#include "BranchBvh.h"
 
 class Tree {
 public:
@@ -9,17 +20,17 @@ public:
     void draw();
     void reset();
 
-    void water(float buff, int resilienceLevel, float increment);      // L΂AJIXx
-    void fertilize(float buff, int resilienceLevel, float increment);  // 𑝂AJIXx
-    void kotodama(float buff);   // JIXxグ
+    void water(float buff, int resilienceLevel, float increment);      // 長さを伸ばし、カオス度を下げる
+    void fertilize(float buff, int resilienceLevel, float increment);  // 太さを増し、カオス度を下げる
+    void kotodama(float buff);   // カオス度を上げる
     void applyEvolution(GrowthType type);
-    void incrementDay() { if (dayCount < 50) dayCount++; }
+    void incrementDay() { dayCount = GrowthRules::incrementDay(dayCount); }
     void addDebugExp(float amt) { depthExp += amt; }
     void setNeedsUpdate() { bNeedsUpdate = true; }
 
-    void loadPresetConfig(const ofJson& presetTreeConfig); // ǉFvZbg̍Kp
+    void loadPresetConfig(const ofJson& presetTreeConfig); // 追加：プリセットの差分適用
 
-    // --- ANZTE[eBeB ---
+    // --- アクセサ・ユーティリティ ---
     float getLen() { return bLen; }
     float getThick() { return bThick; }
     float getMaxMutation() { return maxMutationReached; }
@@ -32,21 +43,190 @@ public:
     float getTotalMutationEarned() { return totalMutationEarned; }
     int getDayCount() { return dayCount; }
     int getSeed() { return seed; }
+    float getBuildTime() const { return buildTime; } // 色相・ノイズを決めた構築時刻
     float getDepthProgress();
+    GrowthTargets getTargets() const; // コマンドで動く目標値と累積値
+    void setTargets(const GrowthTargets& g);
     ofVboMesh& getVboMesh() { return vboMesh; }
+    size_t getNumVertices(); // 描画に使う頂点数（チャンクに分けた分も含む）
+    size_t getMeshBytes(); // 描画に使う頂点・インデックスのバイト数
+    bool isBuilding() const { return bChunkPending; } // 分割構築の途中か
+    int getLodLevel() const { return drawLod; }       // 直前の描画で使った細かさのレベル
+    void setLodOverride(int level) { lodOverride = min(level, (int)NUM_LOD_LEVELS - 1); if (lodOverride >= 0) lodTarget = lodOverride; } // 細かさのレベルを固定する（-1 で画面の大きさから選ぶ）
+    size_t getLodVertices(int level) const { return (level > 0 && !lodMeshes[level - 1].bDirty) ? lodMeshes[level - 1].mesh.getNumVertices() : 0; }
+    bool getBranchMatrix(const vector<int>& path, glm::mat4& out); // 経路で指定した枝の付け根の行列（構築時の形状）。存在しない経路なら false
+    // 現在の木を指定の深さで生成し、.glb / .ply へ直接書き出す（描画用のメッシュは変更しない）
+    // 色相・ノイズは時刻 time で決まる（同じ時刻なら同じメッシュになる）
+    bool exportMesh(const string& path, float time, int depth, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    // 種・成長状態を指定した別の木を、細かさのレベル lod で out へ生成する（描画用のメッシュは変更しない。Forest 用）
+    void buildStaticMesh(ofMesh& out, int treeSeed, float time, int lod, int depth, float len, float thick, float mutation, float maxMutation, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
     void resetMutationReached() { maxMutationReached = 0; }
+    // 光線（ワールド座標）と最初に交わる枝を探す。枝の BVH は形が変わった後の最初の呼び出しで作る
+    bool pickBranch(const glm::vec3& origin, const glm::vec3& dir, BranchBvh::Hit& hit);
+    bool getBranchInfo(int index, BranchBvh::Hit& hit); // 番号で指定した枝の現在の位置・半径
 
 private:
-    // WbNFWϊƃbV\z
-    glm::mat4 getNextBranchMatrix(glm::mat4 tipMat, int index, int total, float angleBase);
-    void buildBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
-    void addStemToMesh(float r1, float r2, float h, glm::mat4 mat, int chaosResist,int depth, GrowthType gType);
-    void addFlowerToMesh(float thickness, glm::mat4 mat, FlowerType type);
-    void addLeafToMesh(float thickness, glm::mat4 mat);
+    enum DecoKind { DECO_NONE, DECO_LEAF, DECO_FLOWER };
+
+    // 段の追記に必要な先端の枝の情報
+    struct GrowthTip {
+        glm::mat4 tipMat;
+        float length, thickness;
+        size_t indexStart, indexCount; // 装飾（葉・花）のインデックス範囲
+        DecoKind decoKind;
+        uint64_t key;                  // 枝の経路から決まる乱数キー
+    };
+
+    // 事前に確保した配列の一区間へ直接書き込む（区間ごとにスレッドを分けられる）
+    struct MeshWriter {
+        glm::vec3* verts = nullptr;
+        glm::vec3* normals = nullptr;
+        ofFloatColor* colors = nullptr;
+        ofIndexType* indices = nullptr;
+        glm::vec3* axis = nullptr;     // 静止姿勢（保持しない場合は nullptr）
+        glm::vec3* radial = nullptr;
+        float* birth = nullptr;        // 段の追記成長用（同上）
+        glm::vec3* anchor = nullptr;
+        size_t numVerts = 0, numIndices = 0; // 区間内の書き込み位置（インデックスも区間内の相対値）
+        GrowthTip* tips = nullptr;     // 先端2段の記録先（追記成長を使わない場合は nullptr）
+        GrowthTip* leaves = nullptr;
+        size_t numTips = 0, numLeaves = 0;
+        StemInstancer::Instance* stems = nullptr; // 枝をインスタンスで描く場合の書き出し先
+        size_t numStems = 0;
+        float currentBirth = -1e6f;
+        glm::vec3 currentAnchor;
+        MeshExporter* exporter = nullptr; // 書き出し中は枝1本ごとに流して区間を空ける
+        size_t streamBase = 0;            // 流し終えた頂点数
+        glm::mat4* cards = nullptr;       // 葉・花をカードに置き換える房の付け根（foliageCardDepth の枝の先端）
+        size_t numCards = 0;
+
+        void addIndex(size_t i) { indices[numIndices++] = (ofIndexType)i; }
+    };
+    struct MeshCount { size_t verts = 0, indices = 0, tips = 0, leaves = 0, stems = 0; };
+
+    // 分割構築：まだメッシュにしていない枝
+    struct PendingBranch {
+        glm::mat4 mat;
+        float length, thickness;
+        int depth;
+        uint64_t key;
+    };
+    // 分割構築をフレームをまたいで再開するための状態
+    struct ChunkBuild {
+        vector<PendingBranch> stack;     // 深さ優先の未処理の枝（深さ x 分岐数 程度）
+        int chaosResist = 0, bloomLevel = 0;
+        GrowthType gType = TYPE_DEFAULT;
+        FlowerType fType = FLOWER_NONE;
+        MeshWriter w;                    // 作業中のチャンクへの書き込み位置
+    };
+    // 固定サイズのメッシュ片（個別の VBO と境界箱を持つ）
+    struct MeshChunk {
+        ofVbo vbo;
+        size_t numVerts = 0, numIndices = 0;
+        glm::vec3 boundsMin, boundsMax;
+    };
+
+    // 描画レベル（カメラからの見かけの大きさで切り替える）ごとの細かさ
+    struct LodLevel {
+        int trunkSegments, tipSegments;  // 断面の角数（幹側 / 先端側）
+        int subdivisions;                // 縦方向の分割数
+        int crystalPoints, petals;       // 花の細かさ
+        int leafTris;                    // 葉の三角形数 (2: ひし形, 1: 三角形)
+    };
+    enum { NUM_LOD_LEVELS = 3 };
+    static const LodLevel lodLevels[NUM_LOD_LEVELS];
+
+    // 遠景用のメッシュ（静止姿勢を持ち、補間中は描画時にスケールする）
+    struct LodMesh {
+        ofVboMesh mesh;
+        vector<glm::vec3> restAxis, restRadial;
+        RestPoseMesh pose;               // 描画用（比率はシェーダで掛ける）
+        float appliedLen = -1, appliedThick = -1; // シェーダが使えない場合に CPU で掛けた値
+        bool bDirty = true;              // 最も細かいメッシュが変わり、作り直しが必要
+        bool bUploadDirty = true;        // 作り直した後、まだ GPU へ送っていない
+        ofVboMesh cardMesh;              // 先端の房を置き換えたカード（空ならカードを使わないレベル）
+        uint64_t cardKey = 0;            // foliageCards のキー
+    };
+
+    // キャッシュに配列と一緒に保存する値
+    struct CacheInfo {
+        int dedupDepth;
+        size_t dedupSpineIndices, dedupSubtreeIndices;
+    };
+
+    // 並列構築で1スレッドが受け持つ部分木
+    struct BuildTask {
+        glm::mat4 mat;
+        float length, thickness;
+        uint64_t key;                    // 部分木の根の乱数キー
+        MeshCount offset;                // 書き込み区間の先頭
+        MeshWriter writer;
+    };
+
+    // 内部ロジック：座標変換とメッシュ構築
+    glm::mat4 getNextBranchMatrix(glm::mat4 tipMat, int index, int total, float angleBase, uint64_t childKey);
+    void buildBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, MeshWriter& w);
+    void planBranchMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, int splitDepth, MeshWriter& w);
+    uint64_t getMeshCacheKey(float len, float thick, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType) const;
+    bool loadCachedMesh(uint64_t key);
+    void saveCachedMesh(uint64_t key);
+    void flushToExporter(MeshWriter& w);
+    void beginChunkedBuild(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    void continueChunkedBuild(float budgetMs);
+    void flushMeshChunk();
+    void drawMeshChunks();
+    const vector<MeshChunk>& getDrawChunks() const { return (bChunkPending && meshChunks.empty()) ? buildChunks : meshChunks; }
+    float getTreeHeight() const;
+    int selectLodLevel();
+    void buildLodMesh(int level, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    void drawLodMesh(LodMesh& lm);
+    uint64_t getFoliageCardKey(float length, float thickness, int bloomLevel, FlowerType fType) const;
+    FoliageCard& getFoliageCard(uint64_t cardKey, float length, float thickness, int bloomLevel, FlowerType fType);
+    void addClusterDecoToMesh(int depth, float length, float thickness, const glm::mat4& tipMat, int bloomLevel, FlowerType fType, uint64_t key, MeshWriter& w);
+    void buildLodCards(LodMesh& lm, const vector<glm::mat4>& cardMats, int bloomLevel, FlowerType fType);
+    void buildDedupMesh(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    void drawDedupMesh();
+    void buildBranchMeshParallel(float length, float thickness, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    glm::mat4 addBranchNodeToMesh(float length, float thickness, int depth, glm::mat4 mat, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType, uint64_t key, MeshWriter& w);
+    void addStemToMesh(float r1, float r2, float h, glm::mat4 mat, int chaosResist,int depth, GrowthType gType, MeshWriter& w);
+    const RingKernel::StemRings& getStemRings(int segments, int subdivisions, float r1, float r2, float h, float twist, int depth);
+    DecoKind addDecoToMesh(int depth, float thickness, const glm::mat4& tipMat, int bloomLevel, FlowerType fType, MeshWriter& w);
+    void addFlowerToMesh(float thickness, glm::mat4 mat, FlowerType type, MeshWriter& w);
+    void addLeafToMesh(float thickness, glm::mat4 mat, MeshWriter& w);
     void addJointToMesh(float radius, glm::mat4 mat, ofColor col, int depth);
+    void addVertexToMesh(const glm::mat4& mat, float axisY, const glm::vec3& radial, const glm::vec3& normal, const ofColor& col, MeshWriter& w);
+    float getStemHue(int structDepth, GrowthType gType) const;
+    void buildBranchBvh();
+    void addBranchToBvh(float length, float thickness, int depth, glm::mat4 mat, int parent, float angleBase, float radiusPad, uint64_t key);
+    void getBvhScale(float& lenK, float& thickK) const;
+
+    // 事前確保：生成前に頂点数・インデックス数を深さだけから求める
+    int getBranchCount(int depth) const { return (depth + depthOffset < 2) ? 2 : 3; }
+    int getStemSegments(int structDepth) const { // LOD: 深い枝ほど角数を減らす
+        return (structDepth <= 4) ? lodLevels[buildLod].tipSegments : lodLevels[buildLod].trunkSegments;
+    }
+    bool isBloomed(int bloomLevel) const { return GrowthRules::isBloomed(meshMaxMutation, s.bloomThreshold, bloomLevel); }
+    bool hasStemNoise() const { return meshMaxMutation > 0.8f; } // 頂点ノイズが掛かる枝はインスタンス化できない
+    MeshCount countBranchNode(int depth, int bloomLevel, FlowerType fType) const;
+    MeshCount countDeco(int depth, int bloomLevel, FlowerType fType) const;
+    MeshCount countFlower(FlowerType fType) const;
+    MeshCount countLeaf() const { return (lodLevels[buildLod].leafTris == 1) ? MeshCount{ 3, 3, 0, 0 } : MeshCount{ 4, 6, 0, 0 }; }
+    void buildSubtreeTables(int depth, int bloomLevel, FlowerType fType);
+    void resizeMesh(const MeshCount& c);
+    MeshWriter beginMeshWrite(const MeshCount& offset);
+    void endMeshWrite(MeshWriter& w, const MeshCount& offset);
+    void rebuildMesh(float len, float thick, int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    void appendGrowthTier(int chaosResist, int bloomLevel, GrowthType gType, FlowerType fType);
+    void retireIndices(size_t start, size_t count);
+    void compactRetired();
+    void applyRestPose(size_t from);
+    bool isPackedDraw() const { return s.packedVertices && !bDedupBuild; } // 最も細かいメッシュを詰めた形式で描くか
+    bool isShaderPose() const { return isPackedDraw() ? packedMesh.isReady() : poseMesh.isReady(); } // 補間の比率をシェーダで掛けるか
+    RestPoseMesh::Pose getPose() const;
+    void uploadPoseMesh();
     float getExpForDepth(int d);
 
-    // --- 琬p[^ (b:ݒl, t:ڕWl) ---
+    // --- 育成パラメータ (b:現在値, t:目標値) ---
     float bLen = 0, bThick = 0, bMutation = 0;
     float tLen = 10, tThick = 2, tMutation = 0;
     float depthExp = 0;
@@ -59,14 +239,81 @@ private:
     float thickExp = 0;
     int thickLevel = 0;
 
-    // --- ԊǗ ---
+    // --- 状態管理 ---
     ofVboMesh vboMesh; 
+    PackedMesh packedMesh;        // 詰めた頂点形式で描画する場合の GPU 側メッシュ
+    RestPoseMesh poseMesh;        // 通常の頂点形式で描画する場合の GPU 側メッシュ（補間の比率はシェーダで掛ける）
+    bool bPackDirty = true;       // vboMesh の内容が変わり、詰め直しが必要
+    StemInstancer stemInstancer;  // 枝をインスタンスで描く場合の正準メッシュ
+    vector<StemInstancer::Instance> stemInstances;
+    bool bInstancedBuild = false; // 現在のメッシュは枝をインスタンスで持っている
+    bool bStemsDirty = false;
+    bool bAppendable = false;     // 先端の段を追記できる構築か（追記成長で、インスタンス・共有を使わない）
+
+    // --- 部分木の共有（変異度0のとき） ---
+    bool bDedupBuild = false;
+    int dedupDepth = 0;               // 共有する部分木の深さ
+    vector<glm::mat4> dedupMats;      // 各部分木の付け根の行列（構築時の形状）
+    size_t dedupSpineIndices = 0;     // 幹側のインデックス数（部分木はその後ろ）
+    size_t dedupSubtreeIndices = 0;
+
+    // --- 深い木の分割構築 ---
+    bool bChunkedBuild = false;
+    bool bChunkPending = false;       // 生成途中（update ごとに持ち時間だけ進める）
+    ChunkBuild chunkBuild;
+    MeshCount chunkNodeMax;           // 枝1本（＋装飾）の最大の頂点数・インデックス数
+    vector<glm::vec3> chunkVerts, chunkNormals; // 作業中のチャンク（容量はチャンクの大きさで固定）
+    vector<ofFloatColor> chunkColors;
+    vector<ofIndexType> chunkIndices;
+    vector<MeshChunk> meshChunks;     // 描画中のチャンク（作り直しの間も前回の形を描き続ける）
+    vector<MeshChunk> buildChunks;    // 構築中のチャンク（完成したら meshChunks と入れ替える）
+
+    // --- 見かけの大きさによる描画レベルの切り替え ---
+    bool bLodBuild = false;
+    int buildLod = 0;                 // 構築中のレベル
+    int lodTarget = 0;                // 選ばれているレベル（切り替えの履歴を持つ）
+    int drawLod = 0;                  // 実際に描画したレベル
+    int lodOverride = -1;             // 固定したレベル（-1 なら固定しない）
+    LodMesh lodMeshes[NUM_LOD_LEVELS - 1];
+    bool buildCards = false;          // 構築中のレベルは先端の房の葉・花をカードに置き換える
+    map<uint64_t, FoliageCard> foliageCards; // 花の種類・色・房の大きさごとに生成したカード
+
+    // --- 生成済みメッシュのディスクキャッシュ（プリセット用） ---
+    MeshCache meshCache;
+    bool bCacheBuild = false;         // プリセットを読み込んでから次のリセットまで有効
+    vector<glm::vec3> restAxis;   // 長さに比例する成分（枝の軸上の位置）
+    vector<glm::vec3> restRadial; // 太さに比例する成分（軸からのオフセット）
+    float builtLen = 0, builtThick = 0;           // メッシュ構築時の長さ・太さ
+    float builtMutation = -1, builtMaxMutation = -1;
+    float appliedLen = -1, appliedThick = -1;     // 最後にスケールを適用した値
+    float meshMutation = 0, meshMaxMutation = 0;  // 構築時に参照する変異度
+
+    // --- 段の追記による成長 ---
+    vector<float> vertexBirth;        // 頂点ごとの生えた時刻
+    vector<glm::vec3> vertexAnchor;   // スケールインの基点（枝の付け根）
+    vector<GrowthTip> tipTier;        // 最も外側の段
+    vector<GrowthTip> leafTier;       // その1つ内側の段
+    int depthOffset = 0;
+    float tierBirthTime = -1e6f;
+    size_t growStart = 0;
+    bool bGrowthPending = false;
+    size_t retiredIndices = 0;        // 潰して残っているインデックス数
+
+    // --- 枝のピック ---
+    BranchBvh branchBvh;              // 構築時の形状で持ち、補間中は比率を掛けて調べる
+    bool bBvhDirty = true;            // メッシュが変わり、次のピックで作り直す
+    GrowthType meshType = TYPE_DEFAULT; // 構築時の成長タイプ（枝の色相）
+
+    // --- 生成バッファ ---
+    float buildTime = 0;              // 構築時の時刻（色・ノイズは1回の構築で共通）
+    vector<MeshCount> subtreeCounts;  // 深さごとの部分木の頂点数・インデックス数
+    vector<BuildTask> buildTasks;
     int seed;
     int dayCount = 1;
     float maxMutationReached = 0;
     float lastMutation = 0;
     bool bNeedsUpdate = true;
 
-    // --- JSON萔 ---
+    // --- JSON定数 ---
     TreeSettings s;
 };
\ No newline at end of file
@@ -3,7 +3,7 @@
 #include "..\Constants.h"
 
 class Weather {
-    // 2D̉JǗ\
+    // 2Dの雨線を管理する構造体
     struct RainLine {
         float x, y, speed, length;
     };
@@ -14,7 +14,7 @@ public:
 
     void setup() {
         rainLines.clear();
-        // ʑŜɉJ̐zu
+        // 画面全体に雨の線を初期配置
         for (int i = 0; i < 200; i++) {
             rainLines.push_back({ ofRandomWidth(), ofRandomHeight(), ofRandom(12, 25), ofRandom(15, 40) });
         }
@@ -32,12 +32,12 @@ public:
         }
     }
 
-    // J̊Oi2Djŕ`悷郁\bh
+    // カメラの外（2D）で描画するメソッド
     void draw2D() {
         if (state == RAINY) {
             ofPushStyle();
             ofSetLineWidth(1);
-            ofSetColor(170, 200, 255, 130); // ȐF
+            ofSetColor(170, 200, 255, 130); // 青白く少し透明な色
             for (auto& r : rainLines) {
                 ofDrawLine(r.x, r.y, r.x, r.y + r.length);
             }
@@ -52,7 +52,7 @@ public:
         if (state == RAINY) return "RAINY";
         return "MOONLIGHT";
     }
-    // ofApp nꂽ config gĔwiF
+    // ofApp から渡された config を使って背景色を決定
     ofColor getBgFromConfig(const ofJson& config) {
         string key = "";
         if (state == SUNNY) key = "sunny_bg";
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+
+// メッシュ生成などで使い回す常駐ワーカースレッド
+// parallelFor はジョブを配り終えるまで呼び出し元のスレッドも処理に参加する
+class WorkerPool {
+public:
+    explicit WorkerPool(int numThreads = 0) {
+        if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+        // 呼び出し元も1スレッドとして数える
+        for (int i = 1; i < numThreads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            bQuit = true;
+        }
+        cvStart.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    // アプリ全体で共有するプール
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    int getNumThreads() const { return (int)workers.size() + 1; }
+
+    // fn(i) を i = 0 .. count-1 について並列に実行する
+    template<class F>
+    void parallelFor(size_t count, F&& fn) {
+        if (count == 0) return;
+        // ワーカー内からの入れ子呼び出しや単一ジョブはその場で直列実行
+        if (workers.empty() || count == 1 || isWorkerThread()) {
+            for (size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+        using Fn = typename std::remove_reference<F>::type;
+        run(count, [](void* ctx, size_t i) { (*static_cast<Fn*>(ctx))(i); }, (void*)&fn);
+    }
+
+private:
+    static bool& isWorkerThread() {
+        static thread_local bool bWorker = false;
+        return bWorker;
+    }
+
+    void run(size_t count, void (*fn)(void*, size_t), void* ctx) {
+        std::lock_guard<std::mutex> runLock(runMtx); // 同時に走るジョブは1つだけ
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobFn = fn;
+            jobCtx = ctx;
+            jobCount = count;
+            nextIndex = 0;
+            pending = (int)workers.size();
+            generation++;
+        }
+        cvStart.notify_all();
+        drain();
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cvDone.wait(lock, [this] { return pending == 0; });
+    }
+
+    void drain() {
+        for (size_t i = nextIndex.fetch_add(1); i < jobCount; i = nextIndex.fetch_add(1)) {
+            jobFn(jobCtx, i);
+        }
+    }
+
+    void workerLoop() {
+        isWorkerThread() = true;
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cvStart.wait(lock, [&] { return bQuit || generation != seen; });
+                if (bQuit) return;
+                seen = generation;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (--pending == 0) cvDone.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mtx, runMtx;
+    std::condition_variable cvStart, cvDone;
+
+    void (*jobFn)(void*, size_t) = nullptr;
+    void* jobCtx = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{ 0 };
+    int pending = 0;
+    unsigned long long generation = 0;
+    bool bQuit = false;
+};
@@ -0,0 +1,82 @@
+﻿// 枝の円柱の頂点生成のマイクロベンチマーク（従来の1頂点ずつの処理と RingKernel の比較）
+// openFrameworks 本体は不要で、glm だけでビルドできる
+//   g++ -O2 -std=c++17 -I.. -I<of>/libs/glm/include RingKernelBench.cpp -o RingKernelBench
+//   cl /O2 /std:c++17 /EHsc /I.. /I<of>\libs\glm\include RingKernelBench.cpp
+#include "RingKernel.h"
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// 従来の Tree::addStemToMesh と同じ計算（角度ごとの cos/sin、mat4 * vec4、枝ごとの逆転置）
+static void legacyStem(int segments, int numRings, float r1, float r2, float h, float twist, const glm::mat4& mat,
+                       glm::vec3* pos, glm::vec3* axis, glm::vec3* radial, glm::vec3* normals) {
+    glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(mat));
+    int subdivisions = numRings - 1;
+    int v = 0;
+    for (int ring = 0; ring < numRings; ring++) {
+        float ratio = (float)ring / subdivisions;
+        float currentR = r1 + (r2 - r1) * ratio;
+        float currentY = h * ratio;
+        for (int i = 0; i < segments; i++, v++) {
+            float angle = (i * 6.28318530717958647693f / segments) + twist * ratio;
+            glm::vec3 unitPos(cos(angle), 0, sin(angle));
+            glm::vec3 radialPos(unitPos.x * currentR, 0, unitPos.z * currentR);
+            axis[v] = glm::vec3(mat * glm::vec4(0, currentY, 0, 1));
+            radial[v] = glm::mat3(mat) * radialPos;
+            pos[v] = axis[v] + radial[v];
+            normals[v] = normalMatrix * unitPos;
+        }
+    }
+}
+
+int main() {
+    const int numStems = 4096;
+    const int repeats = 200;
+    const int numRings = 5;
+
+    // 深い木の枝と同じく、回転と平行移動だけの行列を用意する
+    std::vector<glm::mat4> mats(numStems);
+    for (int i = 0; i < numStems; i++) {
+        glm::mat4 m(1.0f);
+        m = glm::translate(m, glm::vec3(i * 0.1f, i * 0.2f, -i * 0.05f));
+        m = glm::rotate(m, glm::radians(i * 37.0f), glm::vec3(0, 1, 0));
+        m = glm::rotate(m, glm::radians(25.0f + i % 7), glm::vec3(0, 0, 1));
+        mats[i] = m;
+    }
+
+    std::vector<glm::vec3> pos(RingKernel::MAX_VERTS), axis(RingKernel::MAX_VERTS), radial(RingKernel::MAX_VERTS), normals(RingKernel::MAX_VERTS);
+    float sink = 0;
+    printf("{\n  \"stems\": %d,\n  \"rings\": %d,\n  \"results\": [\n", numStems * repeats, numRings);
+    const int segmentCounts[] = { 3, 5 };
+    for (int si = 0; si < 2; si++) {
+        int segments = segmentCounts[si];
+        double vertices = (double)numStems * repeats * segments * numRings;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r++) {
+            for (int i = 0; i < numStems; i++) {
+                legacyStem(segments, numRings, 4.0f, 3.0f, 20.0f, 0.3f, mats[i], pos.data(), axis.data(), radial.data(), normals.data());
+                sink += pos[i % segments].x;
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r++) {
+            for (int i = 0; i < numStems; i++) {
+                RingKernel::StemRings rings;
+                RingKernel::buildRings(segments, numRings, 4.0f, 3.0f, 20.0f, 0.3f, rings);
+                RingKernel::transformRings(mats[i], rings, pos.data(), axis.data(), radial.data(), normals.data());
+                sink += pos[i % segments].x;
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double legacySec = std::chrono::duration<double>(t1 - t0).count();
+        double kernelSec = std::chrono::duration<double>(t2 - t1).count();
+        printf("    { \"segments\": %d, \"legacy_vertices_per_sec\": %.0f, \"kernel_vertices_per_sec\": %.0f, \"speedup\": %.2f }%s\n",
+               segments, vertices / legacySec, vertices / kernelSec, legacySec / kernelSec, si == 0 ? "," : "");
+    }
+    printf("  ],\n  \"checksum\": %g\n}\n", sink);
+    return 0;
+}
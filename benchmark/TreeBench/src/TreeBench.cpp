@@ -0,0 +1,309 @@
+﻿#include "TreeBench.h"
+#include "Tree.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <set>
+#include <tuple>
+#ifdef TARGET_WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef TARGET_OSX
+#include <mach/mach.h>
+#endif
+#endif
+
+// --- ヒープ確保量の計測 ---
+// グローバルの new / delete を置き換えて、確保したバイト数と回数を数える（ワーカースレッドの分も含む）
+static std::atomic<uint64_t> allocBytes{ 0 };
+static std::atomic<uint64_t> allocCount{ 0 };
+
+void* operator new(size_t size) {
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// プロセスの最大常駐メモリ (バイト)
+static uint64_t getPeakRss() {
+#ifdef TARGET_WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef TARGET_OSX
+    return ru.ru_maxrss;                    // macOS はバイト単位
+#else
+    return (uint64_t)ru.ru_maxrss * 1024;   // Linux は KB 単位
+#endif
+#endif
+}
+
+// 現在のメモリ使用量 (バイト)。Windows はプライベートにコミットした量、それ以外は常駐メモリ
+// 最大値と違って減ることもあるので、条件ごとの前後の差を取れる
+static int64_t getCurrentRss() {
+#ifdef TARGET_WIN32
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) return pmc.PrivateUsage;
+    return 0;
+#elif defined(TARGET_OSX)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+    return info.resident_size;
+#else
+    ifstream statm("/proc/self/statm");
+    int64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+static double getElapsedMs(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// 分割構築は1回の update で持ち時間分しか進まないので、終わるまで呼び続ける
+static void buildTree(Tree& tree, GrowthType gType, FlowerType fType) {
+    tree.update(0, 0, 0, gType, fType);
+    while (tree.isBuilding()) tree.update(0, 0, 0, gType, fType);
+}
+
+static const char* growthTypeNames[] = { "DEFAULT", "ELEGANT", "STURDY", "ELDRITCH" };
+static const char* flowerTypeNames[] = { "NONE", "CRYSTAL", "PETAL", "SPIRIT" };
+
+void TreeBench::setup() {
+    // 標準出力は結果の JSON だけにする（進捗は標準エラーへ）
+    ofSetLogLevel(OF_LOG_ERROR);
+    ofSetDataPathRoot(opt.dataPath);
+
+    ofJson config = ofLoadJson("settings.json");
+    if (config.is_null() || !config.contains("tree")) {
+        ofLogError("TreeBench") << "settings.json not found in " << ofToDataPath("", true);
+        ofExit(1);
+        return;
+    }
+    // 保存済みメッシュの読み込みではなく、毎回の生成を測る
+    config["tree"]["generation"]["mesh_cache"] = false;
+
+    if (opt.check) {
+        ofJson checks = runChecks(config);
+        cout << checks.dump(2) << endl;
+        ofExit(checks["failed"].empty() ? 0 : 1);
+        return;
+    }
+
+    ofJson result;
+    result["benchmark"] = "TreeBench";
+    result["repeats"] = opt.repeats;
+    result["threads"] = WorkerPool::shared().getNumThreads();
+    result["generation"] = config["tree"]["generation"];
+
+    // --- 条件の組み合わせ ---
+    const float mutations[] = { 0.0f, 0.5f, 1.0f };
+    ofJson matrix = ofJson::array();
+    for (int depth = 0; depth <= opt.maxDepth; depth++) {
+        for (int g = 0; g < 4; g++) {
+            for (int f = 0; f < 4; f++) {
+                for (float m : mutations) {
+                    Case c;
+                    c.name = "d" + ofToString(depth) + "_" + growthTypeNames[g] + "_" + flowerTypeNames[f] + "_m" + ofToString(m, 1);
+                    c.gType = (GrowthType)g;
+                    c.fType = (FlowerType)f;
+                    c.tree = { {"seed", 1}, {"max_depth", depth}, {"target_len", 150.0f}, {"target_thick", 12.0f}, {"target_mutation", m} };
+                    matrix.push_back(runCase(config, c));
+                }
+            }
+        }
+        fprintf(stderr, "depth %d done\n", depth);
+    }
+    result["matrix"] = matrix;
+
+    // --- プリセット ---
+    ofJson presets = ofJson::array();
+    for (auto& p : config["presets"]) {
+        Case c;
+        c.name = p.value("name", "");
+        c.gType = (GrowthType)p.value("evo_type", 0);
+        c.fType = (FlowerType)p.value("flower_type", 0);
+        c.tree = p["tree"];
+        presets.push_back(runCase(config, c));
+        fprintf(stderr, "preset %s done\n", c.name.c_str());
+    }
+    result["presets"] = presets;
+    result["process_peak_rss_bytes"] = getPeakRss(); // 全条件を通したプロセスの最大値
+
+    string text = result.dump(2);
+    cout << text << endl;
+    if (!opt.outPath.empty()) {
+        ofstream file(opt.outPath);
+        file << text << "\n";
+    }
+    ofExit(0);
+}
+
+ofJson TreeBench::runCase(const ofJson& config, const Case& c) {
+    // ofApp::loadPreset と同じ手順で木を作る
+    Tree tree;
+    tree.setup(config);
+    tree.reset();
+    tree.loadPresetConfig(c.tree);
+
+    // 1回目はバッファの確保を含む
+    uint64_t bytes0 = allocBytes, count0 = allocCount;
+    int64_t rss0 = getCurrentRss();
+    auto start = BenchClock::now();
+    buildTree(tree, c.gType, c.fType);
+    double firstMs = getElapsedMs(start);
+    int64_t rssDelta = getCurrentRss() - rss0;
+    uint64_t firstBytes = allocBytes - bytes0, firstCount = allocCount - count0;
+
+    // 2回目以降は容量を使い回す作り直し（設定変更やタイプ変化のときと同じ）
+    vector<double> times;
+    bytes0 = allocBytes;
+    count0 = allocCount;
+    for (int i = 0; i < opt.repeats; i++) {
+        tree.setNeedsUpdate();
+        start = BenchClock::now();
+        buildTree(tree, c.gType, c.fType);
+        times.push_back(getElapsedMs(start));
+    }
+    uint64_t rebuildBytes = (allocBytes - bytes0) / opt.repeats;
+    uint64_t rebuildCount = (allocCount - count0) / opt.repeats;
+    sort(times.begin(), times.end());
+    double medianMs = times[times.size() / 2];
+
+    size_t numVerts = tree.getNumVertices();
+    ofJson r;
+    r["name"] = c.name;
+    r["depth"] = tree.getDepthLevel();
+    r["growth_type"] = growthTypeNames[c.gType];
+    r["flower_type"] = flowerTypeNames[c.fType];
+    r["mutation"] = c.tree.value("target_mutation", 0.0f);
+    r["vertices"] = numVerts;
+    r["mesh_bytes"] = tree.getMeshBytes();
+    r["first_build"] = { {"ms", firstMs}, {"bytes_allocated", firstBytes}, {"allocations", firstCount} };
+    r["rebuild"] = {
+        {"ms_min", times.front()}, {"ms_median", medianMs}, {"ms_max", times.back()},
+        {"bytes_allocated", rebuildBytes}, {"allocations", rebuildCount}
+    };
+    r["vertices_per_sec"] = medianMs > 0 ? numVerts / (medianMs / 1000.0) : 0.0;
+    r["rss_delta_bytes"] = rssDelta; // 1回目の構築の前後の差（プロセスの最大値ではない）
+    return r;
+}
+
+ofJson TreeBench::runChecks(const ofJson& config) {
+    ofJson result;
+    result["checks"] = ofJson::array();
+    result["failed"] = ofJson::array();
+    auto check = [&](const string& name, bool pass) {
+        result["checks"].push_back({ {"name", name}, {"pass", pass} });
+        if (!pass) result["failed"].push_back(name);
+        fprintf(stderr, "%s %s\n", pass ? "ok  " : "FAIL", name.c_str());
+    };
+
+    Tree tree;
+    tree.setup(config);
+    tree.reset();
+    tree.loadPresetConfig({ {"seed", 1}, {"max_depth", 3}, {"target_len", 150.0f}, {"target_thick", 12.0f}, {"target_mutation", 0.5f} });
+    buildTree(tree, TYPE_DEFAULT, FLOWER_NONE);
+
+    // getBranchMatrix: 存在する経路だけを受け付ける（分岐は2〜3本、深さ3）
+    glm::mat4 mat;
+    check("branch_matrix_root", tree.getBranchMatrix({}, mat) && mat == glm::mat4(1.0f));
+    check("branch_matrix_valid", tree.getBranchMatrix({ 1, 0, 1 }, mat));
+    check("branch_matrix_out_of_range", !tree.getBranchMatrix({ 3 }, mat));
+    check("branch_matrix_negative", !tree.getBranchMatrix({ 0, -1 }, mat));
+    check("branch_matrix_too_long", !tree.getBranchMatrix({ 0, 0, 0, 0 }, mat));
+
+    // 段の追記の後に粗いメッシュが選ばれたら、追記後の深さで作り直されている
+    ofJson growConfig = config;
+    auto& gen = growConfig["tree"]["generation"];
+    gen["incremental_growth"] = true;
+    gen["lod_levels"] = true;
+    gen["dedup_subtrees"] = false;
+    gen["instanced_stems"] = false;
+    gen["chunked_build"] = false;
+    float expBase = growConfig["tree"].value("depth_exp_base", 30.0f);
+    float expPower = growConfig["tree"].value("depth_exp_power", 1.6f);
+    Tree growing;
+    growing.setup(growConfig);
+    growing.reset();
+    growing.setLodOverride(2);
+    auto growTo = [&](Tree& t, int depth) {
+        while (t.getDepthLevel() < depth) {
+            int next = t.getDepthLevel() + 1;
+            t.addDebugExp(max(0.0f, GrowthRules::getExpForDepth(next, expBase, expPower) - t.getDepthExp()));
+            buildTree(t, TYPE_DEFAULT, FLOWER_NONE);
+        }
+    };
+    buildTree(growing, TYPE_DEFAULT, FLOWER_NONE);
+    growTo(growing, 3);
+    size_t lodBefore = growing.getLodVertices(2);
+    growTo(growing, 4);
+    size_t lodAppended = growing.getLodVertices(2);
+    growing.setNeedsUpdate();
+    buildTree(growing, TYPE_DEFAULT, FLOWER_NONE);
+    size_t lodRebuilt = growing.getLodVertices(2);
+    check("lod_after_append", lodAppended > lodBefore && lodAppended == lodRebuilt);
+
+    // 追記した段の色は、同じ構築時刻で全体を作り直した木の色と一致する
+    // （全体の構築から時間が経ってから段を追記しても、色相・ノイズは既存の段と揃う）
+    ofJson tierConfig = growConfig;
+    tierConfig["tree"]["max_depth"] = 4;
+    Tree tiered;
+    tiered.setup(tierConfig);
+    tiered.reset();
+    buildTree(tiered, TYPE_DEFAULT, FLOWER_NONE);
+    growTo(tiered, 3);
+    tiered.setNeedsUpdate();
+    buildTree(tiered, TYPE_DEFAULT, FLOWER_NONE);
+    float fullBuildTime = tiered.getBuildTime();
+    ofSleepMillis(100);
+    size_t tierStart = tiered.getVboMesh().getNumVertices();
+    growTo(tiered, 4);
+    ofMesh rebuiltMesh;
+    tiered.buildStaticMesh(rebuiltMesh, tiered.getSeed(), fullBuildTime, 0, 4, tiered.getLen(), tiered.getThick(),
+                           tiered.getCurMutation(), tiered.getMaxMutation(), 0, 0, TYPE_DEFAULT, FLOWER_NONE);
+    auto colorKey = [](const ofFloatColor& c) { return std::make_tuple(c.r, c.g, c.b, c.a); };
+    set<std::tuple<float, float, float, float>> rebuiltColors;
+    for (auto& c : rebuiltMesh.getColors()) rebuiltColors.insert(colorKey(c));
+    const auto& tierColors = tiered.getVboMesh().getColors();
+    bool tierMatches = tiered.getDepthLevel() == 4 && tiered.getBuildTime() == fullBuildTime && tierColors.size() > tierStart;
+    for (size_t i = tierStart; i < tierColors.size() && tierMatches; i++) tierMatches = rebuiltColors.count(colorKey(tierColors[i])) > 0;
+    check("appended_tier_colors", tierMatches);
+
+    // 分割構築の作り直し中も、完成するまで前回のチャンクを描き続ける
+    ofJson chunkConfig = config;
+    chunkConfig["tree"]["generation"]["chunked_build"] = true;
+    chunkConfig["tree"]["generation"]["chunk_min_depth"] = 2;
+    chunkConfig["tree"]["generation"]["chunk_vertices"] = 1024;
+    chunkConfig["tree"]["generation"]["chunk_budget_ms"] = 0.0f;
+    Tree chunked;
+    chunked.setup(chunkConfig);
+    chunked.reset();
+    chunked.loadPresetConfig({ {"seed", 1}, {"max_depth", 6}, {"target_len", 150.0f}, {"target_thick", 12.0f}, {"target_mutation", 0.5f} });
+    buildTree(chunked, TYPE_DEFAULT, FLOWER_NONE);
+    size_t chunkedVerts = chunked.getNumVertices();
+    chunked.setNeedsUpdate();
+    chunked.update(0, 0, 0, TYPE_DEFAULT, FLOWER_NONE);
+    bool keptOld = chunked.isBuilding() && chunked.getNumVertices() == chunkedVerts;
+    buildTree(chunked, TYPE_DEFAULT, FLOWER_NONE);
+    check("chunked_rebuild_keeps_old", keptOld && chunked.getNumVertices() == chunkedVerts);
+    return result;
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "Constants.h"
+
+// Tree の生成コストを条件の組み合わせごとに測り、結果を JSON で出力する
+// 深さ 0〜maxDepth x 成長タイプ x 花の種類 x 変異度 (0 / 0.5 / 1.0) と、settings.json の全プリセット
+class TreeBench : public ofBaseApp {
+public:
+    struct Options {
+        int repeats = 5;        // 1条件あたりの作り直しの回数（1回目の構築は別に測る）
+        int maxDepth = 10;
+        string dataPath;        // settings.json とシェーダのあるフォルダ
+        string outPath;         // 空なら標準出力だけ
+        bool check = false;     // 計測の代わりに Tree の整合性チェックだけを走らせる
+    };
+
+    TreeBench(const Options& opt) : opt(opt) {}
+    void setup();
+
+private:
+    struct Case {
+        string name;
+        GrowthType gType;
+        FlowerType fType;
+        ofJson tree;            // プリセットの "tree" と同じ形式
+    };
+
+    ofJson runCase(const ofJson& config, const Case& c);
+    ofJson runChecks(const ofJson& config); // 失敗した項目があれば "failed" に名前を積む
+
+    Options opt;
+};
@@ -0,0 +1,36 @@
+﻿#include "ofMain.h"
+#include "TreeBench.h"
+
+//========================================================================
+// TreeBench [--out result.json] [--repeats N] [--max-depth N] [--data <bin/data のパス>] [--check]
+int main(int argc, char* argv[]) {
+	TreeBench::Options opt;
+	// 既定ではリポジトリの bin/data を使う (benchmark/TreeBench/bin から3つ上)
+	opt.dataPath = ofFilePath::join(ofFilePath::getCurrentExeDir(), "../../../bin/data/");
+	for (int i = 1; i < argc; i++) {
+		string key = argv[i];
+		if (key == "--check") {
+			opt.check = true;
+			continue;
+		}
+		string val = (i + 1 < argc) ? argv[++i] : "";
+		if (key == "--out") opt.outPath = val;
+		else if (key == "--repeats") opt.repeats = max(1, ofToInt(val));
+		else if (key == "--max-depth") opt.maxDepth = ofClamp(ofToInt(val), 0, 10);
+		else if (key == "--data") opt.dataPath = val;
+		else {
+			fprintf(stderr, "unknown option: %s\n", key.c_str());
+			return 1;
+		}
+	}
+
+	// 構築で VBO とシェーダを作るので GL のコンテキストは要るが、窓は表示しない
+	ofGLFWWindowSettings settings;
+	settings.setSize(64, 64);
+	settings.visible = false;
+
+	auto window = ofCreateWindow(settings);
+
+	ofRunApp(window, std::make_shared<TreeBench>(opt));
+	return ofRunMainLoop();
+}
@@ -0,0 +1,15 @@
+#version 120
+// 固定機能ライティング (GL_COLOR_MATERIAL) と同じ環境光＋拡散光
+
+varying vec3 vNormal;
+varying vec3 vViewPos;
+varying vec4 vColor;
+
+void main() {
+    vec3 n = normalize(vNormal);
+    vec4 lp = gl_LightSource[0].position;
+    vec3 l = (lp.w == 0.0) ? normalize(lp.xyz) : normalize(lp.xyz - vViewPos);
+    float diff = max(dot(n, l), 0.0);
+    vec3 light = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * diff;
+    gl_FragColor = vec4(vColor.rgb * light, vColor.a);
+}
@@ -0,0 +1,49 @@
+#version 120
+// 詰めた頂点形式 (PackedMesh) の展開と、補間中の比率・新しい段のスケールイン (restPose.vert と同じ)
+
+uniform vec3 boundsMin;
+uniform vec3 boundsSize;
+uniform float radialMax;      // 軸からのオフセットの量子化範囲
+uniform float lenScale;       // 構築時からの長さの比率
+uniform float thickScale;     // 構築時からの太さの比率
+uniform float time;           // 現在の時刻（生えた時刻の基準からの秒）
+uniform float growthDuration; // スケールインの時間（0 ならしない）
+
+attribute vec4 packedPosition; // unorm16 (バウンディングボックス内)
+attribute vec2 packedNormal;   // snorm16 (八面体エンコード)
+attribute vec4 packedColor;    // unorm8
+attribute vec4 packedRadial;   // snorm16 (軸からのオフセット / radialMax)
+attribute vec4 packedGrowth;   // unorm16 xyz: スケールインの基点 (バウンディングボックス内), w: 生えた時刻 (1/256秒単位)
+
+varying vec3 vNormal;
+varying vec3 vViewPos;
+varying vec4 vColor;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    // 軸上の点は長さに、断面のオフセットは太さに比例させる
+    vec3 rest = boundsMin + packedPosition.xyz * boundsSize;
+    vec3 radial = packedRadial.xyz * radialMax;
+    vec3 p = (rest - radial) * lenScale + radial * thickScale;
+
+    // 生えたばかりの枝は付け根からスケールインさせる (ease-out)
+    if (growthDuration > 0.0) {
+        float g = 1.0 - clamp((time - packedGrowth.w * 65535.0 / 256.0) / growthDuration, 0.0, 1.0);
+        g = 1.0 - g * g * g;
+        vec3 anchor = (boundsMin + packedGrowth.xyz * boundsSize) * lenScale;
+        p = anchor + (p - anchor) * g;
+    }
+
+    vec4 viewPos = gl_ModelViewMatrix * vec4(p, 1.0);
+    vViewPos = viewPos.xyz;
+    vNormal = gl_NormalMatrix * octDecode(packedNormal);
+    vColor = packedColor;
+    gl_Position = gl_ProjectionMatrix * viewPos;
+}
@@ -0,0 +1,18 @@
+#version 120
+// 楕円の縁までの距離（ピクセル）を近似し、縁を1ピクセルでなめらかにする
+
+varying vec4 vShape;
+varying float vStroke;
+varying vec4 vColor;
+
+void main() {
+    vec2 p = vShape.xy;
+    vec2 r = max(vShape.zw, vec2(1e-3)); // 生まれた直後の波紋は半径0
+    // f = |p / r| - 1 を勾配の大きさで割る（円なら |p| - r に一致）
+    float k = length(p / r);
+    float d = (k - 1.0) * k / max(length(p / (r * r)), 1e-6);
+    float edge = (vStroke > 0.0) ? abs(d) - vStroke * 0.5 : d;
+    float a = clamp(0.5 - edge, 0.0, 1.0);
+    if (a <= 0.0) discard;
+    gl_FragColor = vec4(vColor.rgb, vColor.a * a);
+}
@@ -0,0 +1,16 @@
+#version 120
+// 2D パーティクルの円・楕円の輪を四角形1枚ずつで描く (ParticleBatch2D)
+
+attribute vec4 shape;   // 中心からのオフセット (px), x・y 方向の半径 (px)
+attribute float stroke; // 輪の線幅 (px)。0 なら塗りつぶし
+
+varying vec4 vShape;
+varying float vStroke;
+varying vec4 vColor;
+
+void main() {
+    vShape = shape;
+    vStroke = stroke;
+    vColor = gl_Color;
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xy, 0.0, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 120
+// 点の内側を球の法線で陰影付けする（ofDrawSphere と同じ固定機能ライト相当）
+
+varying vec3 vViewPos;
+varying float vRadius;
+varying vec4 vColor;
+
+void main() {
+    vec2 c = gl_PointCoord * 2.0 - 1.0;
+    float d2 = dot(c, c);
+    if (d2 > 1.0) discard;
+    vec3 n = vec3(c.x, -c.y, sqrt(1.0 - d2));
+    vec3 p = vViewPos + n * vRadius;
+    vec4 lp = gl_LightSource[0].position;
+    vec3 l = (lp.w == 0.0) ? normalize(lp.xyz) : normalize(lp.xyz - p);
+    float diff = max(dot(n, l), 0.0);
+    vec3 light = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * diff;
+    gl_FragColor = vec4(vColor.rgb * light, vColor.a);
+}
@@ -0,0 +1,22 @@
+#version 120
+// 3D パーティクルを寿命に比例した半径の球として点で描く (ParticlePool)
+
+uniform float radius;          // 寿命1のときの半径
+uniform float viewportHeight;
+
+attribute float particleLife;
+
+varying vec3 vViewPos;
+varying float vRadius;
+varying vec4 vColor;
+
+void main() {
+    vec4 viewPos = gl_ModelViewMatrix * gl_Vertex;
+    float r = radius * particleLife;
+    // 球の直径をピクセルへ（投影の縦のスケール x 画面の高さの半分 / 距離）
+    gl_PointSize = max(r * gl_ProjectionMatrix[1][1] * viewportHeight / max(-viewPos.z, 0.001), 1.0);
+    vViewPos = viewPos.xyz;
+    vRadius = r;
+    vColor = vec4(gl_Color.rgb, gl_Color.a * particleLife);
+    gl_Position = gl_ProjectionMatrix * viewPos;
+}
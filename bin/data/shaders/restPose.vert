@@ -0,0 +1,34 @@
+#version 120
+// 構築時の形のまま置いた木のメッシュに、補間中の長さ・太さの比率と新しい段のスケールインを掛ける (RestPoseMesh)
+
+uniform float lenScale;       // 構築時からの長さの比率
+uniform float thickScale;     // 構築時からの太さの比率
+uniform float time;           // 現在の時刻（秒）
+uniform float growthDuration; // スケールインの時間（0 ならしない）
+
+attribute vec3 restRadial;    // 軸からのオフセット（太さに比例する成分）
+attribute vec4 growth;        // xyz: スケールインの基点（枝の付け根）, w: 生えた時刻
+
+varying vec3 vNormal;
+varying vec3 vViewPos;
+varying vec4 vColor;
+
+void main() {
+    // 軸上の点は長さに、断面のオフセットは太さに比例させる（Tree::applyRestPose と同じ分解）
+    vec3 axis = gl_Vertex.xyz - restRadial;
+    vec3 p = axis * lenScale + restRadial * thickScale;
+
+    // 生えたばかりの枝は付け根からスケールインさせる (ease-out)
+    if (growthDuration > 0.0) {
+        float g = 1.0 - clamp((time - growth.w) / growthDuration, 0.0, 1.0);
+        g = 1.0 - g * g * g;
+        vec3 anchor = growth.xyz * lenScale;
+        p = anchor + (p - anchor) * g;
+    }
+
+    vec4 viewPos = gl_ModelViewMatrix * vec4(p, 1.0);
+    vViewPos = viewPos.xyz;
+    vNormal = gl_NormalMatrix * gl_Normal;
+    vColor = gl_Color;
+    gl_Position = gl_ProjectionMatrix * viewPos;
+}
@@ -0,0 +1,35 @@
+#version 120
+// 正準の枝メッシュをインスタンスごとの行列・半径・長さで展開 (StemInstancer)
+
+uniform float lenScale;   // 構築時からの長さの比率
+uniform float thickScale; // 構築時からの太さの比率
+
+attribute vec4 instCol0;  // 付け根の行列（列ベクトル）
+attribute vec4 instCol1;
+attribute vec4 instCol2;
+attribute vec4 instCol3;
+attribute vec4 instShape; // r1, r2, 長さ, ねじれ角
+attribute vec4 instColor;
+
+varying vec3 vNormal;
+varying vec3 vViewPos;
+varying vec4 vColor;
+
+void main() {
+    // gl_Vertex.xy = (断面上の角度, 高さ比)
+    float ratio = gl_Vertex.y;
+    float angle = gl_Vertex.x + instShape.w * ratio;
+    vec3 unitPos = vec3(cos(angle), 0.0, sin(angle));
+    float r = mix(instShape.x, instShape.y, ratio);
+
+    // 軸上の点は長さに、断面のオフセットは太さに比例させる（Tree::applyRestPose と同じ分解）
+    mat3 rot = mat3(instCol0.xyz, instCol1.xyz, instCol2.xyz);
+    vec3 axis = instCol3.xyz + rot * vec3(0.0, instShape.z * ratio, 0.0);
+    vec3 p = axis * lenScale + rot * (unitPos * r) * thickScale;
+
+    vec4 viewPos = gl_ModelViewMatrix * vec4(p, 1.0);
+    vViewPos = viewPos.xyz;
+    vNormal = gl_NormalMatrix * (rot * unitPos);
+    vColor = instColor;
+    gl_Position = gl_ProjectionMatrix * viewPos;
+}
@@ -58,6 +58,10 @@ void ofApp::setup() {
 
     weather.setup();
     ground.setup();
+    particles.setup(config["effects"]["particles"].value("capacity", 65536));
+    particleBatch2D.setup();
+    particles2D.setup(config);
+    particleBudget.setup(config);
 
     // --- GUI初期化 ---
     gui.setup("Skill & Debug", "settings.xml", 20, 150);
@@ -149,6 +153,7 @@ void ofApp::loadPreset(int index) {
     myTree.setup(config); 
     myTree.reset();
     myTree.loadPresetConfig(p["tree"]); 
+    selectedBranch = -1;
 
     // 2. 天候の反映
     string wStr = p.value("weather", "SUNNY");
@@ -181,9 +186,7 @@ void ofApp::update() {
     if (myTree.getDayCount() >= state.maxDays && !state.bGameEnded) {
         state.bGameEnded = true;
         // 称号決定
-        if (myTree.getLen() > 200 && myTree.getMaxMutation() < 0.3) state.finalTitle = "Elegant Giant";
-        else if (myTree.getMaxMutation() > 0.8) state.finalTitle = "Herald of Chaos";
-        else state.finalTitle = "Great Spirit Tree";
+        state.finalTitle = GrowthRules::getTitleName(GrowthRules::chooseTitle(myTree.getLen(), myTree.getMaxMutation()));
     }
 
     if (state.bShowDebug && state.bInfiniteSkills) {
@@ -191,9 +194,11 @@ void ofApp::update() {
     }
 
     myTree.update(growthLevel, chaosResistLevel, bloomCatalystLevel, state.currentType, state.currentFlowerType);
+    if (state.bForestMode) forest.update();
     weather.update();
 
     updateCamera();
+    updateBranchPick();
 
     // シンセ音のエンベロープ（減衰）処理
     state.audio.amplitude *= 0.92f;
@@ -213,10 +218,9 @@ void ofApp::update() {
     visualDepthProgress = ofLerp(visualDepthProgress, myTree.getDepthProgress(), 0.1f);
 
     // パーティクル更新
-    for (auto& p : particles) p.update(dt);
-    ofRemove(particles, [](Particle& p) { return p.life <= 0; });
-    for (auto& p : particles2D) p.update(dt);
-    ofRemove(particles2D, [](Particle2D& p) { return p.life <= 0; });
+    particles.update(dt);
+    particleBudget.update(dt, particles2D, particleBatchMicros); // 前のフレームの計測値で縮小率を決める
+    particles2D.update(dt, glm::vec2(ofGetWidth(), ofGetHeight()) * 0.5f);
     if (weather.state == RAINY && ofGetFrameNum() % 3 == 0) {
         spawn2DEffect(P_RAIN_SPLASH);
     }
@@ -227,6 +231,7 @@ void ofApp::update() {
         state.barState = BAR_LEVEL_UP_FLASH; // バーの発光アニメーション開始
         state.barFlashTimer = 0;
         lastDepthLevel = currentLvl;
+        selectedBranch = -1; // 枝の番号が変わるので選択を外す
     }
     // --- バーのアニメーション管理 ---
     if (state.barState == BAR_LEVEL_UP_FLASH) {
@@ -272,6 +277,8 @@ void ofApp::updateCamera() {
 
     // 2. 距離の動的調整（成長に合わせて少し余裕を持たせる）
     float targetDist = std::max(minDist, treeH * 1.8f);
+    // 森モードでは周りの木も画面に入るよう引いて見る
+    if (state.bForestMode) targetDist = std::max(targetDist, forest.getRadius() * 0.5f);
 
     // 3. 回転速度の自動変化（ゲーム終了後の回転を少し速くしてショーケース効果を高める）
     float actualRotSpeed = state.bGameEnded ? rotSpeed * 2.0f : rotSpeed;
@@ -349,21 +356,28 @@ void ofApp::draw() {
     ground.draw();
     drawAura();
     myTree.draw();
-    for (auto& p : particles) p.draw();
+    if (state.bForestMode) forest.draw();
+    particles.draw(2.0f);
+    drawBranchHighlight();
     cam.end();
 
     light.disable();
     ofDisableLighting();
     ofDisableDepthTest();
 
+    // 影のパス（アルファ合成）と発光のパス（加算合成）をそれぞれ1回の描画で描く
     ofEnableAlphaBlending();
-    for (auto& p : particles2D) {
-        p.draw(true, weather.state);
-    }
+    particleBatch2D.clear();
+    particles2D.draw(particleBatch2D, true, weather.state);
+    uint64_t batchStart = ofGetElapsedTimeMicros();
+    particleBatch2D.draw();
+    particleBatchMicros = ofGetElapsedTimeMicros() - batchStart;
     ofEnableBlendMode(OF_BLENDMODE_ADD);
-    for (auto& p : particles2D) {
-        p.draw(false, weather.state);
-    }
+    particleBatch2D.clear();
+    particles2D.draw(particleBatch2D, false, weather.state);
+    batchStart = ofGetElapsedTimeMicros();
+    particleBatch2D.draw();
+    particleBatchMicros += ofGetElapsedTimeMicros() - batchStart;
     ofDisableBlendMode();
 
     weather.draw2D();
@@ -372,17 +386,18 @@ void ofApp::draw() {
     else if (!state.bCinematicMode) {
         drawHUD();
     }
+    drawBranchTooltip();
 
     if (state.bShowDebug) drawDebugOverlay();
 }
 
 void ofApp::spawnBloomParticles() {
-    for (int i = 0; i < 30; i++) {
-        Particle p;
-        p.setup(glm::vec3(0, myTree.getLen() * 2, 0),
-            glm::vec3(ofRandom(-2, 2), ofRandom(2, 5), ofRandom(-2, 2)),
-            ofColor(255, 150, 200));
-        particles.push_back(p);
+    int count = config["effects"]["particles"].value("bloom_count", 30);
+    glm::vec3 origin(0, myTree.getLen() * 2, 0);
+    ofFloatColor col = ofColor(255, 150, 200);
+    for (int i = 0; i < count; i++) {
+        // 約1〜3秒で消滅。容量を超えた分は出さない
+        if (!particles.spawn(origin, glm::vec3(ofRandom(-2, 2), ofRandom(2, 5), ofRandom(-2, 2)), col, ofRandom(0.01f, 0.03f))) break;
     }
 }
 
@@ -740,18 +755,24 @@ void ofApp::drawDebugOverlay() {
     ofScale(scale, scale);
     string d = "=== DEBUG INFO ===\n";
     d += "FPS: " + ofToString(ofGetFrameRate(), 1) + "\n";
-    d += "VBO Vertices: " + ofToString(myTree.getVboMesh().getNumVertices()) + "\n";
+    d += "VBO Vertices: " + ofToString(myTree.getNumVertices()) + " (LOD " + ofToString(myTree.getLodLevel()) + ")\n";
+    d += "VBO Memory: " + ofToString(myTree.getMeshBytes() / 1024) + " KB\n";
     d += "2D Particles: " + ofToString(particles2D.size()) + "\n";
-    d += "3D Particles: " + ofToString(particles.size()) + "\n";
+    d += particleBudget.getReport(particles2D);
+    d += "3D Particles: " + ofToString(particles.size()) + " / " + ofToString(particles.getCapacity()) + "\n";
+    if (state.bForestMode) {
+        d += "Forest: " + ofToString(forest.getNumVisible()) + " / " + ofToString(forest.size()) + " trees, " + ofToString(forest.getNumDrawCalls()) + " draws\n";
+        d += "Forest Near/Mid: " + ofToString(forest.getNumResident(Forest::LEVEL_NEAR)) + " / " + ofToString(forest.getNumResident(Forest::LEVEL_MID)) + ", " + ofToString(forest.getMeshBytes() / (1024 * 1024)) + " MB\n";
+    }
     d += "------------------\n";
     d += "Depth: " + ofToString(myTree.getDepthLevel()) + " / " + ofToString(config["tree"].value("max_depth", 8)) + "\n";
     d += "Exp: " + ofToString(myTree.getDepthExp(), 1) + "\n";
     d += "Length: " + ofToString(myTree.getLen(), 1) + " (Target: " + ofToString(myTree.getLen(), 1) + ")\n";
     d += "Thick: " + ofToString(myTree.getThick(), 1) + "\n";
     d += "Mutation: " + ofToString(myTree.getMaxMutation(), 3);
-    float dw = 300;
+    float dw = 380;
     ofSetColor(0, 200);
-    ofDrawRectangle(ofGetWidth() / scale - dw - 20, 20, dw, 190);
+    ofDrawRectangle(ofGetWidth() / scale - dw - 20, 20, dw, state.bForestMode ? 310 : 270);
     ofSetColor(0, 255, 0);
     mainFont.drawString(d, ofGetWidth() / scale - dw - 10, 40);
 
@@ -777,7 +798,13 @@ void ofApp::spawn2DEffect(ParticleType type) {
     float sh = ofGetHeight();
     float screenScale = getUIScale();
 
-    int count = (type == P_RAIN_SPLASH) ? 1 : 60 * screenScale;
+    // 演出の密度は effects.particles.density_2d 倍（雨の波紋は1つずつ）
+    // 処理時間が予算を超えているときは、数・寿命・大きさを particleBudget の縮小率に合わせて減らす
+    float density = config["effects"]["particles"].value("density_2d", 1.0f);
+    int count = (type == P_RAIN_SPLASH) ? 1 : 60 * screenScale * density;
+    count = particleBudget.getSpawnCount(type, count, particles2D);
+    float decayScale = particleBudget.getDecayScale();
+    float sizeScale = particleBudget.getSizeScale();
 
     for (int i = 0; i < count; i++) {
         Particle2D p;
@@ -829,7 +856,9 @@ void ofApp::spawn2DEffect(ParticleType type) {
             p.decay = 0.02f;
         } break;
         }
-        particles2D.push_back(p);
+        p.decay *= decayScale;
+        p.sizeScale = sizeScale;
+        particles2D.add(p);
     }
 }
 
@@ -987,6 +1016,14 @@ void ofApp::keyPressed(int key) {
         if (key == ' ') state.bTimeFrozen = !state.bTimeFrozen;
         // [+] 経験値加算（レベルアップ演出のテスト用）
         if (key == '+' || key == '=') myTree.addDebugExp(50.0f);
+        // [G] 森モードの切り替え
+        if (key == 'g' || key == 'G') toggleForest();
+        // [X] 現在の木を .glb で書き出す（オフラインレンダリング用）
+        if (key == 'x' || key == 'X') {
+            ofDirectory::createDirectory("export", true, true);
+            string path = ofToDataPath("export/tree_" + ofGetTimestampString() + ".glb");
+            myTree.exportMesh(path, ofGetElapsedTimef(), myTree.getDepthLevel(), chaosResistLevel, bloomCatalystLevel, state.currentType, state.currentFlowerType);
+        }
     }
     processCommand(key);
 }
@@ -1003,7 +1040,7 @@ void ofApp::processCommand(int key) {
 void ofApp::upgradeGrowth() { 
     int cost = config["game"]["skill_costs"].value("growth", 1);
     if (state.skillPoints >= cost && growthLevel < 5) {
-        growthLevel++; state.skillPoints--; 
+        growthLevel++; state.skillPoints -= cost; 
         auto c = config["tree"]["colors"]["aura_growth"];
         triggerAura(ofColor(c[0], c[1], c[2]));
     } 
@@ -1011,7 +1048,7 @@ void ofApp::upgradeGrowth() {
 void ofApp::upgradeResist() {
     int cost = config["game"]["skill_costs"].value("resist", 1);
     if (state.skillPoints >= cost && chaosResistLevel < 5) { 
-        chaosResistLevel++; state.skillPoints--; 
+        chaosResistLevel++; state.skillPoints -= cost; 
         auto c = config["tree"]["colors"]["aura_resist"];
         triggerAura(ofColor(c[0], c[1], c[2]));
     } 
@@ -1019,7 +1056,7 @@ void ofApp::upgradeResist() {
 void ofApp::upgradeCatalyst() {
     int cost = config["game"]["skill_costs"].value("catalyst", 1);
     if (state.skillPoints >= cost && bloomCatalystLevel < 5) { 
-        bloomCatalystLevel++; state.skillPoints--; 
+        bloomCatalystLevel++; state.skillPoints -= cost; 
         auto c = config["tree"]["colors"]["aura_catalyst"];
         triggerAura(ofColor(c[0], c[1], c[2]));
     } 
@@ -1032,13 +1069,7 @@ void ofApp::checkEvolution() {
     int dayBloom = g.value("evo_day_bloom", 40);
     // 20日目かつ、まだデフォルト状態の場合のみ実行
     if (day == dayBranch && state.currentType == TYPE_DEFAULT) {
-        float L = myTree.getTotalLenEarned();
-        float T = myTree.getTotalThickEarned();
-        float M = myTree.getTotalMutationEarned();
-
-        if (L >= T && L >= M) state.currentType = TYPE_ELEGANT;
-        else if (T >= L && T >= M) state.currentType = TYPE_STURDY;
-        else state.currentType = TYPE_ELDRITCH;
+        state.currentType = GrowthRules::chooseGrowthType(myTree.getTotalLenEarned(), myTree.getTotalThickEarned(), myTree.getTotalMutationEarned());
 
         myTree.applyEvolution(state.currentType);
         state.evo.hasEvolvedType = true;
@@ -1047,15 +1078,91 @@ void ofApp::checkEvolution() {
     }
     if (day == dayBloom && state.currentFlowerType == FLOWER_NONE) {
         // 現在の成長タイプに応じて花の形を決定
-        if (state.currentType == TYPE_ELEGANT) state.currentFlowerType = FLOWER_CRYSTAL;
-        else if (state.currentType == TYPE_STURDY) state.currentFlowerType = FLOWER_PETAL;
-        else state.currentFlowerType = FLOWER_SPIRIT;
+        state.currentFlowerType = GrowthRules::chooseFlowerType(state.currentType);
 
         state.evo.hasEvolvedFlower = true;
         spawn2DEffect(P_BLOOM);
     }
 }
 
+void ofApp::toggleForest() {
+    state.bForestMode = !state.bForestMode;
+    // 初めて有効にしたときに植え、以後は同じ森を使い回す
+    if (state.bForestMode && forest.size() == 0) {
+        auto f = config.value("forest", ofJson::object());
+        forest.setup(config);
+        forest.plant(f.value("count", 1000), f.value("seed", 1));
+    }
+    ground.setup(state.bForestMode ? std::max(4000.0f, forest.getRadius() * 2.4f) : 4000.0f);
+}
+
+void ofApp::updateBranchPick() {
+    // ボタン・スキルの上では枝を調べない
+    bBranchHovered = false;
+    if (state.bCinematicMode || hoveredButtonIndex != -1 || hoveredSkillIndex != -1) return;
+    glm::vec3 origin = cam.getGlobalPosition();
+    glm::vec3 farPt = cam.screenToWorld(glm::vec3(ofGetMouseX(), ofGetMouseY(), 1.0f));
+    bBranchHovered = myTree.pickBranch(origin, farPt - origin, hoveredBranch);
+}
+
+void ofApp::drawBranchHighlight() {
+    if (state.bCinematicMode) return;
+    ofPushStyle();
+    ofDisableLighting();
+    ofDisableDepthTest(); // 手前の枝に隠れていても見えるようにする
+    ofNoFill();
+    auto drawCapsule = [](const BranchBvh::Branch& b) {
+        ofDrawLine(b.base, b.tip);
+        ofDrawSphere(b.base, b.radius);
+        ofDrawSphere(b.tip, b.radius);
+    };
+    BranchBvh::Hit selected;
+    if (selectedBranch >= 0 && myTree.getBranchInfo(selectedBranch, selected)) {
+        ofSetColor(255, 220, 80);
+        drawCapsule(selected.branch);
+    }
+    if (bBranchHovered && hoveredBranch.index != selectedBranch) {
+        ofSetColor(255, 255, 255, 180);
+        drawCapsule(hoveredBranch.branch);
+    }
+    ofEnableDepthTest();
+    ofEnableLighting();
+    ofPopStyle();
+}
+
+void ofApp::drawBranchTooltip() {
+    if (state.bCinematicMode) return;
+    auto drawInfo = [](const BranchBvh::Hit& h, glm::vec2 pos, ofColor frame) {
+        const BranchBvh::Branch& b = h.branch;
+        string msg = "BRANCH #" + ofToString(h.index) + "\n";
+        msg += "Depth: " + ofToString(b.level) + (b.parent < 0 ? " (Trunk)" : "") + "\n";
+        msg += "Radius: " + ofToString(b.radius, 2) + "\n";
+        msg += "Hue: " + ofToString(b.hue, 1) + "\n";
+        msg += "Subtree: " + ofToString(b.subtreeSize) + " branches";
+        ofPushStyle();
+        ofSetColor(0, 0, 0, 200);
+        ofDrawRectangle(pos.x, pos.y, 190, 78);
+        ofSetColor(frame);
+        ofNoFill();
+        ofDrawRectangle(pos.x, pos.y, 190, 78);
+        ofSetColor(ofColor::fromHsb(b.hue, 160, 220));
+        ofFill();
+        ofDrawRectangle(pos.x + 170, pos.y + 8, 12, 12);
+        ofSetColor(255);
+        ofDrawBitmapString(msg, pos.x + 8, pos.y + 16);
+        ofPopStyle();
+    };
+    // 選んだ枝は枝の中ほど、指している枝はカーソルの横に出す
+    BranchBvh::Hit selected;
+    if (selectedBranch >= 0 && myTree.getBranchInfo(selectedBranch, selected)) {
+        glm::vec3 p = cam.worldToScreen((selected.branch.base + selected.branch.tip) * 0.5f);
+        drawInfo(selected, glm::vec2(p.x + 12, p.y - 40), ofColor(255, 220, 80));
+    }
+    if (bBranchHovered && hoveredBranch.index != selectedBranch) {
+        drawInfo(hoveredBranch, glm::vec2(ofGetMouseX() + 16, ofGetMouseY() + 16), ofColor(255));
+    }
+}
+
 void ofApp::resetGame() {
     // 1. 基本ステータスの初期化
     state.dayCount = 1;
@@ -1090,6 +1197,8 @@ void ofApp::resetGame() {
     particles.clear();
     particles2D.clear();
     auraBeams.clear();
+    selectedBranch = -1;
+    bBranchHovered = false;
     state.auraTimer = 0.0f;
 
     // 5. カメラとライティングのリセット
@@ -1116,6 +1225,10 @@ void ofApp::mousePressed(int x, int y, int button) {
         else if (hoveredSkillIndex == 1) upgradeResist();
         else if (hoveredSkillIndex == 2) upgradeCatalyst();
     }
+    // UI の外をクリックしたら指している枝を選び、何もない所なら選択を外す
+    if (hoveredButtonIndex == -1 && hoveredSkillIndex == -1 && button == OF_MOUSE_BUTTON_LEFT) {
+        selectedBranch = bBranchHovered ? hoveredBranch.index : -1;
+    }
 }
 
 void ofApp::mouseReleased(int x, int y, int button) {}
@@ -4,11 +4,14 @@
 #include "..\Tree.h"
 #include "..\Weather.h"
 #include "..\Ground.h"
-#include "../Particle.h"
+#include "..\Forest.h"
+#include "..\ParticlePool.h"
+#include "..\ParticleSystem2D.h"
+#include "..\ParticleBudget.h"
 
 class ofApp : public ofBaseApp{
 	public:
-		// --- WCxg ---
+		// --- 標準イベント ---
 		void setup();
 		void update();
 		void draw();
@@ -32,7 +35,7 @@ class ofApp : public ofBaseApp{
 			return defaultCol;
 		}
 
-		// --- eCxg ---
+		// --- 各種イベント ---
 		void keyReleased(int key);
 		void mouseMoved(int x, int y );
 		void mouseDragged(int x, int y, int button);
@@ -44,7 +47,7 @@ class ofApp : public ofBaseApp{
 		void gotMessage(ofMessage msg);
 
 	private:
-		// ... UI`惁\bhQ ...
+		// ... UI描画メソッド群 ...
 		void drawHUD();
 		void drawRightGrowthSlots(float scale);
 		void drawLeftStatusPanel(float scale);
@@ -54,7 +57,7 @@ class ofApp : public ofBaseApp{
 		void drawAura();
 		void triggerAura(ofColor col);
 
-		// ... [eBeB ...
+		// ... ユーティリティ ...
 		float getUIScale();
 		void executeCommand(CommandType type);
 		void updateCamera();
@@ -62,34 +65,45 @@ class ofApp : public ofBaseApp{
 		void spawn2DEffect(ParticleType type);
 		void updateWeatherBGM();
 
-		// --- XL ---
+		// --- スキル処理 ---
 		void upgradeGrowth();
 		void upgradeResist();
 		void upgradeCatalyst();
 		void checkEvolution();
+		void toggleForest();
+		void updateBranchPick();
+		void drawBranchHighlight();
+		void drawBranchTooltip();
 
-		// --- VXeϐ ---
+		// --- システム変数 ---
 		ofJson config;
 		ofTrueTypeFont mainFont;
 		GameState state;
 		int hoveredSkillIndex = -1;
-		vector<AuraBeam> auraBeams; // Constants.h̒`gp
+		vector<AuraBeam> auraBeams; // Constants.hの定義を使用
 
-		// ... IuWFNg ...
+		// ... オブジェクト ...
 		Tree myTree;
 		Weather weather;
 		Ground ground;
+		Forest forest;     // 森モードで周囲に植える木
 		ofEasyCam cam;
+		BranchBvh::Hit hoveredBranch;  // マウスが指している枝
+		bool bBranchHovered = false;
+		int selectedBranch = -1;       // クリックで選んだ枝の番号（段が増えたら外す）
 		ofLight light;
-		vector<Particle> particles;
-		vector<Particle2D> particles2D;
+		ParticlePool particles;  // 3D パーティクル（固定容量）
+		ParticleSystem2D particles2D;     // 2D パーティクル（種類ごとの配列）
+		ParticleBatch2D particleBatch2D;  // 2D パーティクルをパスごとにまとめて描く
+		ParticleBudget particleBudget;    // 2D パーティクルの数と処理時間の上限
+		uint64_t particleBatchMicros = 0; // 直近のフレームで particleBatch2D の描画にかかった時間
 
 		// --- GUI ---
 		ofxPanel gui;
 		ofParameter<int> growthLevel, chaosResistLevel, bloomCatalystLevel;
 		ofxButton btnGrowth, btnResist, btnCatalyst;
 
-		// \[X
+		// 音響リソース
 		ofSoundStream soundStream;
 		map<string, ofSoundPlayer> bgmMap;
 		map<string, ofSoundPlayer> seMap;
@@ -104,7 +118,7 @@ class ofApp : public ofBaseApp{
 		void processCommand(int key);
 		void spawnBloomParticles();
 
-		// --- VXeϐƐݒ ---
+		// --- システム変数と設定 ---
 		float visualDepthProgress = 0;
 		int lastDepthLevel = 0;
 		ofColor auraColor;
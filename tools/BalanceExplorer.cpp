@@ -0,0 +1,403 @@
+﻿// 育成ゲームのバランスを Monte Carlo で調べる
+// 設定の変種 x 操作の方針 (policy) ごとに GrowthSim で大量のゲームを回し、成長タイプ・花・称号などの分布を JSON で出力する
+// ゲームは固定数ずつのジョブに分けて WorkerPool で並列に回す。乱数はゲームの番号から決まるので、結果はスレッド数に依存しない
+//   g++ -O2 -std=c++17 -pthread -I.. -I<of>/libs/json/include BalanceExplorer.cpp ../GrowthSim.cpp -o balance
+//   cl /O2 /std:c++17 /EHsc /I.. /I<of>\libs\json\include BalanceExplorer.cpp ..\GrowthSim.cpp
+//
+// balance [--settings ../bin/data/settings.json] [--games N] [--seed N] [--threads N] [--frames N]
+//         [--policy P]... [--skills none|random] [--variants variants.json] [--sweep key=v1,v2,...]...
+//   方針 P:
+//     random              3つのコマンドを等確率で選ぶ
+//     biased:W,F,K        WATER / FERTILIZER / KOTODAMA を重みの比で選ぶ
+//     greedy:GOAL[:EPS]   1手先を読んで GOAL の評価が一番良いコマンドを選ぶ（確率 EPS でランダム）
+//                         GOAL = len | thick | mutation | giant (変異度 0.3 未満を保って長さを伸ばす)
+//   --variants は settings.json に重ねる差分の配列 ([{"name": "...", "game": {"water_increment": 20}}, ...])
+//   --sweep は "game.water_increment=10,15,20" のように値を並べ、複数あれば全組み合わせを変種にする
+#include "GrowthSim.h"
+#include "BranchRng.h"
+#include "WorkerPool.h"
+#include "json.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using Json = nlohmann::json;
+
+// ゲームごとの乱数 (splitmix64)
+struct PolicyRng {
+    uint64_t state;
+    uint64_t next() {
+        state += 0x9E3779B97F4A7C15ull;
+        return BranchRng::mix(state);
+    }
+    float uniform() { return (float)(next() >> 40) * (1.0f / 16777216.0f); }
+};
+
+// ============================================================
+// 操作の方針
+// ============================================================
+enum PolicyKind { POLICY_RANDOM, POLICY_BIASED, POLICY_GREEDY };
+enum GreedyGoal { GOAL_LEN, GOAL_THICK, GOAL_MUTATION, GOAL_GIANT };
+
+struct Policy {
+    string name;
+    PolicyKind kind = POLICY_RANDOM;
+    float weights[3] = { 1, 1, 1 };
+    GreedyGoal goal = GOAL_LEN;
+    float epsilon = 0;
+};
+
+static bool parsePolicy(const string& spec, Policy& p) {
+    p = Policy();
+    p.name = spec;
+    vector<string> parts;
+    std::stringstream ss(spec);
+    for (string s; std::getline(ss, s, ':');) parts.push_back(s);
+    if (parts.empty()) return false;
+    if (parts[0] == "random" && parts.size() == 1) return true;
+    if (parts[0] == "biased" && parts.size() == 2) {
+        p.kind = POLICY_BIASED;
+        return sscanf(parts[1].c_str(), "%f,%f,%f", &p.weights[0], &p.weights[1], &p.weights[2]) == 3
+            && p.weights[0] + p.weights[1] + p.weights[2] > 0;
+    }
+    if (parts[0] == "greedy" && (parts.size() == 2 || parts.size() == 3)) {
+        p.kind = POLICY_GREEDY;
+        if (parts[1] == "len") p.goal = GOAL_LEN;
+        else if (parts[1] == "thick") p.goal = GOAL_THICK;
+        else if (parts[1] == "mutation") p.goal = GOAL_MUTATION;
+        else if (parts[1] == "giant") p.goal = GOAL_GIANT;
+        else return false;
+        if (parts.size() == 3) p.epsilon = std::stof(parts[2]);
+        return true;
+    }
+    return false;
+}
+
+static float evalGoal(GreedyGoal goal, const GrowthState& st) {
+    switch (goal) {
+    case GOAL_LEN: return st.targets.len;
+    case GOAL_THICK: return st.targets.thick;
+    case GOAL_MUTATION: return st.targets.mutation + st.maxMutationReached;
+    case GOAL_GIANT: return st.maxMutationReached < 0.3f ? st.targets.len : -st.maxMutationReached;
+    }
+    return 0;
+}
+
+static CommandType chooseCommand(const Policy& p, const GrowthSim& sim, PolicyRng& rng) {
+    if (p.kind == POLICY_RANDOM || (p.kind == POLICY_GREEDY && rng.uniform() < p.epsilon)) {
+        return (CommandType)(rng.next() % 3);
+    }
+    if (p.kind == POLICY_BIASED) {
+        float r = rng.uniform() * (p.weights[0] + p.weights[1] + p.weights[2]);
+        if (r < p.weights[0]) return CMD_WATER;
+        if (r < p.weights[0] + p.weights[1]) return CMD_FERTILIZER;
+        return CMD_KOTODAMA;
+    }
+    // 1手先の状態を評価する（同点は乱数で選ぶ）
+    CommandType best = CMD_WATER;
+    float bestScore = 0;
+    int ties = 0;
+    for (int c = 0; c < 3; c++) {
+        GrowthSim next = sim;
+        next.command((CommandType)c);
+        float score = evalGoal(p.goal, next.getState());
+        if (c == 0 || score > bestScore) {
+            best = (CommandType)c;
+            bestScore = score;
+            ties = 1;
+        }
+        else if (score == bestScore && rng.next() % ++ties == 0) {
+            best = (CommandType)c;
+        }
+    }
+    return best;
+}
+
+// 払えるスキルをランダムに1つ上げる
+static void spendSkills(GrowthSim& sim, PolicyRng& rng) {
+    const GrowthState& st = sim.getState();
+    const GrowthConfig& cfg = sim.getConfig();
+    while (true) {
+        SkillType options[3];
+        int n = 0;
+        for (int s = 0; s < 3; s++) {
+            if (st.skillPoints >= cfg.skillCosts[s] && st.skillLevels[s] < cfg.maxSkillLevel) options[n++] = (SkillType)s;
+        }
+        if (n == 0) return;
+        sim.upgrade(options[rng.next() % n]);
+    }
+}
+
+// ============================================================
+// 結果の集計
+// ============================================================
+struct Outcome {
+    uint64_t games = 0;
+    uint64_t type[4] = {}, flower[4] = {}, title[4] = {};
+    uint64_t typeTitle[4][4] = {};
+    vector<uint64_t> depth;             // 最終的な深さごとの数
+    uint64_t maxDepthGames = 0;         // 最大深度に達したゲーム数
+    double maxDepthDaySum = 0;
+    uint64_t bloomGames = 0;            // 花が咲いたゲーム数
+    double bloomDaySum = 0;
+    double lenSum = 0, thickSum = 0, maxMutationSum = 0;
+    double skillSum[3] = {};
+    double commandSum[3] = {};
+
+    void add(const GrowthState& st) {
+        games++;
+        type[st.type]++;
+        flower[st.flower]++;
+        title[st.title]++;
+        typeTitle[st.type][st.title]++;
+        if (st.depthLevel >= (int)depth.size()) depth.resize(st.depthLevel + 1);
+        depth[st.depthLevel]++;
+        if (st.maxDepthDay > 0) {
+            maxDepthGames++;
+            maxDepthDaySum += st.maxDepthDay;
+        }
+        if (st.bloomDay > 0) {
+            bloomGames++;
+            bloomDaySum += st.bloomDay;
+        }
+        lenSum += st.len;
+        thickSum += st.thick;
+        maxMutationSum += st.maxMutationReached;
+        for (int i = 0; i < 3; i++) {
+            skillSum[i] += st.skillLevels[i];
+            commandSum[i] += st.commandCounts[i];
+        }
+    }
+
+    void merge(const Outcome& o) {
+        games += o.games;
+        for (int i = 0; i < 4; i++) {
+            type[i] += o.type[i];
+            flower[i] += o.flower[i];
+            title[i] += o.title[i];
+            for (int j = 0; j < 4; j++) typeTitle[i][j] += o.typeTitle[i][j];
+        }
+        if (o.depth.size() > depth.size()) depth.resize(o.depth.size());
+        for (size_t i = 0; i < o.depth.size(); i++) depth[i] += o.depth[i];
+        maxDepthGames += o.maxDepthGames;
+        maxDepthDaySum += o.maxDepthDaySum;
+        bloomGames += o.bloomGames;
+        bloomDaySum += o.bloomDaySum;
+        lenSum += o.lenSum;
+        thickSum += o.thickSum;
+        maxMutationSum += o.maxMutationSum;
+        for (int i = 0; i < 3; i++) {
+            skillSum[i] += o.skillSum[i];
+            commandSum[i] += o.commandSum[i];
+        }
+    }
+
+    Json toJson() const {
+        Json r;
+        r["games"] = games;
+        Json types, flowers, titles, byType;
+        for (int i = 0; i < 4; i++) {
+            types[GrowthRules::getGrowthTypeName((GrowthType)i)] = type[i];
+            flowers[GrowthRules::getFlowerTypeName((FlowerType)i)] = flower[i];
+            // 終わらなかったゲーム (max_days が日数の上限を超える設定) は "none"
+            titles[i == TITLE_NONE ? "none" : GrowthRules::getTitleName((GameTitle)i)] = title[i];
+            Json t;
+            for (int j = 0; j < 4; j++) {
+                if (typeTitle[i][j]) t[j == TITLE_NONE ? "none" : GrowthRules::getTitleName((GameTitle)j)] = typeTitle[i][j];
+            }
+            if (!t.empty()) byType[GrowthRules::getGrowthTypeName((GrowthType)i)] = t;
+        }
+        r["growth_type"] = types;
+        r["flower_type"] = flowers;
+        r["title"] = titles;
+        r["title_by_type"] = byType;
+        r["depth_level"] = depth;
+        r["max_depth_reached"] = maxDepthGames;
+        r["max_depth_day_mean"] = maxDepthGames ? maxDepthDaySum / maxDepthGames : 0.0;
+        r["bloomed"] = bloomGames;
+        r["bloom_day_mean"] = bloomGames ? bloomDaySum / bloomGames : 0.0;
+        double n = games ? (double)games : 1.0;
+        r["mean"] = {
+            {"len", lenSum / n}, {"thick", thickSum / n}, {"max_mutation", maxMutationSum / n},
+            {"skill_levels", { skillSum[0] / n, skillSum[1] / n, skillSum[2] / n }},
+            {"commands", { commandSum[0] / n, commandSum[1] / n, commandSum[2] / n }}
+        };
+        return r;
+    }
+};
+
+struct Variant {
+    string name;
+    Json patch;
+    GrowthConfig cfg;
+};
+
+// "game.skill_costs.growth" と値から差分のオブジェクトを作る
+static Json makePatch(const string& key, const Json& value) {
+    Json patch = value;
+    size_t end = key.size();
+    while (true) {
+        size_t dot = key.rfind('.', end - 1);
+        string part = key.substr(dot == string::npos ? 0 : dot + 1, end - (dot == string::npos ? 0 : dot + 1));
+        patch = Json{ {part, patch} };
+        if (dot == string::npos) return patch;
+        end = dot;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    string settingsPath = "../bin/data/settings.json";
+    string variantsPath;
+    vector<string> policySpecs, sweeps;
+    uint64_t gamesPerCell = 20000;
+    uint64_t seed = 1;
+    int threads = 0;
+    int frames = -1;
+    bool bSpendSkills = true;
+    for (int i = 1; i < argc; i++) {
+        string key = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", key.c_str());
+            return 1;
+        }
+        string val = argv[++i];
+        if (key == "--settings") settingsPath = val;
+        else if (key == "--games") gamesPerCell = std::max(1ull, std::stoull(val));
+        else if (key == "--seed") seed = std::stoull(val);
+        else if (key == "--threads") threads = std::stoi(val);
+        else if (key == "--frames") frames = std::stoi(val);
+        else if (key == "--policy") policySpecs.push_back(val);
+        else if (key == "--skills") bSpendSkills = (val != "none");
+        else if (key == "--variants") variantsPath = val;
+        else if (key == "--sweep") sweeps.push_back(val);
+        else {
+            fprintf(stderr, "unknown option: %s\n", key.c_str());
+            return 1;
+        }
+    }
+    if (policySpecs.empty()) {
+        policySpecs = { "random", "biased:2,1,1", "biased:1,2,1", "biased:1,1,2",
+                        "greedy:len:0.1", "greedy:thick:0.1", "greedy:mutation:0.1", "greedy:giant:0.1" };
+    }
+    vector<Policy> policies(policySpecs.size());
+    for (size_t i = 0; i < policySpecs.size(); i++) {
+        if (!parsePolicy(policySpecs[i], policies[i])) {
+            fprintf(stderr, "bad policy: %s\n", policySpecs[i].c_str());
+            return 1;
+        }
+    }
+
+    std::ifstream file(settingsPath);
+    if (!file) {
+        fprintf(stderr, "%s not found\n", settingsPath.c_str());
+        return 1;
+    }
+    Json base = Json::parse(file);
+
+    // --- 設定の変種 ---
+    vector<Variant> variants;
+    if (!variantsPath.empty()) {
+        std::ifstream vf(variantsPath);
+        if (!vf) {
+            fprintf(stderr, "%s not found\n", variantsPath.c_str());
+            return 1;
+        }
+        for (auto& v : Json::parse(vf)) {
+            Json patch = v;
+            patch.erase("name");
+            variants.push_back({ v.value("name", "variant" + std::to_string(variants.size())), patch, GrowthConfig() });
+        }
+    }
+    if (variants.empty()) variants.push_back({ sweeps.empty() ? "base" : "", Json::object(), GrowthConfig() });
+    for (auto& sweep : sweeps) {
+        size_t eq = sweep.find('=');
+        if (eq == string::npos) {
+            fprintf(stderr, "bad sweep: %s\n", sweep.c_str());
+            return 1;
+        }
+        string key = sweep.substr(0, eq);
+        vector<Variant> expanded;
+        std::stringstream ss(sweep.substr(eq + 1));
+        for (string value; std::getline(ss, value, ',');) {
+            for (auto& v : variants) {
+                Variant nv = v;
+                nv.name += (nv.name.empty() ? "" : " ") + key + "=" + value;
+                nv.patch.merge_patch(makePatch(key, Json::parse(value)));
+                expanded.push_back(nv);
+            }
+        }
+        variants = expanded;
+    }
+    for (auto& v : variants) {
+        Json config = base;
+        config.merge_patch(v.patch);
+        v.cfg.load(config);
+        if (frames >= 0) v.cfg.framesPerCommand = frames;
+    }
+
+    // --- 並列実行 ---
+    // ジョブ = (変種, 方針, ゲームの区間)。区間ごとに集計し、最後に番号順にまとめる
+    const uint64_t GAMES_PER_JOB = 1024;
+    uint64_t jobsPerCell = (gamesPerCell + GAMES_PER_JOB - 1) / GAMES_PER_JOB;
+    size_t numCells = variants.size() * policies.size();
+    vector<Outcome> partial(numCells * jobsPerCell);
+    WorkerPool pool(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(partial.size(), [&](size_t job) {
+        size_t cell = job / jobsPerCell;
+        const Variant& variant = variants[cell / policies.size()];
+        const Policy& policy = policies[cell % policies.size()];
+        uint64_t first = (job % jobsPerCell) * GAMES_PER_JOB;
+        uint64_t last = std::min(first + GAMES_PER_JOB, gamesPerCell);
+
+        // 集計はローカルで行い、最後に1回だけ書き込む（隣のジョブとキャッシュラインを取り合わない）
+        GrowthSim sim(variant.cfg);
+        Outcome out;
+        for (uint64_t g = first; g < last; g++) {
+            uint64_t key = BranchRng::child(BranchRng::child(BranchRng::mix(seed), (int)cell), (int)g);
+            PolicyRng rng{ key };
+            sim.reset(key);
+            while (!sim.isEnded() && sim.getState().day < GrowthRules::DAY_LIMIT) {
+                if (bSpendSkills) spendSkills(sim, rng);
+                sim.command(chooseCommand(policy, sim, rng));
+            }
+            out.add(sim.getState());
+        }
+        partial[job] = out;
+    });
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Json result;
+    result["seed"] = seed;
+    result["games_per_cell"] = gamesPerCell;
+    result["threads"] = pool.getNumThreads();
+    result["elapsed_sec"] = elapsed;
+    result["games_per_sec"] = numCells * gamesPerCell / elapsed;
+    Json variantResults = Json::array();
+    for (size_t v = 0; v < variants.size(); v++) {
+        Json vr;
+        vr["name"] = variants[v].name;
+        vr["overrides"] = variants[v].patch;
+        Json pr = Json::array();
+        for (size_t p = 0; p < policies.size(); p++) {
+            size_t cell = v * policies.size() + p;
+            Outcome total;
+            for (uint64_t j = 0; j < jobsPerCell; j++) total.merge(partial[cell * jobsPerCell + j]);
+            Json r = total.toJson();
+            r["policy"] = policies[p].name;
+            pr.push_back(r);
+        }
+        vr["policies"] = pr;
+        variantResults.push_back(vr);
+    }
+    result["variants"] = variantResults;
+    std::cout << result.dump(2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,100 @@
+﻿// 窓の無い育成シミュレーション (GrowthSim) で台本どおりに1ゲームを進め、結果を JSON で出力する
+// openFrameworks 本体は不要で、settings.json の読み込みに nlohmann/json (OF の libs/json) だけ使う
+//   g++ -O2 -std=c++17 -I.. -I<of>/libs/json/include GrowthSimCli.cpp ../GrowthSim.cpp -o growthsim
+//   cl /O2 /std:c++17 /EHsc /I.. /I<of>\libs\json\include GrowthSimCli.cpp ..\GrowthSim.cpp
+//
+// growthsim [--settings ../bin/data/settings.json] [--seed N] [--frames N] [--repeat N] <台本>
+//   台本は1文字が1手: 1 = WATER, 2 = FERTILIZER, 3 = KOTODAMA, g / r / c = スキル (GROWTH / RESIST / CATALYST)
+//   ゲームが終わるまで台本を先頭から繰り返す。--repeat 回同じゲームを繰り返して1ゲームの時間も測る
+#include "GrowthSim.h"
+#include "json.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using Json = nlohmann::json;
+
+static bool isCommand(char c) { return c == '1' || c == '2' || c == '3'; }
+
+static void playScript(GrowthSim& sim, const std::string& script) {
+    // 台本に1つはコマンドがあるので、日数が進んで必ず終わる
+    for (size_t i = 0; !sim.isEnded() && sim.getState().day < GrowthRules::DAY_LIMIT; i++) {
+        char c = script[i % script.size()];
+        if (isCommand(c)) sim.command((CommandType)(c - '1'));
+        else if (c == 'g') sim.upgrade(SKILL_GROWTH);
+        else if (c == 'r') sim.upgrade(SKILL_RESIST);
+        else if (c == 'c') sim.upgrade(SKILL_CATALYST);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string settingsPath = "../bin/data/settings.json";
+    std::string script;
+    uint64_t seed = 1;
+    int frames = -1;
+    long repeat = 100000;
+    for (int i = 1; i < argc; i++) {
+        std::string key = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (key == "--settings" && hasValue) settingsPath = argv[++i];
+        else if (key == "--seed" && hasValue) seed = std::stoull(argv[++i]);
+        else if (key == "--frames" && hasValue) frames = std::stoi(argv[++i]);
+        else if (key == "--repeat" && hasValue) repeat = std::max(1L, std::stol(argv[++i]));
+        else if (key[0] != '-') script = key;
+        else {
+            fprintf(stderr, "unknown option: %s\n", key.c_str());
+            return 1;
+        }
+    }
+    if (script.find_first_of("123") == std::string::npos || script.find_first_not_of("123grc") != std::string::npos) {
+        fprintf(stderr, "usage: growthsim [--settings path] [--seed N] [--frames N] [--repeat N] <script of 1/2/3/g/r/c>\n");
+        return 1;
+    }
+
+    GrowthConfig cfg;
+    std::ifstream file(settingsPath);
+    if (file) cfg.load(Json::parse(file));
+    else fprintf(stderr, "%s not found, using defaults\n", settingsPath.c_str());
+    if (frames >= 0) cfg.framesPerCommand = frames;
+
+    GrowthSim sim(cfg);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < repeat; i++) {
+        sim.reset(seed);
+        playScript(sim, script);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeat;
+
+    const GrowthState& st = sim.getState();
+    Json r;
+    r["seed"] = seed;
+    r["tree_seed"] = st.treeSeed;
+    r["script"] = script;
+    r["frames_per_command"] = cfg.framesPerCommand;
+    r["day"] = st.day;
+    r["ended"] = st.ended;
+    r["title"] = GrowthRules::getTitleName(st.title);
+    r["growth_type"] = GrowthRules::getGrowthTypeName(st.type);
+    r["type_day"] = st.typeDay;
+    r["flower_type"] = GrowthRules::getFlowerTypeName(st.flower);
+    r["flower_day"] = st.flowerDay;
+    r["depth_level"] = st.depthLevel;
+    r["max_depth_day"] = st.maxDepthDay;
+    r["bloom_day"] = st.bloomDay;
+    r["len"] = st.len;
+    r["thick"] = st.thick;
+    r["mutation"] = st.mutation;
+    r["max_mutation"] = st.maxMutationReached;
+    r["targets"] = {
+        {"depth_exp", st.targets.depthExp}, {"len", st.targets.len}, {"thick", st.targets.thick}, {"mutation", st.targets.mutation},
+        {"total_len", st.targets.totalLen}, {"total_thick", st.targets.totalThick}, {"total_mutation", st.targets.totalMutation}
+    };
+    r["skill_points"] = st.skillPoints;
+    r["skill_levels"] = { st.skillLevels[SKILL_GROWTH], st.skillLevels[SKILL_RESIST], st.skillLevels[SKILL_CATALYST] };
+    r["commands"] = { {"water", st.commandCounts[CMD_WATER]}, {"fertilizer", st.commandCounts[CMD_FERTILIZER]}, {"kotodama", st.commandCounts[CMD_KOTODAMA]} };
+    r["timing"] = { {"games", repeat}, {"ns_per_game", ns}, {"games_per_hour", 3.6e12 / ns} };
+    std::cout << r.dump(2) << std::endl;
+    return 0;
+}
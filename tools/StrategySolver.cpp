@@ -0,0 +1,339 @@
+﻿// 育成ゲームの最適な手順を探す
+// 目標ごとにコマンドの木を日数の順（幅優先）に展開し、全く同じ状態に合流した手順は置換表で1つにまとめる
+// 1日分の状態数が --beam を超えたら、目標に対する見込みの低い状態から捨てる（メモリは beam に比例）
+//   g++ -O2 -std=c++17 -pthread -I.. -I<of>/libs/json/include StrategySolver.cpp ../GrowthSim.cpp -o solver
+//   cl /O2 /std:c++17 /EHsc /I.. /I<of>\libs\json\include StrategySolver.cpp ..\GrowthSim.cpp
+//
+// solver [--settings ../bin/data/settings.json] [--beam N] [--threads N] [--frames N] [--seed N] [--goal G]...
+//   目標 G: size:LEN,THICK（目標の長さ・太さを同時に LEN / THICK 以上にする）, bloom（最も早く咲かせる）,
+//           type:ELEGANT|STURDY|ELDRITCH, title:giant|chaos|spirit（その成長タイプ・称号に到達する）
+//   最大深度は経験値がコマンドによらず1日ごとに同じだけ増えるので、どの手順でも同じ日に達する（目標にしない）
+//   状態を捨てずに見つけた手順は最短 ("optimal": true)。捨てた場合は見つかった中で最も早いもの
+//   手順は GrowthSimCli の台本と同じ形式 (1/2/3 = コマンド, c = CATALYST) で出力し、GrowthSim で再生して確かめる
+//   スキルは開花にしか効かないので、ポイントは溜まりしだい CATALYST に使う
+#include "GrowthSim.h"
+#include "BranchRng.h"
+#include "WorkerPool.h"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using std::vector;
+using Json = nlohmann::json;
+
+enum GoalKind { GOAL_SIZE, GOAL_BLOOM, GOAL_TYPE, GOAL_TITLE };
+
+struct Goal {
+    string name;
+    GoalKind kind;
+    int value = 0;      // GOAL_TYPE は GrowthType、GOAL_TITLE は GameTitle
+    float len = 0, thick = 0; // GOAL_SIZE の目標の長さ・太さ
+};
+
+static bool parseGoal(const string& spec, Goal& g) {
+    g.name = spec;
+    if (spec.compare(0, 5, "size:") == 0) {
+        // 水やりは太さを、肥料は長さを削るので、どちらかだけでは届かない
+        g.kind = GOAL_SIZE;
+        if (sscanf(spec.c_str() + 5, "%f,%f", &g.len, &g.thick) != 2 || g.len <= 0 || g.thick <= 0) return false;
+    }
+    else if (spec == "bloom") g.kind = GOAL_BLOOM;
+    else if (spec == "type:ELEGANT") { g.kind = GOAL_TYPE; g.value = TYPE_ELEGANT; }
+    else if (spec == "type:STURDY") { g.kind = GOAL_TYPE; g.value = TYPE_STURDY; }
+    else if (spec == "type:ELDRITCH") { g.kind = GOAL_TYPE; g.value = TYPE_ELDRITCH; }
+    else if (spec == "title:giant") { g.kind = GOAL_TITLE; g.value = TITLE_ELEGANT_GIANT; }
+    else if (spec == "title:chaos") { g.kind = GOAL_TITLE; g.value = TITLE_HERALD_OF_CHAOS; }
+    else if (spec == "title:spirit") { g.kind = GOAL_TITLE; g.value = TITLE_GREAT_SPIRIT_TREE; }
+    else return false;
+    return true;
+}
+
+static bool isReached(const Goal& g, const GrowthState& st) {
+    switch (g.kind) {
+    case GOAL_SIZE: return st.targets.len >= g.len && st.targets.thick >= g.thick;
+    case GOAL_BLOOM: return st.bloomDay > 0;
+    case GOAL_TYPE: return st.type == g.value;
+    case GOAL_TITLE: return st.ended && st.title == g.value;
+    }
+    return false;
+}
+
+// もう目標に届かない状態か（変異度の最大値は下がらず、タイプと称号は一度決まると変わらない）
+static bool isDead(const Goal& g, const GrowthState& st) {
+    switch (g.kind) {
+    case GOAL_TYPE: return st.type != TYPE_DEFAULT && st.type != g.value;
+    case GOAL_TITLE:
+        if (st.ended) return st.title != g.value;
+        if (g.value == TITLE_ELEGANT_GIANT) return st.maxMutationReached >= 0.3f;
+        if (g.value == TITLE_GREAT_SPIRIT_TREE) return st.maxMutationReached > 0.8f;
+        return false;
+    default: return false;
+    }
+}
+
+// 目標に対する見込み（大きいほど残す）
+static float getPromise(const Goal& g, const GrowthState& st) {
+    const GrowthTargets& t = st.targets;
+    switch (g.kind) {
+    case GOAL_SIZE: return std::min(t.len / g.len, 1.0f) + std::min(t.thick / g.thick, 1.0f);
+    case GOAL_BLOOM: return std::max(st.maxMutationReached, t.mutation) + st.skillLevels[SKILL_CATALYST] * 0.05f;
+    case GOAL_TYPE:
+        // checkEvolution と同じ比較で、目標の累積値が他をどれだけ上回っているか
+        if (g.value == TYPE_ELEGANT) return t.totalLen - std::max(t.totalThick, t.totalMutation);
+        if (g.value == TYPE_STURDY) return t.totalThick - std::max(t.totalLen, t.totalMutation);
+        return t.totalMutation - std::max(t.totalLen, t.totalThick);
+    case GOAL_TITLE:
+        if (g.value == TITLE_ELEGANT_GIANT) return t.len;
+        if (g.value == TITLE_HERALD_OF_CHAOS) return st.maxMutationReached + t.mutation;
+        return std::min(st.maxMutationReached, 0.3f) - std::max(0.0f, t.mutation - 0.8f);
+    }
+    return 0;
+}
+
+// 以後の展開に効く値（記録用の日付やコマンド数は除く）
+// 近い値を同じ状態とみなすと、合流した先の手順が最短とは限らなくなるので、値はビット単位で比べる
+struct StateValues {
+    float f[11];
+    int n[13];
+};
+
+static StateValues getStateValues(const GrowthState& st) {
+    const GrowthTargets& t = st.targets;
+    return {
+        { t.depthExp, t.len, t.thick, t.mutation, t.totalLen, t.totalThick, t.totalMutation,
+          st.len, st.thick, st.mutation, st.maxMutationReached },
+        { st.day, st.depthLevel, st.skillPoints, st.resilienceLevel, st.skillLevels[0], st.skillLevels[1], st.skillLevels[2],
+          st.type, st.flower, st.ended, st.title, st.maxDepthDay > 0, st.bloomDay > 0 }
+    };
+}
+
+static bool isSameState(const GrowthState& a, const GrowthState& b) {
+    StateValues va = getStateValues(a), vb = getStateValues(b);
+    return memcmp(va.f, vb.f, sizeof(va.f)) == 0 && memcmp(va.n, vb.n, sizeof(va.n)) == 0;
+}
+
+// 置換表のキー（衝突したときは isSameState で確かめる）
+static uint64_t getStateKey(const GrowthState& st) {
+    StateValues v = getStateValues(st);
+    uint64_t h = 0;
+    for (float x : v.f) {
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        h = BranchRng::mix(h ^ bits);
+    }
+    for (int x : v.n) h = BranchRng::mix(h ^ (uint64_t)(int64_t)x);
+    return h;
+}
+
+// 経路を復元するための記録（1日分ごと）
+struct PathNode {
+    int parent;
+    char command;
+    char catalyst;      // コマンドの前に上げた CATALYST のレベル数
+};
+
+struct Child {
+    GrowthSim sim;
+    PathNode node;
+    uint64_t key;
+    float promise;
+    bool dead;
+};
+
+struct SearchResult {
+    bool found = false;
+    bool pruned = false;        // 見込みで状態を捨てた（最適とは限らない）
+    int day = 0;
+    string sequence;
+    uint64_t expanded = 0, merged = 0;
+    size_t peakStates = 0;
+};
+
+static int buyCatalyst(GrowthSim& sim) {
+    int n = 0;
+    while (sim.upgrade(SKILL_CATALYST)) n++;
+    return n;
+}
+
+static SearchResult solve(const Goal& goal, const GrowthConfig& cfg, uint64_t seed, size_t beamWidth, WorkerPool& pool) {
+    SearchResult res;
+    vector<GrowthSim> frontier(1, GrowthSim(cfg));
+    frontier[0].reset(seed);
+    vector<vector<PathNode>> layers;
+
+    while (!frontier.empty()) {
+        // --- 展開（並列）：各状態に3つのコマンドを試す ---
+        vector<Child> children(frontier.size() * 3, Child{ GrowthSim(cfg), {}, 0, 0, false });
+        const size_t BLOCK = 256;
+        pool.parallelFor((frontier.size() + BLOCK - 1) / BLOCK, [&](size_t b) {
+            size_t end = std::min(frontier.size(), (b + 1) * BLOCK);
+            for (size_t i = b * BLOCK; i < end; i++) {
+                for (int c = 0; c < 3; c++) {
+                    Child& ch = children[i * 3 + c];
+                    ch.sim = frontier[i];
+                    int bought = buyCatalyst(ch.sim);
+                    ch.sim.command((CommandType)c);
+                    ch.node = { (int)i, (char)('1' + c), (char)bought };
+                    ch.key = getStateKey(ch.sim.getState());
+                    ch.promise = getPromise(goal, ch.sim.getState());
+                    ch.dead = isDead(goal, ch.sim.getState());
+                }
+            }
+        });
+        res.expanded += children.size();
+
+        // --- 置換表で全く同じ状態に合流した手順をまとめる（以後の展開は同じなので先の方を残す） ---
+        vector<size_t> kept;
+        std::unordered_map<uint64_t, size_t> table;
+        table.reserve(children.size());
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i].dead) continue;
+            auto it = table.emplace(children[i].key, i);
+            if (it.second || !isSameState(children[it.first->second].sim.getState(), children[i].sim.getState())) {
+                kept.push_back(i); // キーが衝突しただけの別の状態はまとめない
+            }
+            else {
+                res.merged++;
+            }
+        }
+
+        // --- 目標に達した状態があれば、その日が最短 ---
+        size_t best = SIZE_MAX;
+        for (size_t i : kept) {
+            if (isReached(goal, children[i].sim.getState()) && (best == SIZE_MAX || children[i].promise > children[best].promise)) best = i;
+        }
+        if (best != SIZE_MAX) {
+            res.found = true;
+            res.day = children[best].sim.getState().day;
+            // 経路を逆にたどる
+            vector<PathNode> path(1, children[best].node);
+            for (int l = (int)layers.size() - 1; l >= 0; l--) path.push_back(layers[l][path.back().parent]);
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                res.sequence.append(it->catalyst, 'c');
+                res.sequence.push_back(it->command);
+            }
+            return res;
+        }
+
+        // --- 幅を超えた分は見込みの低い方から捨てる ---
+        if (kept.size() > beamWidth) {
+            std::nth_element(kept.begin(), kept.begin() + beamWidth, kept.end(),
+                [&](size_t a, size_t b) { return children[a].promise > children[b].promise; });
+            kept.resize(beamWidth);
+            res.pruned = true;
+        }
+        res.peakStates = std::max(res.peakStates, kept.size());
+
+        vector<GrowthSim> next;
+        vector<PathNode> layer;
+        next.reserve(kept.size());
+        layer.reserve(kept.size());
+        for (size_t i : kept) {
+            // 終わったゲームや日数の上限に達した状態はもう進めない
+            const GrowthState& st = children[i].sim.getState();
+            if (st.ended || st.day >= GrowthRules::DAY_LIMIT) continue;
+            next.push_back(children[i].sim);
+            layer.push_back(children[i].node);
+        }
+        frontier.swap(next);
+        layers.push_back(std::move(layer));
+    }
+    return res;
+}
+
+int main(int argc, char* argv[]) {
+    string settingsPath = "../bin/data/settings.json";
+    vector<string> goalSpecs;
+    size_t beamWidth = 20000;
+    uint64_t seed = 1;
+    int threads = 0;
+    int frames = -1;
+    for (int i = 1; i < argc; i++) {
+        string key = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", key.c_str());
+            return 1;
+        }
+        string val = argv[++i];
+        if (key == "--settings") settingsPath = val;
+        else if (key == "--beam") beamWidth = std::max(1ull, std::stoull(val));
+        else if (key == "--seed") seed = std::stoull(val);
+        else if (key == "--threads") threads = std::stoi(val);
+        else if (key == "--frames") frames = std::stoi(val);
+        else if (key == "--goal") goalSpecs.push_back(val);
+        else {
+            fprintf(stderr, "unknown option: %s\n", key.c_str());
+            return 1;
+        }
+    }
+    if (goalSpecs.empty()) {
+        goalSpecs = { "size:400,80", "bloom", "type:ELEGANT", "type:STURDY", "type:ELDRITCH", "title:giant", "title:chaos", "title:spirit" };
+    }
+    vector<Goal> goals(goalSpecs.size());
+    for (size_t i = 0; i < goalSpecs.size(); i++) {
+        if (!parseGoal(goalSpecs[i], goals[i])) {
+            fprintf(stderr, "bad goal: %s\n", goalSpecs[i].c_str());
+            return 1;
+        }
+    }
+
+    GrowthConfig cfg;
+    std::ifstream file(settingsPath);
+    if (file) cfg.load(Json::parse(file));
+    else fprintf(stderr, "%s not found, using defaults\n", settingsPath.c_str());
+    if (frames >= 0) cfg.framesPerCommand = frames;
+
+    WorkerPool pool(threads);
+    Json result;
+    result["beam"] = beamWidth;
+    result["seed"] = seed;
+    result["threads"] = pool.getNumThreads();
+    result["frames_per_command"] = cfg.framesPerCommand;
+    Json goalResults = Json::array();
+    for (auto& goal : goals) {
+        auto start = std::chrono::steady_clock::now();
+        SearchResult res = solve(goal, cfg, seed, beamWidth, pool);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Json r;
+        r["goal"] = goal.name;
+        r["found"] = res.found;
+        r["optimal"] = res.found && !res.pruned;
+        r["states_expanded"] = res.expanded;
+        r["states_merged"] = res.merged;
+        r["peak_states"] = res.peakStates;
+        r["elapsed_sec"] = elapsed;
+        if (res.found) {
+            // 経路の復元を確かめるため、手順を最初から再生する
+            GrowthSim sim(cfg);
+            sim.reset(seed);
+            for (char c : res.sequence) {
+                if (c == 'c') sim.upgrade(SKILL_CATALYST);
+                else sim.command((CommandType)(c - '1'));
+            }
+            const GrowthState& st = sim.getState();
+            r["day"] = res.day;
+            r["sequence"] = res.sequence;
+            r["verified"] = isReached(goal, st);
+            r["replay"] = {
+                {"day", st.day}, {"growth_type", GrowthRules::getGrowthTypeName(st.type)},
+                {"flower_type", GrowthRules::getFlowerTypeName(st.flower)}, {"title", GrowthRules::getTitleName(st.title)},
+                {"len", st.len}, {"max_mutation", st.maxMutationReached},
+                {"max_depth_day", st.maxDepthDay}, {"bloom_day", st.bloomDay}
+            };
+        }
+        goalResults.push_back(r);
+        fprintf(stderr, "%s: %s\n", goal.name.c_str(), res.found ? res.sequence.c_str() : "not found");
+    }
+    result["goals"] = goalResults;
+    std::cout << result.dump(2) << std::endl;
+    return 0;
+}
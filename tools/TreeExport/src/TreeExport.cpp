@@ -0,0 +1,26 @@
+﻿#include "TreeExport.h"
+#include "Tree.h"
+
+void TreeExport::setup() {
+    ofSetLogLevel(OF_LOG_NOTICE);
+    ofSetDataPathRoot(opt.dataPath);
+
+    ofJson config = ofLoadJson("settings.json");
+    if (config.is_null() || !config.contains("tree")) {
+        ofLogError("TreeExport") << "settings.json not found in " << ofToDataPath("", true);
+        ofExit(1);
+        return;
+    }
+    // 書き出しは描画用のメッシュを作らないので、キャッシュも使わない
+    config["tree"]["generation"]["mesh_cache"] = false;
+
+    // プリセットと同じ手順で、育ち切った状態の木にする
+    Tree tree;
+    tree.setup(config);
+    tree.reset();
+    tree.loadPresetConfig({ {"seed", opt.seed}, {"max_depth", opt.depth}, {"target_len", 150.0f}, {"target_thick", 12.0f}, {"target_mutation", opt.mutation} });
+    if (opt.gType != TYPE_DEFAULT) tree.applyEvolution(opt.gType);
+
+    bool ok = tree.exportMesh(opt.outPath, opt.time, opt.depth, 0, 0, opt.gType, opt.fType);
+    ofExit(ok ? 0 : 1);
+}
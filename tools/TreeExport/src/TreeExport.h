@@ -0,0 +1,25 @@
+﻿#pragma once
+#include "ofMain.h"
+#include "Constants.h"
+
+// settings.json の設定で木を1本生成し、.glb / .ply へ書き出して終了する
+// 成長の途中ではなく、指定の深さまで育ち切った形を書き出す（ofApp の [X] キーと同じ Tree::exportMesh）
+class TreeExport : public ofBaseApp {
+public:
+    struct Options {
+        int depth = 6;
+        GrowthType gType = TYPE_DEFAULT;
+        FlowerType fType = FLOWER_NONE;
+        int seed = 1;
+        float mutation = 0.0f;
+        float time = 0.0f;      // 色相・ノイズを決める時刻（同じ値なら同じメッシュ）
+        string dataPath;        // settings.json とシェーダのあるフォルダ
+        string outPath;         // 拡張子 (.glb / .ply) で形式を決める
+    };
+
+    TreeExport(const Options& opt) : opt(opt) {}
+    void setup();
+
+private:
+    Options opt;
+};
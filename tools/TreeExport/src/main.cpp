@@ -0,0 +1,53 @@
+﻿#include "ofMain.h"
+#include "TreeExport.h"
+
+static int findName(const char* const* names, int count, const string& name) {
+	for (int i = 0; i < count; i++) {
+		if (ofToUpper(name) == names[i]) return i;
+	}
+	return -1;
+}
+
+//========================================================================
+// TreeExport --out <tree.glb|tree.ply> [--depth N] [--type DEFAULT|ELEGANT|STURDY|ELDRITCH]
+//            [--flower NONE|CRYSTAL|PETAL|SPIRIT] [--seed N] [--mutation 0-1] [--time 秒] [--data <bin/data のパス>]
+int main(int argc, char* argv[]) {
+	static const char* growthTypeNames[] = { "DEFAULT", "ELEGANT", "STURDY", "ELDRITCH" };
+	static const char* flowerTypeNames[] = { "NONE", "CRYSTAL", "PETAL", "SPIRIT" };
+
+	TreeExport::Options opt;
+	// 既定ではリポジトリの bin/data を使う (tools/TreeExport/bin から3つ上)
+	opt.dataPath = ofFilePath::join(ofFilePath::getCurrentExeDir(), "../../../bin/data/");
+	for (int i = 1; i < argc; i++) {
+		string key = argv[i];
+		string val = (i + 1 < argc) ? argv[++i] : "";
+		if (key == "--out") opt.outPath = val;
+		else if (key == "--depth") opt.depth = ofClamp(ofToInt(val), 0, 16);
+		else if (key == "--type" && findName(growthTypeNames, 4, val) >= 0) opt.gType = (GrowthType)findName(growthTypeNames, 4, val);
+		else if (key == "--flower" && findName(flowerTypeNames, 4, val) >= 0) opt.fType = (FlowerType)findName(flowerTypeNames, 4, val);
+		else if (key == "--seed") opt.seed = ofToInt(val);
+		else if (key == "--mutation") opt.mutation = ofClamp(ofToFloat(val), 0.0f, 1.0f);
+		else if (key == "--time") opt.time = ofToFloat(val);
+		else if (key == "--data") opt.dataPath = val;
+		else {
+			fprintf(stderr, "unknown option: %s %s\n", key.c_str(), val.c_str());
+			return 1;
+		}
+	}
+	if (opt.outPath.empty()) {
+		fprintf(stderr, "usage: TreeExport --out <tree.glb|tree.ply> [--depth N] [--type NAME] [--flower NAME] [--seed N] [--mutation 0-1] [--time sec] [--data path]\n");
+		return 1;
+	}
+	// 出力先は作業フォルダからの相対パス（データフォルダからではない）
+	opt.outPath = ofFilePath::getAbsolutePath(opt.outPath, false);
+
+	// Tree::setup がシェーダを読むので GL のコンテキストは要るが、窓は表示しない
+	ofGLFWWindowSettings settings;
+	settings.setSize(64, 64);
+	settings.visible = false;
+
+	auto window = ofCreateWindow(settings);
+
+	ofRunApp(window, std::make_shared<TreeExport>(opt));
+	return ofRunMainLoop();
+}